@@ -45,6 +45,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 //#define AASFILEDEBUG
 
+//resident copy of the aas file being loaded, NULL when reading from the file
+static byte *aasfiledata;
+static int aasfilesize;
+
 //===========================================================================
 //
 // Parameter:				-
@@ -296,6 +300,21 @@ char *AAS_LoadAASLump(fileHandle_t fp, int offset, int length, int *lastoffset,
 		//just alloc a dummy
 		return (char *) GetClearedHunkMemory(size+1);
 	} //end if
+	//copy the data from the resident copy of the file
+	if (aasfiledata)
+	{
+		if (offset < 0 || length < 0 || offset > aasfilesize - length)
+		{
+			AAS_Error("aas lump out of file bounds\n");
+			AAS_DumpAASData();
+			botimport.FS_FCloseFile(fp);
+			return NULL;
+		} //end if
+		buf = (char *) GetClearedHunkMemory(length+1);
+		Com_Memcpy(buf, aasfiledata + offset, length);
+		*lastoffset = offset + length;
+		return buf;
+	} //end if
 	//seek to the data
 	if (offset != *lastoffset)
 	{
@@ -350,14 +369,39 @@ int AAS_LoadAASFile(char *filename)
 	//dump current loaded aas file
 	AAS_DumpAASData();
 	//open the file
-	botimport.FS_FOpenFile( filename, &fp, FS_READ );
+	aasfilesize = botimport.FS_FOpenFile( filename, &fp, FS_READ );
 	if (!fp)
 	{
 		AAS_Error("can't open %s\n", filename);
 		return BLERR_CANNOTOPENAASFILE;
 	} //end if
+	//use the resident copy of the file if the engine keeps one
+	aasfiledata = NULL;
+	if (aasfilesize >= (int) sizeof(aas_header_t))
+	{
+		aasfiledata = (byte *) botimport.MapCacheFind(filename, NULL);
+		if (!aasfiledata)
+		{
+			aasfiledata = (byte *) botimport.MapCacheStore(filename, aasfilesize);
+			if (aasfiledata)
+			{
+				//keep the resident copy only if the whole file could be read
+				if (botimport.FS_Read(aasfiledata, aasfilesize, fp) == aasfilesize)
+				{
+					botimport.MapCacheCommit(qtrue);
+				} //end if
+				else
+				{
+					botimport.MapCacheCommit(qfalse);
+					aasfiledata = NULL;
+					botimport.FS_Seek(fp, 0, FS_SEEK_SET);
+				} //end else
+			} //end if
+		} //end if
+	} //end if
 	//read the header
-	botimport.FS_Read(&header, sizeof(aas_header_t), fp );
+	if (aasfiledata) Com_Memcpy(&header, aasfiledata, sizeof(aas_header_t));
+	else botimport.FS_Read(&header, sizeof(aas_header_t), fp );
 	lastoffset = sizeof(aas_header_t);
 	//check header identification
 	header.ident = LittleLong(header.ident);
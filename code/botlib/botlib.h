@@ -205,6 +205,10 @@ typedef struct botlib_import_s
 	void		(*DebugPolygonDelete)(int id);
 
 	int			(*Sys_Milliseconds)(void);
+	//resident copies of map data files kept across map changes
+	void		*(*MapCacheFind)( const char *qpath, int *size );
+	void		*(*MapCacheStore)( const char *qpath, int size );
+	void		(*MapCacheCommit)( qboolean success );
 } botlib_import_t;
 
 typedef struct aas_export_s
@@ -812,6 +812,34 @@ static intptr_t QDECL CL_DllSyscall( intptr_t arg, ... ) {
 }
 
 
+/*
+====================
+CL_PrefetchGameState
+
+Queues the map and models named by the gamestate for background reading
+while cgame is loaded and initialized. Sounds are left out, the sound
+codecs stream them through FS_FOpenFileRead() which never sees the prefetch
+====================
+*/
+static int CL_PrefetchGameState( void ) {
+	const char *list[ 1 + MAX_MODELS ];
+	const char *name;
+	int i, n;
+
+	n = 0;
+	list[ n++ ] = cl.mapname;
+
+	for ( i = 1; i < MAX_MODELS; i++ ) {
+		name = cl.gameState.stringData + cl.gameState.stringOffsets[ CS_MODELS + i ];
+		if ( name[0] && name[0] != '*' ) {
+			list[ n++ ] = name;
+		}
+	}
+
+	return FS_ReadFilesAsync( list, n, NULL, NULL );
+}
+
+
 /*
 ====================
 CL_InitCGame
@@ -824,6 +852,7 @@ void CL_InitCGame( void ) {
 	const char			*mapname;
 	int					t1, t2;
 	vmInterpret_t		interpret;
+	int					prefetch;
 
 	t1 = Sys_Milliseconds();
 
@@ -835,6 +864,9 @@ void CL_InitCGame( void ) {
 	mapname = Info_ValueForKey( info, "mapname" );
 	Com_sprintf( cl.mapname, sizeof( cl.mapname ), "maps/%s.bsp", mapname );
 
+	// start reading level data while cgame loads
+	prefetch = CL_PrefetchGameState();
+
 	// allow vertex lighting for in-game elements
 	re.VertexLighting( qtrue );
 
@@ -858,6 +890,8 @@ void CL_InitCGame( void ) {
 	// otherwise server commands sent just before a gamestate are dropped
 	VM_Call( cgvm, 3, CG_INIT, clc.serverMessageSequence, clc.lastExecutedServerCommand, clc.clientNum );
 
+	FS_AsyncFinish( prefetch );
+
 	// reset any CVAR_CHEAT cvars registered by cgame
 	if ( !clc.demoplaying && !cl_connectedToCheatServer )
 		Cvar_SetCheatState();
@@ -486,6 +486,15 @@ static void CL_ParseServerInfo( void )
 		Info_ValueForKey(serverInfo, "sv_dlURL"),
 		sizeof(clc.sv_dlURL));
 
+	/* use built-in HTTP server of the game server if there is no other URL */
+	if ( !clc.sv_dlURL[0] && clc.serverAddress.type == NA_IP ) {
+		int port = atoi( Info_ValueForKey( serverInfo, "sv_httpDlPort" ) );
+		if ( port > 0 && port <= 65535 ) {
+			Com_sprintf( clc.sv_dlURL, sizeof( clc.sv_dlURL ), "http://%s:%i",
+				NET_AdrToString( &clc.serverAddress ), port );
+		}
+	}
+
 	/* remove ending slash in URLs */
 	len = strlen( clc.sv_dlURL );
 	if ( len > 0 &&  clc.sv_dlURL[len-1] == '/' )
@@ -42,18 +42,19 @@ void SetPlaneSignbits( cplane_t *out ) {
 #endif //BSPC
 
 // to allow boxes to be treated as brush models, we allocate
-// some extra indexes along with those needed by the map
-#define	BOX_BRUSHES		1
-#define	BOX_SIDES		6
+// some extra indexes along with those needed by the map,
+// one box for every thread context
+#define	BOX_BRUSHES		(1*CM_MAX_THREADS)
+#define	BOX_SIDES		(6*CM_MAX_THREADS)
 #define	BOX_LEAFS		2
-#define	BOX_PLANES		12
+#define	BOX_PLANES		(12*CM_MAX_THREADS)
 
 #define	LL(x) x=LittleLong(x)
 
 
 clipMap_t	cm;
-int			c_pointcontents;
-int			c_traces, c_brush_traces, c_patch_traces;
+cmThread_t	cm_threads[CM_MAX_THREADS];
+QTHREADLOCAL int cm_threadSlot;
 
 
 static byte *cmod_base;
@@ -62,15 +63,13 @@ static byte *cmod_base;
 cvar_t		*cm_noAreas;
 cvar_t		*cm_noCurves;
 cvar_t		*cm_playerCurveClip;
-#endif
-
-static cmodel_t box_model;
-static cplane_t *box_planes;
-static cbrush_t *box_brush;
 
+static qboolean	cm_cacheBuild;		// allocations go to the map cache
+#endif
 
 
 void	CM_InitBoxHull (void);
+void	CM_InitThreads (void);
 void	CM_FloodAreaConnections (void);
 
 
@@ -100,7 +99,7 @@ static void CMod_LoadShaders( const lump_t *l ) {
 	if ( count < 1 )
 		Com_Error (ERR_DROP, "%s: map with no shaders", __func__ );
 
-	cm.shaders = Hunk_Alloc( count * sizeof( *cm.shaders ), h_high );
+	cm.shaders = CM_Alloc( count * sizeof( *cm.shaders ) );
 	cm.numShaders = count;
 
 	Com_Memcpy( cm.shaders, in, count * sizeof( *cm.shaders ) );
@@ -113,6 +112,42 @@ static void CMod_LoadShaders( const lump_t *l ) {
 }
 
 
+/*
+=================
+CMod_CountSubmodelIndexes
+
+Brush and surface lists of submodels are appended to the world ones,
+so their space has to be reserved when loading leaf lists
+=================
+*/
+static void CMod_CountSubmodelIndexes( const lump_t *l, int *numBrushes, int *numSurfaces ) {
+	const dmodel_t *in;
+	int			i, count;
+	int			brushes, surfaces;
+
+	*numBrushes = 0;
+	*numSurfaces = 0;
+
+	if ( l->filelen % sizeof( *in ) ) {
+		return; // CMod_LoadSubmodels will complain
+	}
+
+	in = (const dmodel_t *)(cmod_base + l->fileofs);
+	count = l->filelen / sizeof( *in );
+
+	// world model doesn't need other info
+	for ( i = 1; i < count; i++ ) {
+		brushes = LittleLong( in[i].numBrushes );
+		surfaces = LittleLong( in[i].numSurfaces );
+		if ( brushes < 0 || surfaces < 0 || brushes > MAX_QINT/16 - *numBrushes || surfaces > MAX_QINT/16 - *numSurfaces ) {
+			Com_Error( ERR_DROP, "%s: bad submodel %i", __func__, i );
+		}
+		*numBrushes += brushes;
+		*numSurfaces += surfaces;
+	}
+}
+
+
 /*
 =================
 CMod_LoadSubmodels
@@ -123,16 +158,20 @@ static void CMod_LoadSubmodels( const lump_t *l ) {
 	cmodel_t	*out;
 	int			i, j, count;
 	int			*indexes;
+	int			firstBrush, firstSurface;
 
 	in = (void *)(cmod_base + l->fileofs);
 	if (l->filelen % sizeof(*in))
 		Com_Error( ERR_DROP, "%s: funny lump size", __func__ );
 
+	firstBrush = cm.numLeafBrushes + BOX_BRUSHES;
+	firstSurface = cm.numLeafSurfaces;
+
 	count = l->filelen / sizeof(*in);
 	if ( count < 1 )
 		Com_Error( ERR_DROP, "%s: map with no models", __func__ );
 
-	cm.cmodels = Hunk_Alloc( count * sizeof( *cm.cmodels ), h_high );
+	cm.cmodels = CM_Alloc( count * sizeof( *cm.cmodels ) );
 	cm.numSubModels = count;
 
 	if ( count > MAX_SUBMODELS )
@@ -152,17 +191,20 @@ static void CMod_LoadSubmodels( const lump_t *l ) {
 			continue;	// world model doesn't need other info
 		}
 
-		// make a "leaf" just to hold the model's brushes and surfaces
+		// make a "leaf" just to hold the model's brushes and surfaces,
+		// lists are stored after the world ones, see CMod_CountSubmodelIndexes
 		out->leaf.numLeafBrushes = LittleLong( in->numBrushes );
-		indexes = Hunk_Alloc( out->leaf.numLeafBrushes * 4, h_high );
-		out->leaf.firstLeafBrush = indexes - cm.leafbrushes;
+		out->leaf.firstLeafBrush = firstBrush;
+		firstBrush += out->leaf.numLeafBrushes;
+		indexes = cm.leafbrushes + out->leaf.firstLeafBrush;
 		for ( j = 0 ; j < out->leaf.numLeafBrushes ; j++ ) {
 			indexes[j] = LittleLong( in->firstBrush ) + j;
 		}
 
 		out->leaf.numLeafSurfaces = LittleLong( in->numSurfaces );
-		indexes = Hunk_Alloc( out->leaf.numLeafSurfaces * 4, h_high );
-		out->leaf.firstLeafSurface = indexes - cm.leafsurfaces;
+		out->leaf.firstLeafSurface = firstSurface;
+		firstSurface += out->leaf.numLeafSurfaces;
+		indexes = cm.leafsurfaces + out->leaf.firstLeafSurface;
 		for ( j = 0 ; j < out->leaf.numLeafSurfaces ; j++ ) {
 			indexes[j] = LittleLong( in->firstSurface ) + j;
 		}
@@ -190,7 +232,7 @@ static void CMod_LoadNodes( const lump_t *l ) {
 	if ( count < 1 )
 		Com_Error( ERR_DROP, "%s: map has no nodes", __func__ );
 
-	cm.nodes = Hunk_Alloc( count * sizeof( *cm.nodes ), h_high );
+	cm.nodes = CM_Alloc( count * sizeof( *cm.nodes ) );
 	cm.numNodes = count;
 
 	out = cm.nodes;
@@ -242,7 +284,7 @@ static void CMod_LoadBrushes( const lump_t *l ) {
 
 	count = l->filelen / sizeof(*in);
 
-	cm.brushes = Hunk_Alloc( ( BOX_BRUSHES + count ) * sizeof( *cm.brushes ), h_high );
+	cm.brushes = CM_Alloc( ( BOX_BRUSHES + count ) * sizeof( *cm.brushes ) );
 	cm.numBrushes = count;
 
 	out = cm.brushes;
@@ -283,7 +325,7 @@ static void CMod_LoadLeafs( const lump_t *l )
 	if ( count < 1 )
 		Com_Error( ERR_DROP, "%s: map with no leafs", __func__ );
 
-	cm.leafs = Hunk_Alloc( ( BOX_LEAFS + count ) * sizeof( *cm.leafs ), h_high );
+	cm.leafs = CM_Alloc( ( BOX_LEAFS + count ) * sizeof( *cm.leafs ) );
 	cm.numLeafs = count;
 
 	out = cm.leafs;
@@ -302,8 +344,8 @@ static void CMod_LoadLeafs( const lump_t *l )
 			cm.numAreas = out->area + 1;
 	}
 
-	cm.areas = Hunk_Alloc( cm.numAreas * sizeof( *cm.areas ), h_high );
-	cm.areaPortals = Hunk_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ), h_high );
+	cm.areas = CM_Alloc( cm.numAreas * sizeof( *cm.areas ) );
+	cm.areaPortals = CM_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ) );
 }
 
 
@@ -328,7 +370,7 @@ static void CMod_LoadPlanes( const lump_t *l )
 	if ( count < 1 )
 		Com_Error( ERR_DROP, "%s: map with no planes", __func__ );
 
-	cm.planes = Hunk_Alloc( ( BOX_PLANES + count ) * sizeof( *cm.planes ), h_high );
+	cm.planes = CM_Alloc( ( BOX_PLANES + count ) * sizeof( *cm.planes ) );
 	cm.numPlanes = count;
 
 	out = cm.planes;
@@ -355,7 +397,7 @@ static void CMod_LoadPlanes( const lump_t *l )
 CMod_LoadLeafBrushes
 =================
 */
-static void CMod_LoadLeafBrushes( const lump_t *l )
+static void CMod_LoadLeafBrushes( const lump_t *l, int extra )
 {
 	int i;
 	int *out;
@@ -368,7 +410,7 @@ static void CMod_LoadLeafBrushes( const lump_t *l )
 
 	count = l->filelen / sizeof(*in);
 
-	cm.leafbrushes = Hunk_Alloc( (count + BOX_BRUSHES) * sizeof( *cm.leafbrushes ), h_high );
+	cm.leafbrushes = CM_Alloc( (count + BOX_BRUSHES + extra) * sizeof( *cm.leafbrushes ) );
 	cm.numLeafBrushes = count;
 
 	out = cm.leafbrushes;
@@ -384,7 +426,7 @@ static void CMod_LoadLeafBrushes( const lump_t *l )
 CMod_LoadLeafSurfaces
 =================
 */
-static void CMod_LoadLeafSurfaces( const lump_t *l )
+static void CMod_LoadLeafSurfaces( const lump_t *l, int extra )
 {
 	int i;
 	int *out;
@@ -397,7 +439,7 @@ static void CMod_LoadLeafSurfaces( const lump_t *l )
 
 	count = l->filelen / sizeof(*in);
 
-	cm.leafsurfaces = Hunk_Alloc( count * sizeof( *cm.leafsurfaces ), h_high );
+	cm.leafsurfaces = CM_Alloc( (count + extra) * sizeof( *cm.leafsurfaces ) );
 	cm.numLeafSurfaces = count;
 
 	out = cm.leafsurfaces;
@@ -445,7 +487,7 @@ static void CMod_LoadBrushSides( const lump_t *l )
 	}
 	count = l->filelen / sizeof(*in);
 
-	cm.brushsides = Hunk_Alloc( ( BOX_SIDES + count ) * sizeof( *cm.brushsides ), h_high );
+	cm.brushsides = CM_Alloc( ( BOX_SIDES + count ) * sizeof( *cm.brushsides ) );
 	cm.numBrushSides = count;
 
 	out = cm.brushsides;
@@ -468,7 +510,7 @@ CMod_LoadEntityString
 =================
 */
 static void CMod_LoadEntityString( const lump_t *l ) {
-	cm.entityString = Hunk_Alloc( l->filelen, h_high );
+	cm.entityString = CM_Alloc( l->filelen );
 	cm.numEntityChars = l->filelen;
 	Com_Memcpy( cm.entityString, cmod_base + l->fileofs, l->filelen );
 }
@@ -487,14 +529,15 @@ static void CMod_LoadVisibility( const lump_t *l ) {
 	len = l->filelen;
 	if ( !len ) {
 		cm.clusterBytes = ( cm.numClusters + 31 ) & ~31;
-		cm.visibility = Hunk_Alloc( cm.clusterBytes, h_high );
+		cm.visibility = CM_Alloc( cm.clusterBytes );
 		Com_Memset( cm.visibility, 255, cm.clusterBytes );
 		return;
 	}
 	buf = cmod_base + l->fileofs;
 
 	cm.vised = qtrue;
-	cm.visibility = Hunk_Alloc( len, h_high );
+	// rows may be read as 64-bit words, keep the last one readable
+	cm.visibility = CM_Alloc( len - VIS_HEADER + sizeof( uint64_t ) );
 	cm.numClusters = LittleLong( ((int *)buf)[0] );
 	cm.clusterBytes = LittleLong( ((int *)buf)[1] );
 	Com_Memcpy (cm.visibility, buf + VIS_HEADER, len - VIS_HEADER );
@@ -525,7 +568,7 @@ static void CMod_LoadPatches( const lump_t *surfs, const lump_t *verts ) {
 		Com_Error( ERR_DROP, "%s: funny lump size", __func__ );
 
 	cm.numSurfaces = count = surfs->filelen / sizeof(*in);
-	cm.surfaces = Hunk_Alloc( cm.numSurfaces * sizeof( cm.surfaces[0] ), h_high );
+	cm.surfaces = CM_Alloc( cm.numSurfaces * sizeof( cm.surfaces[0] ) );
 
 	dv = (void *)(cmod_base + verts->fileofs);
 	if (verts->filelen % sizeof(*dv))
@@ -539,7 +582,7 @@ static void CMod_LoadPatches( const lump_t *surfs, const lump_t *verts ) {
 		}
 		// FIXME: check for non-colliding patches
 
-		cm.surfaces[ i ] = patch = Hunk_Alloc( sizeof( *patch ), h_high );
+		cm.surfaces[ i ] = patch = CM_Alloc( sizeof( *patch ) );
 
 		// load the full drawverts onto the stack
 		width = LittleLong( in->patchWidth );
@@ -568,6 +611,52 @@ static void CMod_LoadPatches( const lump_t *surfs, const lump_t *verts ) {
 //==================================================================
 
 
+/*
+==================
+CM_Alloc
+
+Allocates 0 filled memory for map data, either on the hunk
+or in the map cache if current map is going to be cached
+==================
+*/
+void *CM_Alloc( int size ) {
+#ifndef BSPC
+	if ( cm_cacheBuild ) {
+		return Com_MapCacheAlloc( size );
+	}
+#endif
+	return Hunk_Alloc( size, h_high );
+}
+
+
+#ifndef BSPC
+/*
+==================
+CM_LoadCachedMap
+
+Restores map from the map cache, only runtime state has to be reset
+==================
+*/
+static qboolean CM_LoadCachedMap( const char *name ) {
+	const clipMap_t *cached;
+
+	cached = Com_MapCacheFind( name, "bsp", NULL );
+	if ( !cached ) {
+		return qfalse;
+	}
+
+	cm = *cached;
+
+	Com_Memset( cm.areaPortals, 0, cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ) );
+	cm.floodvalid = 0;
+
+	Com_DPrintf( "%s: %s restored from map cache\n", __func__, name );
+
+	return qtrue;
+}
+#endif
+
+
 #if 0
 static uint32_t CM_LumpChecksum( const lump_t *lump ) {
 	return LittleLong( Com_BlockChecksum( cmod_base + lump->fileofs, lump->filelen ) );
@@ -602,10 +691,14 @@ Loads in the map and all submodels
 ==================
 */
 void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
+#ifndef BSPC
+	clipMap_t		*cached;
+#endif
 	void			*buf;
 	int				i;
 	dheader_t		header;
 	int				length;
+	int				submodelBrushes, submodelSurfaces;
 
 	if ( !name || !name[0] ) {
 		Com_Error( ERR_DROP, "%s: NULL name", __func__ );
@@ -627,6 +720,22 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// free old stuff
 	CM_ClearMap();
 
+#ifndef BSPC
+	cm_cacheBuild = qfalse;
+
+	if ( CM_LoadCachedMap( name ) ) {
+		*checksum = cm.checksum;
+		goto finish;
+	}
+
+	if ( Com_MapCacheBegin( name, "bsp" ) ) {
+		cached = Com_MapCacheAlloc( sizeof( *cached ) );
+		cm_cacheBuild = qtrue;
+	} else {
+		cached = NULL;
+	}
+#endif
+
 #if 0
 	if ( !name[0] ) {
 		cm.numLeafs = 1;
@@ -678,8 +787,9 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// load into heap
 	CMod_LoadShaders( &header.lumps[LUMP_SHADERS] );
 	CMod_LoadLeafs (&header.lumps[LUMP_LEAFS]);
-	CMod_LoadLeafBrushes (&header.lumps[LUMP_LEAFBRUSHES]);
-	CMod_LoadLeafSurfaces (&header.lumps[LUMP_LEAFSURFACES]);
+	CMod_CountSubmodelIndexes( &header.lumps[LUMP_MODELS], &submodelBrushes, &submodelSurfaces );
+	CMod_LoadLeafBrushes (&header.lumps[LUMP_LEAFBRUSHES], submodelBrushes);
+	CMod_LoadLeafSurfaces (&header.lumps[LUMP_LEAFSURFACES], submodelSurfaces);
 	CMod_LoadPlanes (&header.lumps[LUMP_PLANES]);
 	CMod_LoadBrushSides (&header.lumps[LUMP_BRUSHSIDES]);
 	CMod_LoadBrushes (&header.lumps[LUMP_BRUSHES]);
@@ -694,8 +804,19 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// we are NOT freeing the file, because it is cached for the ref
 	FS_FreeFile( buf );
 
+#ifndef BSPC
+	if ( cached ) {
+		*cached = cm;
+		cm_cacheBuild = qfalse;
+		Com_MapCacheEnd( qtrue );
+	}
+
+finish:
+#endif
 	CM_InitBoxHull();
 
+	CM_InitThreads();
+
 	CM_FloodAreaConnections();
 
 	// allow this to be cached if it is loaded by the server
@@ -712,10 +833,72 @@ CM_ClearMap
 */
 void CM_ClearMap( void ) {
 	Com_Memset( &cm, 0, sizeof( cm ) );
+	Com_Memset( cm_threads, 0, sizeof( cm_threads ) );
 	CM_ClearLevelPatches();
 }
 
 
+/*
+==================
+CM_InitThreads
+
+Allocates per-thread dedup stamps, must be called after CM_InitBoxHull
+==================
+*/
+void CM_InitThreads( void ) {
+	cmThread_t *t;
+	int i;
+
+	for ( i = 0; i < CM_MAX_THREADS; i++ ) {
+		t = &cm_threads[i];
+		t->checkcount = 0;
+		t->brushCheck = Hunk_Alloc( ( cm.numBrushes + BOX_BRUSHES ) * sizeof( *t->brushCheck ), h_high );
+		t->surfaceCheck = Hunk_Alloc( ( cm.numSurfaces + 1 ) * sizeof( *t->surfaceCheck ), h_high );
+	}
+}
+
+
+/*
+==================
+CM_SetThreadSlot
+
+Binds calling thread to the given collision query context.
+Main thread uses slot 0 by default, every other thread that
+issues collision queries concurrently must bind to its own slot.
+==================
+*/
+void CM_SetThreadSlot( int slot ) {
+	if ( (unsigned)slot >= CM_MAX_THREADS ) {
+		Com_Error( ERR_FATAL, "%s: bad slot %i", __func__, slot );
+	}
+	cm_threadSlot = slot;
+}
+
+
+/*
+==================
+CM_TraceStats
+
+Collects and resets statistic counters of all thread contexts
+==================
+*/
+void CM_TraceStats( int *traces, int *brushTraces, int *patchTraces, int *points ) {
+	cmThread_t *t;
+	int i;
+
+	*traces = *brushTraces = *patchTraces = *points = 0;
+
+	for ( i = 0; i < CM_MAX_THREADS; i++ ) {
+		t = &cm_threads[i];
+		*traces += t->c_traces;
+		*brushTraces += t->c_brush_traces;
+		*patchTraces += t->c_patch_traces;
+		*points += t->c_pointcontents;
+		t->c_traces = t->c_brush_traces = t->c_patch_traces = t->c_pointcontents = 0;
+	}
+}
+
+
 /*
 ==================
 CM_ClipHandleToModel
@@ -729,7 +912,7 @@ cmodel_t *CM_ClipHandleToModel( clipHandle_t handle ) {
 		return &cm.cmodels[handle];
 	}
 	if ( handle == BOX_MODEL_HANDLE ) {
-		return &box_model;
+		return &CM_Thread()->boxModel;
 	}
 	if ( handle < MAX_SUBMODELS ) {
 		Com_Error( ERR_DROP, "CM_ClipHandleToModel: bad handle %i < %i < %i", 
@@ -797,46 +980,51 @@ can just be stored out and get a proper clipping hull structure.
 */
 void CM_InitBoxHull( void )
 {
-	int			i;
+	int			i, n;
 	int			side;
 	cplane_t	*p;
 	cbrushside_t	*s;
+	cmThread_t	*t;
 
-	box_planes = &cm.planes[cm.numPlanes];
-
-	box_brush = &cm.brushes[cm.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cm.brushsides + cm.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
-
-	box_model.leaf.numLeafBrushes = 1;
-//	box_model.leaf.firstLeafBrush = cm.numBrushes;
-	box_model.leaf.firstLeafBrush = cm.numLeafBrushes;
-	cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes;
-
-	for ( i = 0; i < 6; i++ )
+	for ( n = 0; n < CM_MAX_THREADS; n++ )
 	{
-		side = i & 1;
+		t = &cm_threads[n];
 
-		// brush sides
-		s = &cm.brushsides[cm.numBrushSides + i];
-		s->plane = cm.planes + ( cm.numPlanes + i * 2 + side );
-		s->surfaceFlags = 0;
+		t->boxPlanes = &cm.planes[cm.numPlanes + n * 12];
 
-		// planes
-		p = &box_planes[i * 2];
-		p->type = i >> 1;
-		p->signbits = 0;
-		VectorClear( p->normal );
-		p->normal[i >> 1] = 1;
+		t->boxBrush = &cm.brushes[cm.numBrushes + n];
+		t->boxBrush->numsides = 6;
+		t->boxBrush->sides = cm.brushsides + cm.numBrushSides + n * 6;
+		t->boxBrush->contents = CONTENTS_BODY;
 
-		p = &box_planes[i * 2 + 1];
-		p->type = 3 + ( i >> 1 );
-		p->signbits = 0;
-		VectorClear( p->normal );
-		p->normal[i >> 1] = -1;
+		t->boxModel.leaf.numLeafBrushes = 1;
+		t->boxModel.leaf.firstLeafBrush = cm.numLeafBrushes + n;
+		cm.leafbrushes[cm.numLeafBrushes + n] = cm.numBrushes + n;
 
-		SetPlaneSignbits( p );
+		for ( i = 0; i < 6; i++ )
+		{
+			side = i & 1;
+
+			// brush sides
+			s = &t->boxBrush->sides[i];
+			s->plane = t->boxPlanes + ( i * 2 + side );
+			s->surfaceFlags = 0;
+
+			// planes
+			p = &t->boxPlanes[i * 2];
+			p->type = i >> 1;
+			p->signbits = 0;
+			VectorClear( p->normal );
+			p->normal[i >> 1] = 1;
+
+			p = &t->boxPlanes[i * 2 + 1];
+			p->type = 3 + ( i >> 1 );
+			p->signbits = 0;
+			VectorClear( p->normal );
+			p->normal[i >> 1] = -1;
+
+			SetPlaneSignbits( p );
+		}
 	}
 }
 
@@ -851,14 +1039,18 @@ Capsules are handled differently though.
 ===================
 */
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule ) {
+	cmThread_t *t = CM_Thread();
+	cplane_t *box_planes;
 
-	VectorCopy( mins, box_model.mins );
-	VectorCopy( maxs, box_model.maxs );
+	VectorCopy( mins, t->boxModel.mins );
+	VectorCopy( maxs, t->boxModel.maxs );
 
 	if ( capsule ) {
 		return CAPSULE_MODEL_HANDLE;
 	}
 
+	box_planes = t->boxPlanes;
+
 	box_planes[0].dist = maxs[0];
 	box_planes[1].dist = -maxs[0];
 	box_planes[2].dist = mins[0];
@@ -872,8 +1064,8 @@ clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
-	VectorCopy( mins, box_brush->bounds[0] );
-	VectorCopy( maxs, box_brush->bounds[1] );
+	VectorCopy( mins, t->boxBrush->bounds[0] );
+	VectorCopy( maxs, t->boxBrush->bounds[1] );
 
 	return BOX_MODEL_HANDLE;
 }
@@ -28,6 +28,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define	BOX_MODEL_HANDLE		255
 #define CAPSULE_MODEL_HANDLE	254
 
+#define CM_MAX_THREADS			8	// number of independent collision query contexts
+
 
 // forced double-precison functions
 #define DotProductDP(x,y)		((double)(x)[0]*(y)[0]+(double)(x)[1]*(y)[1]+(double)(x)[2]*(y)[2])
@@ -106,12 +108,10 @@ typedef struct {
 	vec3_t		bounds[2];
 	int			numsides;
 	cbrushside_t	*sides;
-	int			checkcount;		// to avoid repeated testings
 } cbrush_t;
 
 
 typedef struct {
-	int			checkcount;				// to avoid repeated testings
 	int			surfaceFlags;
 	int			contents;
 	struct patchCollide_s	*pc;
@@ -169,23 +169,54 @@ typedef struct {
 	cPatch_t	**surfaces;			// non-patches will be NULL
 
 	int			floodvalid;
-	int			checkcount;					// incremented on each trace
 
 	unsigned int checksum;
 } clipMap_t;
 
 
+// memoized world point lookup, valid for one frame
+#define	CM_POINT_CACHE_SIZE	256		// must be power of two
+
+typedef struct {
+	uint32_t	point[3];		// exact coordinate bits
+	int			generation;		// matches cm_pointCacheGeneration if valid
+	int			leafnum;
+	int			contents;		// -1 if not evaluated yet
+} cmPointCache_t;
+
+// everything a query writes lives here, so that each thread
+// bound to its own context can trace against the shared map
+typedef struct {
+	int			checkcount;		// incremented on each trace
+	int			*brushCheck;	// [numBrushes + CM_MAX_THREADS] to avoid repeated testings
+	int			*surfaceCheck;	// [numSurfaces]
+
+	cmodel_t	boxModel;
+	cplane_t	*boxPlanes;
+	cbrush_t	*boxBrush;
+
+	cmPointCache_t	pointCache[CM_POINT_CACHE_SIZE];
+
+	int			c_pointcontents;
+	int			c_pointcache_hits, c_pointcache_misses;
+	int			c_traces, c_brush_traces, c_patch_traces;
+} cmThread_t;
+
+
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
 #define	SURFACE_CLIP_EPSILON	(0.125)
 
 extern	clipMap_t	cm;
-extern	int			c_pointcontents;
-extern	int			c_traces, c_brush_traces, c_patch_traces;
+extern	cmThread_t	cm_threads[CM_MAX_THREADS];
+extern	QTHREADLOCAL int cm_threadSlot;
+extern	int			cm_pointCacheGeneration;
 extern	cvar_t		*cm_noAreas;
 extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
 
+#define CM_Thread()	(&cm_threads[cm_threadSlot])
+
 // cm_test.c
 
 // Used for oriented capsule collision detection
@@ -210,6 +241,7 @@ typedef struct {
 	qboolean	isPoint;	// optimized case
 	trace_t		trace;		// returned from trace call
 	sphere_t	sphere;		// sphere for oriendted capsule collision
+	cmThread_t	*thread;	// query context of the calling thread
 } traceWork_t;
 
 typedef struct leafList_s {
@@ -230,6 +262,7 @@ void CM_StoreBrushes( leafList_t *ll, int nodenum );
 
 void CM_BoxLeafnums_r( leafList_t *ll, int nodenum );
 
+void		*CM_Alloc( int size );
 cmodel_t	*CM_ClipHandleToModel( clipHandle_t handle );
 qboolean CM_BoundsIntersect( const vec3_t mins, const vec3_t maxs, const vec3_t mins2, const vec3_t maxs2 );
 qboolean CM_BoundsIntersectPoint( const vec3_t mins, const vec3_t maxs, const vec3_t point );
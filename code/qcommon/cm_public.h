@@ -25,6 +25,16 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 void		CM_LoadMap( const char *name, qboolean clientload, int *checksum);
 void		CM_ClearMap( void );
+
+// each thread that runs collision queries concurrently must
+// be bound to its own context, main thread uses slot 0
+void		CM_SetThreadSlot( int slot );
+void		CM_TraceStats( int *traces, int *brushTraces, int *patchTraces, int *points );
+
+// world point lookups are memoized until invalidated, once per frame
+void		CM_InvalidatePointCache( void );
+void		CM_PointCacheStats( int *hits, int *misses );
+
 clipHandle_t CM_InlineModel( int index );		// 0 = world, 1 + are bmodels
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule );
 
@@ -48,16 +48,107 @@ static int CM_PointLeafnum_r( const vec3_t p, int num ) {
 			num = node->children[0];
 	}
 
-	c_pointcontents++;		// optimize counter
+	CM_Thread()->c_pointcontents++;		// optimize counter
 
 	return -1 - num;
 }
 
+
+/*
+======================================================================
+
+POINT CACHE
+
+Water checks, item drops and bot queries test the same origins many
+times per frame, world leaf and contents lookups are memoized in a
+small direct-mapped cache of the calling thread keyed by exact point
+coordinates. Only the world model is cached as it never moves, the
+whole cache is invalidated each frame and on area portal changes.
+
+======================================================================
+*/
+
+int cm_pointCacheGeneration = 1;
+
+
+/*
+==================
+CM_InvalidatePointCache
+==================
+*/
+void CM_InvalidatePointCache( void ) {
+	if ( ++cm_pointCacheGeneration == 0 ) {
+		// entries of cleared contexts must never match
+		cm_pointCacheGeneration = 1;
+	}
+}
+
+
+/*
+==================
+CM_PointCacheStats
+
+Collects and resets counters of all thread contexts
+==================
+*/
+void CM_PointCacheStats( int *hits, int *misses ) {
+	cmThread_t *t;
+	int i;
+
+	*hits = *misses = 0;
+
+	for ( i = 0; i < CM_MAX_THREADS; i++ ) {
+		t = &cm_threads[i];
+		*hits += t->c_pointcache_hits;
+		*misses += t->c_pointcache_misses;
+		t->c_pointcache_hits = t->c_pointcache_misses = 0;
+	}
+}
+
+
+/*
+==================
+CM_CachedPoint
+
+Returns cache entry of the world point with valid leaf number
+==================
+*/
+static cmPointCache_t *CM_CachedPoint( const vec3_t p ) {
+	cmThread_t		*t;
+	cmPointCache_t	*pc;
+	uint32_t		bits[3];
+	uint32_t		hash;
+
+	t = CM_Thread();
+
+	memcpy( bits, p, sizeof( bits ) );
+	hash = ( bits[0] * 73856093U ) ^ ( bits[1] * 19349663U ) ^ ( bits[2] * 83492791U );
+	pc = &t->pointCache[ ( hash ^ ( hash >> 16 ) ) & ( CM_POINT_CACHE_SIZE - 1 ) ];
+
+	if ( pc->generation == cm_pointCacheGeneration && pc->point[0] == bits[0]
+		&& pc->point[1] == bits[1] && pc->point[2] == bits[2] ) {
+		t->c_pointcache_hits++;
+		return pc;
+	}
+
+	t->c_pointcache_misses++;
+
+	pc->point[0] = bits[0];
+	pc->point[1] = bits[1];
+	pc->point[2] = bits[2];
+	pc->generation = cm_pointCacheGeneration;
+	pc->leafnum = CM_PointLeafnum_r( p, 0 );
+	pc->contents = -1;
+
+	return pc;
+}
+
+
 int CM_PointLeafnum( const vec3_t p ) {
 	if ( !cm.numNodes ) {	// map not loaded
 		return 0;
 	}
-	return CM_PointLeafnum_r (p, 0);
+	return CM_CachedPoint( p )->leafnum;
 }
 
 
@@ -88,6 +179,7 @@ void CM_StoreLeafs( leafList_t *ll, int nodenum ) {
 }
 
 void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
+	cmThread_t	*t = CM_Thread();
 	int			i, k;
 	int			leafnum;
 	int			brushnum;
@@ -100,11 +192,11 @@ void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
 
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
-		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
+		if ( t->brushCheck[brushnum] == t->checkcount ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		t->brushCheck[brushnum] = t->checkcount;
+		b = &cm.brushes[brushnum];
 		for ( i = 0 ; i < 3 ; i++ ) {
 			if ( b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i] ) {
 				break;
@@ -172,8 +264,6 @@ CM_BoxLeafnums
 int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf) {
 	leafList_t	ll;
 
-	cm.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -197,7 +287,7 @@ CM_BoxBrushes
 int CM_BoxBrushes( const vec3_t mins, const vec3_t maxs, cbrush_t **list, int listsize ) {
 	leafList_t	ll;
 
-	cm.checkcount++;
+	CM_Thread()->checkcount++;
 
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
@@ -224,7 +314,6 @@ CM_PointContents
 ==================
 */
 int CM_PointContents( const vec3_t p, clipHandle_t model ) {
-	int			leafnum;
 	int			i, k;
 	int			brushnum;
 	cLeaf_t		*leaf;
@@ -232,6 +321,7 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 	int			contents;
 	float		d;
 	cmodel_t	*clipm;
+	cmPointCache_t *pc;
 
 	if (!cm.numNodes) {	// map not loaded
 		return 0;
@@ -240,9 +330,13 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 	if ( model ) {
 		clipm = CM_ClipHandleToModel( model );
 		leaf = &clipm->leaf;
+		pc = NULL;
 	} else {
-		leafnum = CM_PointLeafnum_r (p, 0);
-		leaf = &cm.leafs[leafnum];
+		pc = CM_CachedPoint( p );
+		if ( pc->contents != -1 ) {
+			return pc->contents;
+		}
+		leaf = &cm.leafs[pc->leafnum];
 	}
 
 	contents = 0;
@@ -269,6 +363,10 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 		}
 	}
 
+	if ( pc ) {
+		pc->contents = contents;
+	}
+
 	return contents;
 }
 
@@ -407,6 +505,8 @@ void	CM_AdjustAreaPortalState( int area1, int area2, qboolean open ) {
 	}
 
 	CM_FloodAreaConnections ();
+
+	CM_InvalidatePointCache();
 }
 
 /*
@@ -232,19 +232,21 @@ CM_TestInLeaf
 ================
 */
 static void CM_TestInLeaf( traceWork_t *tw, const cLeaf_t *leaf ) {
+	cmThread_t	*t = tw->thread;
 	int			k;
 	int			brushnum;
+	int			surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
 	// test box position against all brushes in the leaf
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
-		b = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
+		if (t->brushCheck[brushnum] == t->checkcount) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		t->brushCheck[brushnum] = t->checkcount;
+		b = &cm.brushes[brushnum];
 
 		if ( !(b->contents & tw->contents)) {
 			continue;
@@ -263,14 +265,15 @@ static void CM_TestInLeaf( traceWork_t *tw, const cLeaf_t *leaf ) {
 	if ( !cm_noCurves->integer ) {
 #endif //BSPC
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = cm.surfaces[ cm.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = cm.leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = cm.surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
+			if ( t->surfaceCheck[ surfnum ] == t->checkcount ) {
 				continue;	// already checked this brush in another leaf
 			}
-			patch->checkcount = cm.checkcount;
+			t->surfaceCheck[ surfnum ] = t->checkcount;
 
 			if ( !(patch->contents & tw->contents)) {
 				continue;
@@ -423,12 +426,9 @@ static void CM_PositionTest( traceWork_t *tw ) {
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
 
-	cm.checkcount++;
-
 	CM_BoxLeafnums_r( &ll, 0 );
 
-
-	cm.checkcount++;
+	tw->thread->checkcount++;
 
 	// test the contents of the leafs
 	for (i=0 ; i < ll.count ; i++) {
@@ -456,7 +456,7 @@ CM_TraceThroughPatch
 static void CM_TraceThroughPatch( traceWork_t *tw, const cPatch_t *patch ) {
 	float		oldFrac;
 
-	c_patch_traces++;
+	tw->thread->c_patch_traces++;
 
 	oldFrac = tw->trace.fraction;
 
@@ -495,7 +495,7 @@ static void CM_TraceThroughBrush( traceWork_t *tw, const cbrush_t *brush ) {
 		return;
 	}
 
-	c_brush_traces++;
+	tw->thread->c_brush_traces++;
 
 	getout = qfalse;
 	startout = qfalse;
@@ -663,8 +663,10 @@ CM_TraceThroughLeaf
 ================
 */
 static void CM_TraceThroughLeaf( traceWork_t *tw, const cLeaf_t *leaf ) {
+	cmThread_t	*t = tw->thread;
 	int			k;
 	int			brushnum;
+	int			surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
@@ -672,11 +674,11 @@ static void CM_TraceThroughLeaf( traceWork_t *tw, const cLeaf_t *leaf ) {
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 
-		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
+		if ( t->brushCheck[brushnum] == t->checkcount ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		t->brushCheck[brushnum] = t->checkcount;
+		b = &cm.brushes[brushnum];
 
 		if ( !(b->contents & tw->contents) ) {
 			continue;
@@ -700,14 +702,15 @@ static void CM_TraceThroughLeaf( traceWork_t *tw, const cLeaf_t *leaf ) {
 	if ( !cm_noCurves->integer ) {
 #endif
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = cm.surfaces[ cm.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = cm.leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = cm.surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
+			if ( t->surfaceCheck[ surfnum ] == t->checkcount ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
+			t->surfaceCheck[ surfnum ] = t->checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -1147,15 +1150,19 @@ static void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, co
 	traceWork_t	tw;
 	vec3_t		offset;
 	cmodel_t	*cmod;
+	cmThread_t	*t;
 
 	cmod = CM_ClipHandleToModel( model );
 
-	cm.checkcount++;		// for multi-check avoidance
+	t = CM_Thread();
+
+	t->checkcount++;		// for multi-check avoidance
 
-	c_traces++;				// for statistics, may be zeroed
+	t->c_traces++;			// for statistics, may be zeroed
 
 	// fill in a default trace
 	Com_Memset( &tw, 0, sizeof(tw) );
+	tw.thread = t;
 	tw.trace.fraction = 1;	// assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
 
@@ -31,6 +31,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #else
 #include <winsock.h>
 #endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "../client/keys.h"
 
@@ -957,18 +960,11 @@ all big things are allocated on the hunk.
 #define MINFRAGMENT	64
 
 #ifdef USE_MULTI_SEGMENT
-#if 1 // forward lookup, faster allocation
-#define DIRECTION next
-// we may have up to 4 lists to group free blocks by size
-//#define TINY_SIZE	32
-#define SMALL_SIZE	64
-#define MEDIUM_SIZE	128
-#else // backward lookup, better free space consolidation
-#define DIRECTION prev
-#define TINY_SIZE	64
-#define SMALL_SIZE	128
-#define MEDIUM_SIZE	256
-#endif
+// free blocks are segregated by power-of-two size classes:
+// list N holds blocks with size in [ 2^N .. 2^(N+1) )
+#define FREE_LISTS	32
+// max.blocks to check in a size class which may not fit request
+#define FREE_SCAN	8
 #endif
 
 #define USE_STATIC_TAGS
@@ -988,6 +984,7 @@ typedef struct memblock_s {
 	int			size;	// including the header and possibly tiny fragments
 	memtag_t	tag;	// a tag of 0 is a free block
 	int			id;		// should be ZONEID
+	int			site;	// allocation site index, 0 if not tracked
 #ifdef ZONE_DEBUG
 	zonedebug_t d;
 #endif
@@ -1003,14 +1000,8 @@ typedef struct memzone_s {
 	int		used;			// total bytes used
 	memblock_t	blocklist;	// start / end cap for linked list
 #ifdef USE_MULTI_SEGMENT
-	memblock_t	dummy0;		// just to allocate some space before freelist
-	freeblock_t	freelist_tiny;
-	memblock_t	dummy1;
-	freeblock_t	freelist_small;
-	memblock_t	dummy2;
-	freeblock_t	freelist_medium;
-	memblock_t	dummy3;
-	freeblock_t	freelist;
+	unsigned int freemask;	// bit N is set when freelist[N] is not empty
+	freeblock_t	freelist[ FREE_LISTS ];
 #else
 	memblock_t	*rover;
 #endif
@@ -1028,18 +1019,41 @@ static memzone_t *smallzone;
 
 #ifdef USE_MULTI_SEGMENT
 
-static void InitFree( freeblock_t *fb )
+static ID_INLINE int FreeListIndex( unsigned int size )
 {
-	memblock_t *block = (memblock_t*)( (byte*)fb - sizeof( memblock_t ) );
-	Com_Memset( block, 0, sizeof( *block ) );
+#if defined(__GNUC__) || defined(__clang__)
+	return 31 - __builtin_clz( size );
+#else
+	int n = 0;
+	while ( size >>= 1 ) {
+		n++;
+	}
+	return n;
+#endif
+}
+
+
+static ID_INLINE int LowestBit( unsigned int mask )
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz( mask );
+#else
+	int n = 0;
+	while ( !( mask & 1 ) ) {
+		mask >>= 1;
+		n++;
+	}
+	return n;
+#endif
 }
 
 
-static void RemoveFree( memblock_t *block )
+static void RemoveFree( memzone_t *zone, memblock_t *block )
 {
 	freeblock_t *fb = (freeblock_t*)( block + 1 );
 	freeblock_t *prev;
 	freeblock_t *next;
+	int index;
 
 #ifdef ZONE_DEBUG
 	if ( fb->next == NULL || fb->prev == NULL || fb->next == fb || fb->prev == fb ) {
@@ -1052,6 +1066,14 @@ static void RemoveFree( memblock_t *block )
 
 	prev->next = next;
 	next->prev = prev;
+
+	if ( prev == next ) {
+		// may be the last block in size class
+		index = FreeListIndex( block->size );
+		if ( prev == &zone->freelist[ index ] ) {
+			zone->freemask &= ~( 1U << index );
+		}
+	}
 }
 
 
@@ -1059,24 +1081,7 @@ static void InsertFree( memzone_t *zone, memblock_t *block )
 {
 	freeblock_t *fb = (freeblock_t*)( block + 1 );
 	freeblock_t *prev, *next;
-#ifdef TINY_SIZE
-	if ( block->size <= TINY_SIZE )
-		prev = &zone->freelist_tiny;
-	else
-#endif
-#ifdef SMALL_SIZE
-	if ( block->size <= SMALL_SIZE )
-		prev = &zone->freelist_small;
-	else
-#endif
-#ifdef MEDIUM_SIZE
-	if ( block->size <= MEDIUM_SIZE )
-		prev = &zone->freelist_medium;
-	else
-#endif
-		prev = &zone->freelist;
-
-	next = prev->next;
+	int index;
 
 #ifdef ZONE_DEBUG
 	if ( block->size < sizeof( *fb ) + sizeof( *block ) ) {
@@ -1084,11 +1089,18 @@ static void InsertFree( memzone_t *zone, memblock_t *block )
 	}
 #endif
 
+	index = FreeListIndex( block->size );
+
+	prev = &zone->freelist[ index ];
+	next = prev->next;
+
 	prev->next = fb;
 	next->prev = fb;
 
 	fb->prev = prev;
 	fb->next = next;
+
+	zone->freemask |= 1U << index;
 }
 
 
@@ -1154,59 +1166,52 @@ static freeblock_t *NewBlock( memzone_t *zone, int size )
 }
 
 
+/*
+================
+SearchFree
+
+Any block from a size class above requested size will fit so take
+the first one, otherwise try few blocks from the requested size class
+================
+*/
 static memblock_t *SearchFree( memzone_t *zone, int size )
 {
 	const freeblock_t *fb;
 	memblock_t *base;
+	unsigned int mask;
+	int index, count;
 
-#ifdef TINY_SIZE
-	if ( size <= TINY_SIZE )
-		fb = zone->freelist_tiny.DIRECTION;
-	else
-#endif
-#ifdef SMALL_SIZE
-	if ( size <= SMALL_SIZE )
-		fb = zone->freelist_small.DIRECTION;
-	else
-#endif
-#ifdef MEDIUM_SIZE
-	if ( size <= MEDIUM_SIZE )
-		fb = zone->freelist_medium.DIRECTION;
-	else
-#endif
-		fb = zone->freelist.DIRECTION;
+	index = FreeListIndex( size );
 
-	for ( ;; ) {
-		// not found, allocate new segment?
-		if ( fb == &zone->freelist ) {
-			fb = NewBlock( zone, size );
-		} else {
-#ifdef TINY_SIZE
-			if ( fb == &zone->freelist_tiny ) {
-				fb = zone->freelist_small.DIRECTION;
-				continue;
-			}
-#endif
-#ifdef SMALL_SIZE
-			if ( fb == &zone->freelist_small ) {
-				fb = zone->freelist_medium.DIRECTION;
-				continue;
-			}
-#endif
-#ifdef MEDIUM_SIZE
-			if ( fb == &zone->freelist_medium ) {
-				fb = zone->freelist.DIRECTION;
-				continue;
-			}
-#endif
+	// first block of the same size class, good for repeated sizes
+	fb = zone->freelist[ index ].next;
+	if ( fb != &zone->freelist[ index ] ) {
+		base = (memblock_t*)( (byte*) fb - sizeof( *base ) );
+		if ( base->size >= size ) {
+			return base;
 		}
+	}
+
+	if ( index + 1 < FREE_LISTS ) {
+		mask = zone->freemask & ~( ( 2U << index ) - 1 );
+		if ( mask ) {
+			fb = zone->freelist[ LowestBit( mask ) ].next;
+			return (memblock_t*)( (byte*) fb - sizeof( *base ) );
+		}
+	}
+
+	count = 1;
+	for ( fb = zone->freelist[ index ].next->next; fb != &zone->freelist[ index ] && count < FREE_SCAN; fb = fb->next, count++ ) {
 		base = (memblock_t*)( (byte*) fb - sizeof( *base ) );
-		fb = fb->DIRECTION;
 		if ( base->size >= size ) {
 			return base;
 		}
 	}
-	return NULL;
+
+	// not found, allocate new segment
+	fb = NewBlock( zone, size );
+
+	return (memblock_t*)( (byte*) fb - sizeof( *base ) );
 }
 #endif // USE_MULTI_SEGMENT
 
@@ -1219,6 +1224,9 @@ Z_ClearZone
 static void Z_ClearZone( memzone_t *zone, memzone_t *head, int size, int segnum ) {
 	memblock_t	*block;
 	int min_fragment;
+#ifdef USE_MULTI_SEGMENT
+	int i;
+#endif
 
 #ifdef USE_MULTI_SEGMENT
 	min_fragment = sizeof( memblock_t ) + sizeof( freeblock_t );
@@ -1250,17 +1258,10 @@ static void Z_ClearZone( memzone_t *zone, memzone_t *head, int size, int segnum
 	block->size = size - sizeof(memzone_t);
 
 #ifdef USE_MULTI_SEGMENT
-	InitFree( &zone->freelist );
-	zone->freelist.next = zone->freelist.prev = &zone->freelist;
-
-	InitFree( &zone->freelist_medium );
-	zone->freelist_medium.next = zone->freelist_medium.prev = &zone->freelist_medium;
-
-	InitFree( &zone->freelist_small );
-	zone->freelist_small.next = zone->freelist_small.prev = &zone->freelist_small;
-
-	InitFree( &zone->freelist_tiny );
-	zone->freelist_tiny.next = zone->freelist_tiny.prev = &zone->freelist_tiny;
+	for ( i = 0; i < FREE_LISTS; i++ ) {
+		zone->freelist[i].next = zone->freelist[i].prev = &zone->freelist[i];
+	}
+	zone->freemask = 0;
 
 	InsertFree( zone, block );
 #endif
@@ -1299,6 +1300,424 @@ static void MergeBlock( memblock_t *curr_free, const memblock_t *next )
 }
 
 
+/*
+==============================================================================
+
+Allocation site telemetry
+
+Per call site counters for zone and hunk allocations, toggled at runtime
+with com_memSites. Sites are keyed by return address so this works in any
+build, offsets in the dump can be resolved with addr2line
+
+==============================================================================
+*/
+
+#define MAX_MEMSITES	1024	// must be a power of two
+
+#if defined( _MSC_VER )
+#define RETURN_ADDRESS() _ReturnAddress()
+#elif defined( __GNUC__ ) || defined( __clang__ )
+#define RETURN_ADDRESS() __builtin_return_address( 0 )
+#else
+#define RETURN_ADDRESS() NULL
+#endif
+
+typedef enum {
+	MEMSITE_ZONE,
+	MEMSITE_SMALL,
+	MEMSITE_HUNK
+} memsiteKind_t;
+
+typedef struct {
+	const void *addr;	// caller, NULL for unused slot
+	memsiteKind_t kind;
+	int		allocs;
+	int		frees;
+	int		bytes;		// currently allocated
+	int		peak;		// high-water mark of bytes
+	int64_t	total;		// allocated over lifetime
+	int		markBytes;	// hunk bytes at Hunk_SetMark()
+} memsite_t;
+
+static memsite_t memsites[ MAX_MEMSITES ]; // slot 0 collects untracked frees
+static int numMemsites;
+static qboolean memsitesActive;
+static const void *memCaller;	// set by allocation wrappers for Z_TagMalloc, the zone is main thread only and workers must use malloc
+
+static cvar_t *com_memSites;
+static cvar_t *com_memSitesDump;
+
+
+/*
+================
+Com_MemSiteIndex
+
+Returns 0 if site table is full
+================
+*/
+static int Com_MemSiteIndex( const void *addr, memsiteKind_t kind ) {
+	unsigned int hash;
+	memsite_t *site;
+	int i;
+
+	hash = (unsigned int)( (uintptr_t)addr >> 2 ) * 2654435761U + kind;
+
+	for ( i = 0; i < MAX_MEMSITES; i++, hash++ ) {
+		hash &= MAX_MEMSITES - 1;
+		if ( hash == 0 ) {
+			continue;
+		}
+		site = &memsites[ hash ];
+		if ( site->addr == addr && site->kind == kind ) {
+			return hash;
+		}
+		if ( site->addr == NULL ) {
+			if ( numMemsites >= MAX_MEMSITES / 2 ) {
+				return 0; // keep probe chains short
+			}
+			site->addr = addr;
+			site->kind = kind;
+			numMemsites++;
+			return hash;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+================
+Com_MemSiteAlloc
+================
+*/
+static void Com_MemSiteAlloc( int index, int size ) {
+	memsite_t *site = &memsites[ index ];
+
+	site->allocs++;
+	site->bytes += size;
+	site->total += size;
+	if ( site->bytes > site->peak ) {
+		site->peak = site->bytes;
+	}
+}
+
+
+/*
+================
+Com_MemSiteFree
+================
+*/
+static void Com_MemSiteFree( int index, int size ) {
+	memsite_t *site = &memsites[ index ];
+
+	site->frees++;
+	site->bytes -= size;
+}
+
+
+/*
+================
+Com_MemSitesSetHunkMark
+================
+*/
+static void Com_MemSitesSetHunkMark( void ) {
+	int i;
+
+	for ( i = 1; i < MAX_MEMSITES; i++ ) {
+		if ( memsites[ i ].addr && memsites[ i ].kind == MEMSITE_HUNK ) {
+			memsites[ i ].markBytes = memsites[ i ].bytes;
+		}
+	}
+}
+
+
+/*
+================
+Com_MemSitesClearHunk
+
+Hunk memory is released all at once so only live counters are reset,
+either to zero or to their values at Hunk_SetMark()
+================
+*/
+static void Com_MemSitesClearHunk( qboolean toMark ) {
+	int i;
+
+	for ( i = 1; i < MAX_MEMSITES; i++ ) {
+		if ( memsites[ i ].addr && memsites[ i ].kind == MEMSITE_HUNK ) {
+			if ( toMark ) {
+				memsites[ i ].bytes = memsites[ i ].markBytes;
+			} else {
+				memsites[ i ].bytes = 0;
+				memsites[ i ].markBytes = 0;
+			}
+		}
+	}
+}
+
+
+/*
+================
+Com_MemSitesCompare
+================
+*/
+static int QDECL Com_MemSitesCompare( const void *a, const void *b ) {
+	const memsite_t *s1 = &memsites[ *(const int *)a ];
+	const memsite_t *s2 = &memsites[ *(const int *)b ];
+
+	if ( s1->peak != s2->peak ) {
+		return s2->peak - s1->peak;
+	}
+	return s2->bytes - s1->bytes;
+}
+
+
+/*
+================
+Com_SortMemSites
+================
+*/
+static int Com_SortMemSites( int *list ) {
+	int i, n;
+
+	for ( i = 1, n = 0; i < MAX_MEMSITES; i++ ) {
+		if ( memsites[ i ].addr ) {
+			list[ n++ ] = i;
+		}
+	}
+
+	qsort( list, n, sizeof( list[0] ), Com_MemSitesCompare );
+
+	return n;
+}
+
+
+static const char *memsiteKindName[] = { "zone", "small", "hunk" };
+
+/*
+================
+Com_WriteMemSites
+================
+*/
+static void Com_WriteMemSites( const char *filename ) {
+	int list[ MAX_MEMSITES ];
+	const memsite_t *site;
+	fileHandle_t f;
+	int i, n;
+
+	if ( !FS_Initialized() ) {
+		return;
+	}
+
+	f = FS_FOpenFileWrite( filename );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "Couldn't write %s.\n", filename );
+		return;
+	}
+
+	n = Com_SortMemSites( list );
+
+	FS_Printf( f, "# %i sites, offsets are relative to Com_Init at %p\n", n, (void *)Com_Init );
+	FS_Printf( f, "kind,offset,allocs,frees,bytes,peak,total\n" );
+	for ( i = 0; i < n; i++ ) {
+		site = &memsites[ list[ i ] ];
+		FS_Printf( f, "%s,%lld,%i,%i,%i,%i,%lld\n", memsiteKindName[ site->kind ],
+			(long long)( (intptr_t)site->addr - (intptr_t)Com_Init ),
+			site->allocs, site->frees, site->bytes, site->peak, (long long)site->total );
+	}
+
+	FS_FCloseFile( f );
+}
+
+
+/*
+================
+Com_MemSites_f
+================
+*/
+static void Com_MemSites_f( void ) {
+	int list[ MAX_MEMSITES ];
+	const memsite_t *site;
+	int i, n;
+
+	if ( Cmd_Argc() > 1 ) {
+		Com_WriteMemSites( Cmd_Argv( 1 ) );
+		return;
+	}
+
+	if ( !memsitesActive ) {
+		Com_Printf( "Allocation site telemetry is disabled, set com_memSites 1 to enable.\n" );
+	}
+
+	n = Com_SortMemSites( list );
+
+	Com_Printf( "kind        offset    allocs     frees     bytes      peak\n" );
+	for ( i = 0; i < n && i < 32; i++ ) {
+		site = &memsites[ list[ i ] ];
+		Com_Printf( "%-5s %12lld %9i %9i %9i %9i\n", memsiteKindName[ site->kind ],
+			(long long)( (intptr_t)site->addr - (intptr_t)Com_Init ),
+			site->allocs, site->frees, site->bytes, site->peak );
+	}
+	Com_Printf( "%i allocation sites, %i untracked frees\n", n, memsites[0].frees );
+}
+
+
+/*
+================
+Com_MemSitesFrame
+================
+*/
+static void Com_MemSitesFrame( void ) {
+	static int lastDump;
+	int now;
+
+	if ( com_memSites->modified ) {
+		com_memSites->modified = qfalse;
+		memsitesActive = com_memSites->integer ? qtrue : qfalse;
+	}
+
+	if ( !memsitesActive || com_memSitesDump->integer <= 0 ) {
+		return;
+	}
+
+	now = Sys_Milliseconds();
+	if ( now - lastDump >= com_memSitesDump->integer * 1000 ) {
+		lastDump = now;
+		Com_WriteMemSites( "memsites.csv" );
+	}
+}
+
+
+/*
+================
+Com_InitMemSites
+================
+*/
+static void Com_InitMemSites( void ) {
+	com_memSites = Cvar_Get( "com_memSites", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( com_memSites, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( com_memSites, "Track zone and hunk allocations per call site, see memsites command" );
+	com_memSitesDump = Cvar_Get( "com_memSitesDump", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( com_memSitesDump, "0", NULL, CV_INTEGER );
+	Cvar_SetDescription( com_memSitesDump, "Write allocation site counters to memsites.csv every N seconds, 0 disables" );
+
+	com_memSites->modified = qtrue;
+
+	Cmd_AddCommand( "memsites", Com_MemSites_f );
+}
+
+
+/*
+==============================================================================
+
+Tag arenas
+
+Small allocations of selected tags are bump-allocated from large zone
+blocks (chunks), each one is preceded only by ARENAID marker so Z_Free()
+can recognize it in place. Memory is released all at once by Z_FreeTags(),
+individual Z_Free() calls are ignored or rejected in debug builds
+
+==============================================================================
+*/
+
+#define ARENA_CHUNK		(16*1024)
+#define ARENA_MAX_ALLOC	(ARENA_CHUNK/16)	// larger requests go to regular zone blocks
+#define ARENA_HEADER	PAD( sizeof( int ), sizeof( intptr_t ) )
+#define ARENAID			-0x1d4a12		// negative so it never matches memblock_t site or allocSize
+
+typedef struct arenachunk_s {
+	struct arenachunk_s *next;
+	int		size;		// usable bytes after chunk header
+	int		used;
+} arenachunk_t;
+
+typedef struct {
+	const char	*name;		// non-NULL for enabled arenas
+	arenachunk_t *chunks;	// most recently allocated first
+	int		numChunks;
+	int		allocs;
+	int		bytes;
+	int		zoneAllocs;		// oversized requests passed to the zone
+} memarena_t;
+
+static memarena_t arenas[ TAG_COUNT ];
+
+
+/*
+================
+Z_InitArena
+================
+*/
+static void Z_InitArena( memtag_t tag, const char *name ) {
+	memarena_t *arena = &arenas[ tag ];
+
+	Com_Memset( arena, 0, sizeof( *arena ) );
+	arena->name = name;
+}
+
+
+/*
+================
+Z_ArenaAlloc
+================
+*/
+static void *Z_ArenaAlloc( memarena_t *arena, int size, memtag_t tag ) {
+	arenachunk_t *chunk;
+	byte *ptr;
+
+	size = PAD( size, sizeof( intptr_t ) ) + ARENA_HEADER;
+
+	chunk = arena->chunks;
+	if ( !chunk || chunk->size - chunk->used < size ) {
+		// chunk size is above ARENA_MAX_ALLOC so this will not recurse
+		chunk = Z_TagMalloc( ARENA_CHUNK, tag );
+		arena->zoneAllocs--; // not an oversized request
+		chunk->next = arena->chunks;
+		chunk->size = ARENA_CHUNK - PAD( sizeof( *chunk ), sizeof( intptr_t ) );
+		chunk->used = 0;
+		arena->chunks = chunk;
+		arena->numChunks++;
+	}
+
+	ptr = (byte *)chunk + PAD( sizeof( *chunk ), sizeof( intptr_t ) ) + chunk->used + ARENA_HEADER;
+	((int *)ptr)[-1] = ARENAID;
+	chunk->used += size;
+
+	arena->allocs++;
+	arena->bytes += size;
+
+	return ptr;
+}
+
+
+/*
+================
+Z_ArenaRelease
+
+Returns number of released arena allocations
+================
+*/
+static int Z_ArenaRelease( memarena_t *arena ) {
+	arenachunk_t *chunk, *next;
+	int count;
+
+	chunk = arena->chunks;
+	count = arena->allocs;
+
+	arena->chunks = NULL;
+	arena->numChunks = 0;
+	arena->allocs = 0;
+	arena->bytes = 0;
+
+	for ( ; chunk; chunk = next ) {
+		next = chunk->next;
+		Z_Free( chunk );
+	}
+
+	return count;
+}
+
+
 /*
 ========================
 Z_Free
@@ -1312,6 +1731,15 @@ void Z_Free( void *ptr ) {
 		Com_Error( ERR_DROP, "Z_Free: NULL pointer" );
 	}
 
+	// arena allocations are released only with their tag, a zone block
+	// has its site or debug size here, which are never negative
+	if ( ((int *)ptr)[-1] == ARENAID ) {
+#ifdef _DEBUG
+		Com_Error( ERR_FATAL, "Z_Free: freed an arena pointer" );
+#endif
+		return;
+	}
+
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID) {
 		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
@@ -1343,6 +1771,12 @@ void Z_Free( void *ptr ) {
 
 	zone->used -= block->size;
 
+	if ( block->site ) {
+		Com_MemSiteFree( block->site, block->size );
+	} else if ( memsitesActive ) {
+		memsites[0].frees++;
+	}
+
 	// set the block to something that should cause problems
 	// if it is referenced...
 	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
@@ -1353,7 +1787,7 @@ void Z_Free( void *ptr ) {
 	other = block->prev;
 	if ( other->tag == TAG_FREE ) {
 #ifdef USE_MULTI_SEGMENT
-		RemoveFree( other );
+		RemoveFree( zone, other );
 #endif
 		// merge with previous free block
 		MergeBlock( other, block );
@@ -1372,7 +1806,7 @@ void Z_Free( void *ptr ) {
 	other = block->next;
 	if ( other->tag == TAG_FREE ) {
 #ifdef USE_MULTI_SEGMENT
-		RemoveFree( other );
+		RemoveFree( zone, other );
 #endif
 		// merge the next free block onto the end
 		MergeBlock( block, other );
@@ -1404,6 +1838,16 @@ int Z_FreeTags( memtag_t tag ) {
 	}
 
 	count = 0;
+
+	if ( arenas[ tag ].name ) {
+		count = Z_ArenaRelease( &arenas[ tag ] );
+		// walk the zone only if there were oversized allocations
+		if ( arenas[ tag ].zoneAllocs == 0 ) {
+			return count;
+		}
+		arenas[ tag ].zoneAllocs = 0;
+	}
+
 	for ( block = zone->blocklist.next ; ; ) {
 		if ( block->tag == tag && block->id == ZONEID ) {
 			if ( block->prev->tag == TAG_FREE )
@@ -1441,11 +1885,23 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 #endif
 	memblock_t *base;
 	memzone_t *zone;
+	const void *caller;
+	int site;
+
+	caller = memCaller ? memCaller : RETURN_ADDRESS();
+	memCaller = NULL;
 
 	if ( tag == TAG_FREE ) {
 		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use with TAG_FREE" );
 	}
 
+	if ( arenas[ tag ].name ) {
+		if ( size <= ARENA_MAX_ALLOC ) {
+			return Z_ArenaAlloc( &arenas[ tag ], size, tag );
+		}
+		arenas[ tag ].zoneAllocs++;
+	}
+
 	if ( tag == TAG_SMALL ) {
 		zone = smallzone;
 	} else {
@@ -1476,7 +1932,7 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 #ifdef USE_MULTI_SEGMENT
 	base = SearchFree( zone, size );
 
-	RemoveFree( base );
+	RemoveFree( zone, base );
 #else
 
 	base = rover = zone->rover;
@@ -1529,8 +1985,17 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 #endif
 	zone->used += base->size;
 
+	site = 0;
+	if ( memsitesActive ) {
+		site = Com_MemSiteIndex( caller, zone == smallzone ? MEMSITE_SMALL : MEMSITE_ZONE );
+		if ( site ) {
+			Com_MemSiteAlloc( site, base->size );
+		}
+	}
+
 	base->tag = tag;			// no longer a free block
 	base->id = ZONEID;
+	base->site = site;
 
 #ifdef ZONE_DEBUG
 	base->d.label = label;
@@ -1562,6 +2027,10 @@ void *Z_Malloc( int size ) {
 
   //Z_CheckHeap ();	// DEBUG
 
+	if ( !memCaller ) {
+		memCaller = RETURN_ADDRESS();
+	}
+
 #ifdef ZONE_DEBUG
 	buf = Z_TagMallocDebug( size, TAG_GENERAL, label, file, line );
 #else
@@ -1580,10 +2049,16 @@ S_Malloc
 */
 #ifdef ZONE_DEBUG
 void *S_MallocDebug( int size, char *label, char *file, int line ) {
+	if ( !memCaller ) {
+		memCaller = RETURN_ADDRESS();
+	}
 	return Z_TagMallocDebug( size, TAG_SMALL, label, file, line );
 }
 #else
 void *S_Malloc( int size ) {
+	if ( !memCaller ) {
+		memCaller = RETURN_ADDRESS();
+	}
 	return Z_TagMalloc( size, TAG_SMALL );
 }
 #endif
@@ -1597,6 +2072,10 @@ Z_CheckHeap
 static void Z_CheckHeap( void ) {
 	const memblock_t *block;
 	const memzone_t *zone;
+#ifdef USE_MULTI_SEGMENT
+	const freeblock_t *fb;
+	int i;
+#endif
 
 	zone =  mainzone;
 	for ( block = zone->blocklist.next ; ; ) {
@@ -1620,6 +2099,26 @@ static void Z_CheckHeap( void ) {
 		}
 		block = block->next;
 	}
+
+#ifdef USE_MULTI_SEGMENT
+	for ( i = 0; i < FREE_LISTS; i++ ) {
+		if ( ( zone->freelist[i].next != &zone->freelist[i] ) != ( ( zone->freemask >> i ) & 1 ) ) {
+			Com_Error( ERR_FATAL, "Z_CheckHeap: bad free mask for size class %i", i );
+		}
+		for ( fb = zone->freelist[i].next; fb != &zone->freelist[i]; fb = fb->next ) {
+			block = (const memblock_t *)( (const byte *)fb - sizeof( *block ) );
+			if ( block->tag != TAG_FREE || block->id != ZONEID ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: used block in free list" );
+			}
+			if ( FreeListIndex( block->size ) != i ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: free block of size %i in size class %i", block->size, i );
+			}
+			if ( fb->next->prev != fb ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: free block doesn't have proper back link" );
+			}
+		}
+	}
+#endif
 }
 
 
@@ -1705,48 +2204,243 @@ typedef struct memstatic_s {
 	byte mem[2];
 } memstatic_t;
 
-#define MEM_STATIC(chr) { { NULL, NULL, PAD(sizeof(memstatic_t),4), TAG_STATIC, ZONEID }, {chr,'\0'} }
+#define MEM_STATIC(chr) { { NULL, NULL, PAD(sizeof(memstatic_t),4), TAG_STATIC, ZONEID }, {chr,'\0'} }
+
+static const memstatic_t emptystring =
+	MEM_STATIC( '\0' );
+
+static const memstatic_t numberstring[] = {
+	MEM_STATIC( '0' ),
+	MEM_STATIC( '1' ),
+	MEM_STATIC( '2' ),
+	MEM_STATIC( '3' ),
+	MEM_STATIC( '4' ),
+	MEM_STATIC( '5' ),
+	MEM_STATIC( '6' ),
+	MEM_STATIC( '7' ),
+	MEM_STATIC( '8' ),
+	MEM_STATIC( '9' )
+};
+#endif // USE_STATIC_TAGS
+
+/*
+========================
+CopyString
+
+ NOTE:	never write over the memory CopyString returns because
+		memory from a memstatic_t might be returned
+========================
+*/
+char *CopyString( const char *in ) {
+	char	*out;
+#ifdef USE_STATIC_TAGS
+	if (!in[0]) {
+		return ((char *)&emptystring) + sizeof(memblock_t);
+	}
+	else if (!in[1]) {
+		if (in[0] >= '0' && in[0] <= '9') {
+			return ((char *)&numberstring[in[0]-'0']) + sizeof(memblock_t);
+		}
+	}
+#endif
+	memCaller = RETURN_ADDRESS();
+	out = S_Malloc (strlen(in)+1);
+	strcpy (out, in);
+	return out;
+}
+
+
+/*
+==============================================================================
+
+Object pools
+
+Fixed-size objects are served from a per-thread cache without locking,
+caches exchange batches with the pool free list under a spinlock.
+Storage comes from Sys_AllocPages() so pools can grow from any thread
+
+==============================================================================
+*/
+
+#define MAX_POOLS		16
+#define POOL_CHUNK		(64*1024)
+#define POOL_BATCH		32		// objects moved between thread cache and pool at once
+
+#if defined( _MSC_VER )
+#define Pool_Lock( p )		while ( _InterlockedExchange( &(p)->lock, 1 ) ) { }
+#define Pool_Unlock( p )	_InterlockedExchange( &(p)->lock, 0 )
+#define Pool_Add( v, n )	_InterlockedExchangeAdd( &(v), (n) )
+#else
+#define Pool_Lock( p )		while ( __sync_lock_test_and_set( &(p)->lock, 1 ) ) { }
+#define Pool_Unlock( p )	__sync_lock_release( &(p)->lock )
+#define Pool_Add( v, n )	__sync_fetch_and_add( &(v), (n) )
+#endif
+
+typedef struct poolobj_s {
+	struct poolobj_s *next;
+} poolobj_t;
+
+struct mempool_s {
+	char		name[ 32 ];
+	int			index;
+	int			size;
+	poolobj_t	*free;		// shared free list
+	volatile long lock;
+	int			capacity;
+	volatile long allocs;
+	volatile long frees;
+	int			peak;
+};
+
+typedef struct {
+	poolobj_t	*head;
+	int			count;
+} poolcache_t;
+
+static mempool_t pools[ MAX_POOLS ];
+static int numPools;
+static QTHREADLOCAL poolcache_t poolCache[ MAX_POOLS ];
+
+
+/*
+================
+Pool_Create
+================
+*/
+mempool_t *Pool_Create( const char *name, int objectSize ) {
+	mempool_t *pool;
+
+	if ( numPools >= MAX_POOLS ) {
+		Com_Error( ERR_FATAL, "Pool_Create: MAX_POOLS hit" );
+	}
+
+	pool = &pools[ numPools ];
+	Q_strncpyz( pool->name, name, sizeof( pool->name ) );
+	pool->index = numPools;
+	pool->size = PAD( objectSize < sizeof( poolobj_t ) ? sizeof( poolobj_t ) : objectSize, sizeof( intptr_t ) );
+	if ( pool->size > POOL_CHUNK / 8 ) {
+		Com_Error( ERR_FATAL, "Pool_Create: object size %i is too large for %s", objectSize, name );
+	}
+
+	numPools++;
+
+	return pool;
+}
+
+
+/*
+================
+Pool_Grow
+
+Called with pool locked
+================
+*/
+static void Pool_Grow( mempool_t *pool ) {
+	byte *chunk;
+	poolobj_t *obj;
+	int i, count;
+
+	chunk = Sys_AllocPages( POOL_CHUNK, 0 );
+	if ( !chunk ) {
+		Pool_Unlock( pool );
+		Com_Error( ERR_FATAL, "Pool_Grow: failed to allocate %s objects", pool->name );
+	}
+
+	count = POOL_CHUNK / pool->size;
+	for ( i = count - 1; i >= 0; i-- ) {
+		obj = (poolobj_t *)( chunk + i * pool->size );
+		obj->next = pool->free;
+		pool->free = obj;
+	}
+
+	pool->capacity += count;
+}
+
+
+/*
+================
+Pool_Alloc
+================
+*/
+void *Pool_Alloc( mempool_t *pool ) {
+	poolcache_t *cache = &poolCache[ pool->index ];
+	poolobj_t *obj;
+	int inuse;
+
+	if ( !cache->head ) {
+		// refill thread cache from the shared list
+		Pool_Lock( pool );
+		if ( !pool->free ) {
+			Pool_Grow( pool );
+		}
+		while ( pool->free && cache->count < POOL_BATCH ) {
+			obj = pool->free;
+			pool->free = obj->next;
+			obj->next = cache->head;
+			cache->head = obj;
+			cache->count++;
+		}
+		Pool_Unlock( pool );
+	}
+
+	obj = cache->head;
+	cache->head = obj->next;
+	cache->count--;
 
-static const memstatic_t emptystring =
-	MEM_STATIC( '\0' );
+	inuse = Pool_Add( pool->allocs, 1 ) + 1 - pool->frees;
+	if ( inuse > pool->peak ) {
+		pool->peak = inuse; // approximate with several threads
+	}
 
-static const memstatic_t numberstring[] = {
-	MEM_STATIC( '0' ),
-	MEM_STATIC( '1' ),
-	MEM_STATIC( '2' ),
-	MEM_STATIC( '3' ),
-	MEM_STATIC( '4' ),
-	MEM_STATIC( '5' ),
-	MEM_STATIC( '6' ),
-	MEM_STATIC( '7' ),
-	MEM_STATIC( '8' ),
-	MEM_STATIC( '9' )
-};
-#endif // USE_STATIC_TAGS
+	return obj;
+}
 
-/*
-========================
-CopyString
 
- NOTE:	never write over the memory CopyString returns because
-		memory from a memstatic_t might be returned
-========================
+/*
+================
+Pool_Free
+================
 */
-char *CopyString( const char *in ) {
-	char	*out;
-#ifdef USE_STATIC_TAGS
-	if (!in[0]) {
-		return ((char *)&emptystring) + sizeof(memblock_t);
-	}
-	else if (!in[1]) {
-		if (in[0] >= '0' && in[0] <= '9') {
-			return ((char *)&numberstring[in[0]-'0']) + sizeof(memblock_t);
+void Pool_Free( mempool_t *pool, void *ptr ) {
+	poolcache_t *cache = &poolCache[ pool->index ];
+	poolobj_t *obj = ptr;
+
+	obj->next = cache->head;
+	cache->head = obj;
+	cache->count++;
+
+	Pool_Add( pool->frees, 1 );
+
+	if ( cache->count >= POOL_BATCH * 2 ) {
+		// return a batch to the shared list
+		Pool_Lock( pool );
+		while ( cache->count > POOL_BATCH ) {
+			obj = cache->head;
+			cache->head = obj->next;
+			cache->count--;
+			obj->next = pool->free;
+			pool->free = obj;
 		}
+		Pool_Unlock( pool );
+	}
+}
+
+
+/*
+================
+Pool_Meminfo
+================
+*/
+static void Pool_Meminfo( void ) {
+	const mempool_t *pool;
+	int i;
+
+	for ( i = 0; i < numPools; i++ ) {
+		pool = &pools[ i ];
+		Com_Printf( "%8i bytes in %s pool: %i of %i objects of %i bytes used, peak %i\n",
+			pool->capacity * pool->size, pool->name, (int)( pool->allocs - pool->frees ),
+			pool->capacity, pool->size, pool->peak );
 	}
-#endif
-	out = S_Malloc (strlen(in)+1);
-	strcpy (out, in);
-	return out;
 }
 
 
@@ -1828,7 +2522,8 @@ static const char *tagName[ TAG_COUNT ] = {
 	"RENDERER",
 	"CLIENTS",
 	"SMALL",
-	"STATIC"
+	"STATIC",
+	"FILE-CACHE"
 };
 
 typedef struct zone_stats_s {
@@ -1922,6 +2617,7 @@ Com_Meminfo_f
 static void Com_Meminfo_f( void ) {
 	zone_stats_t st;
 	int		unused;
+	int		i;
 
 	Com_Printf( "%8i bytes total hunk\n", s_hunkTotal );
 	Com_Printf( "\n" );
@@ -1962,6 +2658,15 @@ static void Com_Meminfo_f( void ) {
 		Com_Printf( "        (largest: %i bytes, smallest: %i bytes)\n\n", st.freeLargest, st.freeSmallest );
 	}
 
+	for ( i = 0; i < TAG_COUNT; i++ ) {
+		const memarena_t *arena = &arenas[ i ];
+		if ( arena->name ) {
+			Com_Printf( "%8i bytes in %i %s arena allocations, %i chunks\n", arena->bytes, arena->allocs, arena->name, arena->numChunks );
+		}
+	}
+	Pool_Meminfo();
+	Com_Printf( "\n" );
+
 	Zone_Stats( "small", smallzone, !Q_stricmp( Cmd_Argv(1), "small" ) || !Q_stricmp( Cmd_Argv(1), "all" ), &st );
 	Com_Printf( "%8i bytes total small zone\n\n", smallzone->size );
 	Com_Printf( "%8i bytes in %i small zone blocks%s\n", st.zoneBytes, st.zoneBlocks,
@@ -2023,6 +2728,29 @@ void Com_TouchMemory( void ) {
 }
 
 
+static cvar_t *com_hugePages;
+static cvar_t *com_prefaultMemory;
+static int s_zoneTotal;		// the initial zone block, later segments are calloc'ed
+
+/*
+=================
+Com_PrefaultMemory
+
+Write to every page so it is mapped now rather than during gameplay,
+the kernel places each page on the NUMA node of the first touching CPU.
+Contents are written back unchanged so memory already in use is kept
+=================
+*/
+static void Com_PrefaultMemory( byte *buf, int size ) {
+	volatile byte *p = buf;
+	int i;
+
+	for ( i = 0; i < size; i += 4096 ) {
+		p[ i ] = p[ i ];
+	}
+}
+
+
 /*
 =================
 Com_InitSmallZoneMemory
@@ -2065,11 +2793,25 @@ static void Com_InitZoneMemory( void ) {
 #endif
 		mainZoneSize = cv->integer * 1024 * 1024;
 
-	mainzone = calloc( mainZoneSize, 1 );
+	com_hugePages = Cvar_Get( "com_hugePages", "0", CVAR_LATCH | CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( com_hugePages, "0", "2", CV_INTEGER );
+	Cvar_SetDescription( com_hugePages, "Back zone and hunk memory with huge pages to reduce TLB misses:\n"
+		" 0 - disabled\n"
+		" 1 - transparent huge pages\n"
+		" 2 - explicit huge pages, falls back to regular pages if none are reserved\n"
+		"The zone is allocated before configs are executed, so for it this must be set on the command line" );
+
+	mainzone = Sys_AllocPages( mainZoneSize, com_hugePages->integer );
 	if ( !mainzone ) {
 		Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", mainZoneSize / (1024*1024) );
 	}
 	Z_ClearZone( mainzone, mainzone, mainZoneSize, 1 );
+	s_zoneTotal = mainZoneSize;
+
+	// search paths live until filesystem shutdown
+	Z_InitArena( TAG_SEARCH_PATH, "search path" );
+	Z_InitArena( TAG_SEARCH_PACK, "search pack" );
+	Z_InitArena( TAG_SEARCH_DIR, "search dir" );
 }
 
 
@@ -2155,6 +2897,8 @@ void Hunk_SmallLog( void ) {
 #endif
 
 
+static void Com_InitMapCache( void );
+
 /*
 =================
 Com_InitHunkMemory
@@ -2178,15 +2922,30 @@ static void Com_InitHunkMemory( void ) {
 
 	s_hunkTotal = cv->integer * 1024 * 1024;
 
-	s_hunkData = calloc( s_hunkTotal + 63, 1 );
+	// page aligned
+	s_hunkData = Sys_AllocPages( s_hunkTotal, com_hugePages->integer );
 	if ( !s_hunkData ) {
 		Com_Error( ERR_FATAL, "Hunk data failed to allocate %i megs", s_hunkTotal / (1024*1024) );
 	}
 
-	// cacheline align
-	s_hunkData = PADP( s_hunkData, 64 );
+	// done here rather than at zone allocation so configs and com_affinityMask apply to both,
+	// no other thread runs yet
+	com_prefaultMemory = Cvar_Get( "com_prefaultMemory", "0", CVAR_LATCH | CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( com_prefaultMemory, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( com_prefaultMemory, "Touch all zone and hunk pages at startup instead of on first use. "
+		"With com_affinityMask set, pages the zone has not used yet and the hunk are placed on the NUMA node of the pinned CPUs" );
+
+	if ( com_prefaultMemory->integer ) {
+		Com_PrefaultMemory( (byte *)mainzone, s_zoneTotal );
+		Com_PrefaultMemory( s_hunkData, s_hunkTotal );
+	}
+
 	Hunk_Clear();
 
+	Com_InitMapCache();
+
+	Com_InitMemSites();
+
 	Cmd_AddCommand( "meminfo", Com_Meminfo_f );
 #ifdef ZONE_DEBUG
 	Cmd_AddCommand( "zonelog", Z_LogHeap );
@@ -2223,6 +2982,8 @@ The server calls this after the level and game VM have been loaded
 void Hunk_SetMark( void ) {
 	hunk_low.mark = hunk_low.permanent;
 	hunk_high.mark = hunk_high.permanent;
+
+	Com_MemSitesSetHunkMark();
 }
 
 
@@ -2236,6 +2997,8 @@ The client calls this before starting a vid_restart or snd_restart
 void Hunk_ClearToMark( void ) {
 	hunk_low.permanent = hunk_low.temp = hunk_low.mark;
 	hunk_high.permanent = hunk_high.temp = hunk_high.mark;
+
+	Com_MemSitesClearHunk( qtrue );
 }
 
 
@@ -2285,6 +3048,8 @@ void Hunk_Clear( void ) {
 	hunk_permanent = &hunk_low;
 	hunk_temp = &hunk_high;
 
+	Com_MemSitesClearHunk( qfalse );
+
 	Com_Printf( "Hunk_Clear: reset the hunk ok\n" );
 	VM_Clear();
 #ifdef HUNK_DEBUG
@@ -2370,6 +3135,13 @@ void *Hunk_Alloc( int size, ha_pref preference ) {
 
 	hunk_permanent->temp = hunk_permanent->permanent;
 
+	if ( memsitesActive ) {
+		int site = Com_MemSiteIndex( RETURN_ADDRESS(), MEMSITE_HUNK );
+		if ( site ) {
+			Com_MemSiteAlloc( site, size );
+		}
+	}
+
 	Com_Memset( buf, 0, size );
 
 #ifdef HUNK_DEBUG
@@ -2501,6 +3273,309 @@ void Hunk_ClearTempMemory( void ) {
 	}
 }
 
+/*
+===================================================================
+
+MAP DATA CACHE
+
+Keeps fully loaded map data (collision model, bot navigation file)
+outside of the hunk so it survives Hunk_Clear() and can be reused
+when the same map is loaded again. Entries are validated against
+checksum of the pak the source file comes from.
+===================================================================
+*/
+
+#define MAX_MAPCACHE_MAPS		16
+#define MAX_MAPCACHE_ENTRIES	(MAX_MAPCACHE_MAPS*2)
+#define MAPCACHE_CHUNK_SIZE		(1024*1024)
+
+typedef struct mapCacheChunk_s {
+	struct mapCacheChunk_s *next;
+	byte	*data;
+	int		size;
+	int		used;
+} mapCacheChunk_t;
+
+typedef struct {
+	char	qpath[MAX_QPATH];
+	char	type[16];
+	int		pakChecksum;
+	int		length;
+	int		lastUsed;
+	qboolean valid;
+	void	*root;			// first allocation made for the entry
+	int		rootSize;
+	int		totalSize;
+	mapCacheChunk_t *chunks;
+} mapCacheEntry_t;
+
+static mapCacheEntry_t	mapCache[MAX_MAPCACHE_ENTRIES];
+static mapCacheEntry_t	*mapCacheBuild;		// entry being filled
+static int				mapCacheSequence;
+static cvar_t			*com_mapCache;
+
+
+/*
+=================
+Com_MapCacheFree
+=================
+*/
+static void Com_MapCacheFree( mapCacheEntry_t *e ) {
+	mapCacheChunk_t *chunk, *next;
+
+	for ( chunk = e->chunks; chunk; chunk = next ) {
+		next = chunk->next;
+		free( chunk );
+	}
+
+	if ( mapCacheBuild == e ) {
+		mapCacheBuild = NULL;
+	}
+
+	Com_Memset( e, 0, sizeof( *e ) );
+}
+
+
+/*
+=================
+Com_MapCacheFlush
+=================
+*/
+static void Com_MapCacheFlush( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_MAPCACHE_ENTRIES; i++ ) {
+		if ( mapCache[i].chunks ) {
+			Com_MapCacheFree( &mapCache[i] );
+		}
+	}
+}
+
+
+/*
+=================
+Com_MapCacheFind
+
+Returns data stored for the file or NULL if there is no valid entry
+=================
+*/
+void *Com_MapCacheFind( const char *qpath, const char *type, int *size ) {
+	mapCacheEntry_t *e;
+	int pakChecksum, length;
+	int i;
+
+	if ( !com_mapCache || com_mapCache->integer <= 0 ) {
+		Com_MapCacheFlush();
+		return NULL;
+	}
+
+	if ( !FS_FileIdentity( qpath, &pakChecksum, &length ) ) {
+		return NULL;
+	}
+
+	for ( i = 0, e = mapCache; i < MAX_MAPCACHE_ENTRIES; i++, e++ ) {
+		if ( !e->valid || Q_stricmp( e->qpath, qpath ) || strcmp( e->type, type ) ) {
+			continue;
+		}
+		if ( e->pakChecksum != pakChecksum || e->length != length ) {
+			// file has been changed
+			Com_MapCacheFree( e );
+			continue;
+		}
+		e->lastUsed = ++mapCacheSequence;
+		if ( size ) {
+			*size = e->rootSize;
+		}
+		return e->root;
+	}
+
+	return NULL;
+}
+
+
+/*
+=================
+Com_MapCacheBegin
+
+Starts new cache entry, all following Com_MapCacheAlloc() calls will
+allocate memory for it until Com_MapCacheEnd() is called
+=================
+*/
+qboolean Com_MapCacheBegin( const char *qpath, const char *type ) {
+	mapCacheEntry_t *e, *oldest;
+	int pakChecksum, length;
+	int i, count;
+
+	if ( mapCacheBuild ) {
+		// previous load has been aborted
+		Com_MapCacheFree( mapCacheBuild );
+	}
+
+	if ( !com_mapCache || com_mapCache->integer <= 0 ) {
+		Com_MapCacheFlush();
+		return qfalse;
+	}
+
+	if ( !FS_FileIdentity( qpath, &pakChecksum, &length ) ) {
+		return qfalse;
+	}
+
+	// evict least recently used entries of the same type
+	for ( ;; ) {
+		oldest = NULL;
+		count = 0;
+		for ( i = 0, e = mapCache; i < MAX_MAPCACHE_ENTRIES; i++, e++ ) {
+			if ( !e->valid || strcmp( e->type, type ) ) {
+				continue;
+			}
+			if ( !Q_stricmp( e->qpath, qpath ) ) {
+				// replace outdated entry
+				Com_MapCacheFree( e );
+				continue;
+			}
+			if ( !oldest || e->lastUsed < oldest->lastUsed ) {
+				oldest = e;
+			}
+			count++;
+		}
+		if ( count < com_mapCache->integer ) {
+			break;
+		}
+		Com_MapCacheFree( oldest );
+	}
+
+	oldest = NULL;
+	for ( i = 0, e = mapCache; i < MAX_MAPCACHE_ENTRIES; i++, e++ ) {
+		if ( !e->valid ) {
+			break;
+		}
+		if ( !oldest || e->lastUsed < oldest->lastUsed ) {
+			oldest = e;
+		}
+	}
+
+	if ( i == MAX_MAPCACHE_ENTRIES ) {
+		e = oldest;
+		Com_MapCacheFree( e );
+	}
+
+	Q_strncpyz( e->qpath, qpath, sizeof( e->qpath ) );
+	Q_strncpyz( e->type, type, sizeof( e->type ) );
+	e->pakChecksum = pakChecksum;
+	e->length = length;
+
+	mapCacheBuild = e;
+
+	return qtrue;
+}
+
+
+/*
+=================
+Com_MapCacheAlloc
+
+Returns 0 filled memory
+=================
+*/
+void *Com_MapCacheAlloc( int size ) {
+	mapCacheEntry_t *e = mapCacheBuild;
+	mapCacheChunk_t *chunk;
+	byte	*buf;
+	int		chunkSize;
+
+	if ( !e ) {
+		Com_Error( ERR_FATAL, "Com_MapCacheAlloc: no active entry" );
+	}
+
+	size = PAD( size, 16 );
+
+	chunk = e->chunks;
+	if ( !chunk || chunk->used + size > chunk->size ) {
+		chunkSize = MAX( size, MAPCACHE_CHUNK_SIZE );
+		chunk = calloc( sizeof( *chunk ) + chunkSize + 15, 1 );
+		if ( !chunk ) {
+			Com_Error( ERR_FATAL, "Com_MapCacheAlloc: failed on allocation of %i bytes", size );
+		}
+		chunk->data = PADP( chunk + 1, 16 );
+		chunk->size = chunkSize;
+		chunk->next = e->chunks;
+		e->chunks = chunk;
+		e->totalSize += chunkSize;
+	}
+
+	buf = chunk->data + chunk->used;
+	chunk->used += size;
+
+	if ( !e->root ) {
+		e->root = buf;
+		e->rootSize = size;
+	}
+
+	return buf;
+}
+
+
+/*
+=================
+Com_MapCacheEnd
+=================
+*/
+void Com_MapCacheEnd( qboolean success ) {
+	mapCacheEntry_t *e = mapCacheBuild;
+
+	if ( !e ) {
+		return;
+	}
+
+	mapCacheBuild = NULL;
+
+	if ( !success || !e->root ) {
+		Com_MapCacheFree( e );
+		return;
+	}
+
+	e->valid = qtrue;
+	e->lastUsed = ++mapCacheSequence;
+}
+
+
+/*
+=================
+Com_MapCacheList_f
+=================
+*/
+static void Com_MapCacheList_f( void ) {
+	const mapCacheEntry_t *e;
+	int i, count, total;
+
+	count = total = 0;
+	for ( i = 0, e = mapCache; i < MAX_MAPCACHE_ENTRIES; i++, e++ ) {
+		if ( !e->valid ) {
+			continue;
+		}
+		Com_Printf( "%9i %-4s %s\n", e->totalSize, e->type, e->qpath );
+		total += e->totalSize;
+		count++;
+	}
+
+	Com_Printf( "%i entries, %i bytes in map cache\n", count, total );
+}
+
+
+/*
+=================
+Com_InitMapCache
+=================
+*/
+static void Com_InitMapCache( void ) {
+	com_mapCache = Cvar_Get( "com_mapCache", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( com_mapCache, "0", XSTRING( MAX_MAPCACHE_MAPS ), CV_INTEGER );
+	Cvar_SetDescription( com_mapCache, "Number of recently loaded maps to keep collision and bot navigation data for, 0 disables caching" );
+
+	Cmd_AddCommand( "mapcachelist", Com_MapCacheList_f );
+}
+
+
 /*
 ===================================================================
 
@@ -3645,6 +4720,14 @@ void Com_Init( char *commandLine ) {
 	com_dedicated = Cvar_Get( "dedicated", "0", CVAR_LATCH );
 	Cvar_CheckRange( com_dedicated, "0", "2", CV_INTEGER );
 #endif
+#ifdef USE_AFFINITY_MASK
+	// pin before hunk memory is touched for NUMA-local placement
+	com_affinityMask = Cvar_Get( "com_affinityMask", "0", CVAR_ARCHIVE_ND );
+	com_affinityMask->modified = qfalse;
+	if ( com_affinityMask->integer )
+		Sys_SetAffinityMask( com_affinityMask->integer );
+#endif
+
 	// allocate the stack based hunk allocator
 	Com_InitHunkMemory();
 
@@ -3664,10 +4747,6 @@ void Com_Init( char *commandLine ) {
 	Cvar_CheckRange( com_yieldCPU, "0", "16", CV_INTEGER );
 #endif
 
-#ifdef USE_AFFINITY_MASK
-	com_affinityMask = Cvar_Get( "com_affinityMask", "0", CVAR_ARCHIVE_ND );
-	com_affinityMask->modified = qfalse;
-#endif
 
 	com_blood = Cvar_Get( "com_blood", "1", CVAR_ARCHIVE_ND );
 
@@ -3749,11 +4828,6 @@ void Com_Init( char *commandLine ) {
 	}
 	Com_Printf( "%s\n", Cvar_VariableString( "sys_cpustring" ) );
 
-#ifdef USE_AFFINITY_MASK
-	if ( com_affinityMask->integer )
-		Sys_SetAffinityMask( com_affinityMask->integer );
-#endif
-
 	// Pick a random port value
 	Com_RandomBytes( (byte*)&qport, sizeof( qport ) );
 	Netchan_Init( qport & 0xffff );
@@ -4192,18 +5266,26 @@ void Com_Frame( qboolean noDelay ) {
 	// trace optimization tracking
 	//
 	if ( com_showtrace->integer ) {
+		int c_traces, c_brush_traces, c_patch_traces;
+		int	c_pointcontents;
+		int	c_hits, c_misses;
 
-		extern	int c_traces, c_brush_traces, c_patch_traces;
-		extern	int	c_pointcontents;
+		CM_TraceStats( &c_traces, &c_brush_traces, &c_patch_traces, &c_pointcontents );
 
 		Com_Printf ("%4i traces  (%ib %ip) %4i points\n", c_traces,
 			c_brush_traces, c_patch_traces, c_pointcontents);
-		c_traces = 0;
-		c_brush_traces = 0;
-		c_patch_traces = 0;
-		c_pointcontents = 0;
+
+		CM_PointCacheStats( &c_hits, &c_misses );
+
+		Com_Printf ("%4i point cache hits %4i misses\n", c_hits, c_misses);
 	}
 
+	CM_InvalidatePointCache();
+
+	VM_ProfileFrame();
+
+	Com_MemSitesFrame();
+
 	com_frameNumber++;
 }
 
@@ -32,6 +32,21 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 #include "unzip.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// full barrier atomics on volatile long, all return the previous value
+#ifdef _MSC_VER
+#define FS_AtomicInc( v )			( _InterlockedIncrement( &(v) ) - 1 )
+#define FS_AtomicAdd( v, n )		_InterlockedExchangeAdd( &(v), (n) )
+#define FS_AtomicCAS( v, o, n )		_InterlockedCompareExchange( &(v), (n), (o) )
+#else
+#define FS_AtomicInc( v )			__sync_fetch_and_add( &(v), 1 )
+#define FS_AtomicAdd( v, n )		__sync_fetch_and_add( &(v), (n) )
+#define FS_AtomicCAS( v, o, n )		__sync_val_compare_and_swap( &(v), (o), (n) )
+#endif
+#define FS_AtomicGet( v )			FS_AtomicAdd( v, 0 )
 
 /*
 =============================================================================
@@ -248,10 +263,17 @@ typedef struct pack_s {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	fileInPack_t*	*sortedFiles;				// files in FS_ListCompare() order, built on first listing
 	int				index;
 
 	int				handleUsed;
 
+	byte			*mapData;					// whole pk3 mapped by FS_MapPak()
+	size_t			mapSize;
+	fileId_t		mapId;						// file version when mapped
+	int				mapCheckTime;				// com_frameTime of the last mapId check
+	qboolean		mapFailed;
+
 #ifdef USE_HANDLE_CACHE
 	struct pack_s	*next_h;						// double-linked list of unreferenced paks with open file handles
 	struct pack_s	*prev_h;
@@ -266,7 +288,8 @@ typedef struct pack_s {
 	qboolean		touched;
 	struct pack_s	*next;
 	struct pack_s	*prev;
-	int				checksumFeed;
+	int				checksumFeed;				// pure_checksum is valid for this feed
+	qboolean		pureChecksumValid;
 	int				*headerLongs;
 	int				numHeaderLongs;
 #endif
@@ -288,6 +311,7 @@ typedef struct searchpath_s {
 	pack_t		*pack;		// only one of pack / dir will be non NULL
 	directory_t	*dir;
 	dirPolicy_t	policy;
+	int			order;		// position in fs_searchpaths when file index was built
 } searchpath_t;
 
 static	char		fs_gamedir[MAX_OSPATH];	// this will be a single file name with no separators
@@ -317,6 +341,9 @@ static	int			fs_dirCount;			// total number of directories in searchpath
 
 static	int			fs_checksumFeed;
 
+static	void		FS_IndexAddFile( const char *path, const char *gamedir, const char *qpath );
+static	void		FS_IndexAddSVFile( const char *filename );
+
 typedef union qfile_gus {
 	FILE*		o;
 	unzFile		z;
@@ -369,7 +396,9 @@ void Com_AppendCDKey( const char *filename );
 void Com_ReadCDKey( const char *filename );
 
 static int FS_GetModList( char *listbuf, int bufsize );
+static void FS_FreeModList( void );
 static void FS_CheckIdPaks( void );
+static void FS_AsyncShutdown( void );
 void FS_Reload( void );
 
 
@@ -407,6 +436,28 @@ static qboolean FS_PakIsPure( const pack_t *pack ) {
 }
 
 
+/*
+=================
+FS_PakPureChecksum
+
+The pure checksum depends from the checksum feed of the current map,
+it is only computed for paks that are actually asked for
+=================
+*/
+static int FS_PakPureChecksum( pack_t *pack ) {
+#ifdef USE_PK3_CACHE
+	if ( !pack->pureChecksumValid || pack->checksumFeed != fs_checksumFeed ) {
+		pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
+		pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
+		pack->pure_checksum = LittleLong( pack->pure_checksum );
+		pack->checksumFeed = fs_checksumFeed;
+		pack->pureChecksumValid = qtrue;
+	}
+#endif
+	return pack->pure_checksum;
+}
+
+
 /*
 =================
 FS_LoadStack
@@ -606,6 +657,7 @@ Creates any directories needed to store the given filename
 static qboolean FS_CreatePath( const char *OSPath ) {
 	char	path[MAX_OSPATH*2+1];
 	char	*ofs;
+	qboolean created;
 	
 	// make absolutely sure that it can't back up the path
 	// FIXME: is c: allowed???
@@ -617,14 +669,23 @@ static qboolean FS_CreatePath( const char *OSPath ) {
 	Q_strncpyz( path, OSPath, sizeof( path ) );
 	// Make sure we have OS correct slashes
 	FS_ReplaceSeparators( path );
+	created = qfalse;
 	for ( ofs = path + 1; *ofs; ofs++ ) {
 		if ( *ofs == PATH_SEP ) {
 			// create the directory
 			*ofs = '\0';
-			Sys_Mkdir( path );
+			if ( Sys_Mkdir( path ) ) {
+				created = qtrue;
+			}
 			*ofs = PATH_SEP;
 		}
 	}
+
+	// may be a new mod directory
+	if ( created ) {
+		FS_FreeModList();
+	}
+
 	return qfalse;
 }
 
@@ -702,7 +763,8 @@ FS_AllowedExtension
 */
 qboolean FS_AllowedExtension( const char *fileName, qboolean allowPk3s, const char **ext ) 
 {
-	static const char *extlist[] =	{ "dll", "exe", "so", "dylib", "qvm", "pk3" };
+	// engine-only paths (allowPk3s) may still write downloaded paks and the jit cache
+	static const char *extlist[] =	{ "dll", "exe", "so", "dylib", "qvm", "jit", "pk3" };
 	const char *e;
 	int i, n;
 
@@ -726,7 +788,7 @@ qboolean FS_AllowedExtension( const char *fileName, qboolean allowPk3s, const ch
 	e++; // skip '.'
 
 	if ( allowPk3s )
-		n = ARRAY_LEN( extlist ) - 1;
+		n = ARRAY_LEN( extlist ) - 2;
 	else
 		n = ARRAY_LEN( extlist );
 	
@@ -910,6 +972,8 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 	fd->handleSync = qfalse;
 	fd->zipFile = qfalse;
 
+	FS_IndexAddSVFile( filename );
+
 	return f;
 }
 
@@ -1026,6 +1090,11 @@ void FS_SV_Rename( const char *from, const char *to ) {
 		FS_CopyFile( from_ospath, to_ospath );
 		FS_Remove( from_ospath );
 	}
+
+	FS_IndexAddSVFile( to );
+
+	// finished downloads may add a mod
+	FS_FreeModList();
 }
 
 
@@ -1065,6 +1134,11 @@ void FS_Rename( const char *from, const char *to ) {
 		FS_CopyFile( from_ospath, to_ospath );
 		FS_Remove( from_ospath );
 	}
+
+	FS_IndexAddFile( fs_homepath->string, fs_gamedir, to );
+
+	// finished downloads may add a mod
+	FS_FreeModList();
 }
 
 #ifdef USE_HANDLE_CACHE
@@ -1256,6 +1330,8 @@ fileHandle_t FS_FOpenFileWrite( const char *filename ) {
 	fd->handleSync = qfalse;
 	fd->zipFile = qfalse;
 
+	FS_IndexAddFile( fs_homepath->string, fs_gamedir, filename );
+
 	return f;
 }
 
@@ -1310,6 +1386,8 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 	fd->handleSync = qfalse;
 	fd->zipFile = qfalse;
 
+	FS_IndexAddFile( fs_homepath->string, fs_gamedir, filename );
+
 	return f;
 }
 
@@ -1458,10 +1536,7 @@ void FS_RestorePure( void )
 }
 
 
-static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakFile, qboolean uniqueFILE ) {
-	fileHandleData_t *f;
-	unz_s *zfi;
-	FILE *temp;
+static void FS_MarkPakReferenced( pack_t *pak, const fileInPack_t *pakFile ) {
 
 	// mark the pak as having been referenced and mark specifics on cgame and ui
 	// these are loaded from all pk3s
@@ -1476,6 +1551,15 @@ static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakF
 	if ( !( pak->referenced & FS_UI_REF ) && !strcmp( pakFile->name, "vm/ui.qvm" ) ) {
 		pak->referenced |= FS_UI_REF;
 	}
+}
+
+
+static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakFile, qboolean uniqueFILE ) {
+	fileHandleData_t *f;
+	unz_s *zfi;
+	FILE *temp;
+
+	FS_MarkPakReferenced( pak, pakFile );
 
 	if ( !pak->handle ) {
 		pak->handle = unzOpen( pak->pakFilename );
@@ -1541,6 +1625,369 @@ static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakF
 }
 
 
+/*
+=================================================================================
+
+Merged file index
+
+All files of all search paths in a single hash table, so a lookup is one
+probe instead of a walk over every pak and a failing fopen() for every
+directory. Sources of the same name are kept in search path order so pure
+and directory policy checks are still applied on lookup.
+
+Directories are scanned at startup, files written through the filesystem
+are added on the fly. Files created by other programs need fs_restart.
+
+=================================================================================
+*/
+
+#define FS_INDEX_MAX_DEPTH	16
+
+typedef struct fsIndexEntry_s {
+	struct fsIndexEntry_s	*next;	// hash chain
+	const char		*name;
+	searchpath_t	*search;
+	fileInPack_t	*pakFile;		// NULL for a file in directory
+} fsIndexEntry_t;
+
+typedef struct {
+	char		*names;				// zero-separated relative file names
+	int			namesSize;
+	int			namesUsed;
+	int			count;
+	qboolean	overflow;
+} fsIndexScan_t;
+
+static	cvar_t			*fs_index;
+static	fsIndexEntry_t	**fs_indexTable;
+static	int				fs_indexSize;	// power of two, 0 if index is not used
+static	int				fs_indexFiles;
+
+
+/*
+=================
+FS_IndexAddName
+=================
+*/
+static void FS_IndexAddName( fsIndexScan_t *scan, const char *prefix, const char *name ) {
+	char path[ MAX_OSPATH ];
+	char *buf;
+	int len;
+
+	if ( *prefix )
+		len = Com_sprintf( path, sizeof( path ), "%s/%s", prefix, name );
+	else
+		len = Com_sprintf( path, sizeof( path ), "%s", name );
+
+	if ( scan->namesUsed + len + 1 > scan->namesSize ) {
+		scan->namesSize = ( scan->namesSize + len + 1 ) * 2;
+		buf = Z_Malloc( scan->namesSize );
+		if ( scan->names ) {
+			Com_Memcpy( buf, scan->names, scan->namesUsed );
+			Z_Free( scan->names );
+		}
+		scan->names = buf;
+	}
+
+	Com_Memcpy( scan->names + scan->namesUsed, path, len + 1 );
+	scan->namesUsed += len + 1;
+	scan->count++;
+}
+
+
+/*
+=================
+FS_IndexScanDir
+=================
+*/
+static void FS_IndexScanDir( fsIndexScan_t *scan, const char *root, const char *subdir, int depth ) {
+	char	ospath[ MAX_OSPATH * 2 + 1 ];
+	char	**list;
+	int		i, num;
+
+	if ( depth > FS_INDEX_MAX_DEPTH ) {
+		scan->overflow = qtrue;
+		return;
+	}
+
+	if ( *subdir )
+		Com_sprintf( ospath, sizeof( ospath ), "%s%c%s", root, PATH_SEP, subdir );
+	else
+		Q_strncpyz( ospath, root, sizeof( ospath ) );
+
+	list = Sys_ListFiles( ospath, "", NULL, &num, qfalse );
+	if ( num >= MAX_FOUND_FILES - 1 )
+		scan->overflow = qtrue;
+	for ( i = 0; i < num; i++ ) {
+		FS_IndexAddName( scan, subdir, list[i] );
+	}
+	Sys_FreeFileList( list );
+
+	list = Sys_ListFiles( ospath, "/", NULL, &num, qfalse );
+	if ( num >= MAX_FOUND_FILES - 1 )
+		scan->overflow = qtrue;
+	for ( i = 0; i < num && !scan->overflow; i++ ) {
+		char path[ MAX_OSPATH ];
+		if ( !strcmp( list[i], "." ) || !strcmp( list[i], ".." ) )
+			continue;
+		if ( *subdir )
+			Com_sprintf( path, sizeof( path ), "%s/%s", subdir, list[i] );
+		else
+			Q_strncpyz( path, list[i], sizeof( path ) );
+		FS_IndexScanDir( scan, root, path, depth + 1 );
+	}
+	Sys_FreeFileList( list );
+}
+
+
+/*
+=================
+FS_IndexInsert
+
+Keeps sources of the same file in search path order
+=================
+*/
+static void FS_IndexInsert( fsIndexEntry_t *entry, long fullHash ) {
+	fsIndexEntry_t **prev;
+
+	prev = &fs_indexTable[ fullHash & ( fs_indexSize - 1 ) ];
+	while ( *prev && (*prev)->search->order < entry->search->order ) {
+		prev = &(*prev)->next;
+	}
+
+	entry->next = *prev;
+	*prev = entry;
+}
+
+
+/*
+=================
+FS_FreeIndex
+=================
+*/
+static void FS_FreeIndex( void ) {
+	FS_AsyncShutdown();
+
+	if ( fs_indexTable ) {
+		Z_Free( fs_indexTable );
+	}
+	fs_indexTable = NULL;
+	fs_indexSize = 0;
+	fs_indexFiles = 0;
+}
+
+
+/*
+=================
+FS_BuildIndex
+=================
+*/
+static void FS_BuildIndex( void ) {
+	fsIndexScan_t	scan;
+	searchpath_t	*sp;
+	fsIndexEntry_t	*entry;
+	int				*dirStart, *dirCount;
+	int				i, n, numPaths, total, size;
+	const char		*name;
+	char			*names;
+	char			root[ MAX_OSPATH * 2 + 1 ];
+
+	FS_FreeIndex();
+
+	if ( !fs_index->integer )
+		return;
+
+	numPaths = 0;
+	for ( sp = fs_searchpaths; sp; sp = sp->next ) {
+		sp->order = numPaths++;
+	}
+
+	dirStart = Z_Malloc( numPaths * 2 * sizeof( int ) );
+	dirCount = dirStart + numPaths;
+
+	Com_Memset( &scan, 0, sizeof( scan ) );
+
+	total = 0;
+	for ( sp = fs_searchpaths; sp; sp = sp->next ) {
+		if ( sp->pack ) {
+			total += sp->pack->numfiles;
+		} else if ( sp->dir ) {
+			dirStart[ sp->order ] = scan.namesUsed;
+			n = scan.count;
+			Q_strncpyz( root, FS_BuildOSPath( sp->dir->path, sp->dir->gamedir, NULL ), sizeof( root ) );
+			FS_IndexScanDir( &scan, root, "", 0 );
+			dirCount[ sp->order ] = scan.count - n;
+			total += dirCount[ sp->order ];
+		}
+	}
+
+	if ( scan.overflow ) {
+		// some directory is too large to be indexed reliably
+		Com_Printf( S_COLOR_YELLOW "FS_BuildIndex: too many files in search paths, index disabled\n" );
+		if ( scan.names )
+			Z_Free( scan.names );
+		Z_Free( dirStart );
+		return;
+	}
+
+	for ( fs_indexSize = 1; fs_indexSize < total; fs_indexSize <<= 1 )
+		;
+
+	size = fs_indexSize * sizeof( fs_indexTable[0] ) + total * sizeof( *entry ) + scan.namesUsed;
+	fs_indexTable = Z_TagMalloc( size, TAG_GENERAL ); // freed and rebuilt on its own, not arena memory
+	Com_Memset( fs_indexTable, 0, fs_indexSize * sizeof( fs_indexTable[0] ) );
+	entry = (fsIndexEntry_t *)( fs_indexTable + fs_indexSize );
+	names = (char *)( entry + total );
+	if ( scan.namesUsed ) {
+		Com_Memcpy( names, scan.names, scan.namesUsed );
+	}
+
+	for ( sp = fs_searchpaths; sp; sp = sp->next ) {
+		if ( sp->pack ) {
+			for ( i = 0; i < sp->pack->numfiles; i++, entry++ ) {
+				entry->name = sp->pack->buildBuffer[i].name;
+				entry->search = sp;
+				entry->pakFile = &sp->pack->buildBuffer[i];
+				FS_IndexInsert( entry, FS_HashFileName( entry->name, 0U ) );
+			}
+		} else if ( sp->dir ) {
+			name = names + dirStart[ sp->order ];
+			for ( i = 0; i < dirCount[ sp->order ]; i++, entry++ ) {
+				entry->name = name;
+				entry->search = sp;
+				entry->pakFile = NULL;
+				FS_IndexInsert( entry, FS_HashFileName( entry->name, 0U ) );
+				name += strlen( name ) + 1;
+			}
+		}
+	}
+
+	fs_indexFiles = total;
+
+	if ( scan.names )
+		Z_Free( scan.names );
+	Z_Free( dirStart );
+}
+
+
+/*
+=================
+FS_IndexNameCompare
+=================
+*/
+static qboolean FS_IndexNameCompare( const fsIndexEntry_t *entry, const char *filename ) {
+#ifndef _WIN32
+	// files in directories are found only by exact name on case-sensitive filesystems
+	if ( !entry->pakFile )
+		return strcmp( entry->name, filename ) != 0;
+#endif
+	return FS_FilenameCompare( entry->name, filename );
+}
+
+
+/*
+=================
+FS_IndexAddFile
+
+Register a file created in the given directory search path
+=================
+*/
+static void FS_IndexAddFile( const char *path, const char *gamedir, const char *qpath ) {
+	searchpath_t	*sp;
+	fsIndexEntry_t	*entry;
+	long			fullHash;
+	int				len;
+
+	if ( !fs_indexSize )
+		return;
+
+	for ( sp = fs_searchpaths; sp; sp = sp->next ) {
+		if ( sp->dir && !Q_stricmp( sp->dir->path, path ) && !Q_stricmp( sp->dir->gamedir, gamedir ) )
+			break;
+	}
+	if ( !sp )
+		return; // not a search path
+
+	fullHash = FS_HashFileName( qpath, 0U );
+	for ( entry = fs_indexTable[ fullHash & ( fs_indexSize - 1 ) ]; entry; entry = entry->next ) {
+		if ( entry->search == sp && !FS_IndexNameCompare( entry, qpath ) )
+			return; // already there
+	}
+
+	// released with search paths in FS_Shutdown
+	len = (int) strlen( qpath ) + 1;
+	entry = Z_TagMalloc( sizeof( *entry ) + len, TAG_SEARCH_DIR );
+	Com_Memcpy( entry + 1, qpath, len );
+	entry->name = (const char *)( entry + 1 );
+	entry->search = sp;
+	entry->pakFile = NULL;
+	FS_IndexInsert( entry, fullHash );
+	fs_indexFiles++;
+}
+
+
+/*
+=================
+FS_IndexAddSVFile
+
+Register a file created relative to fs_homepath
+=================
+*/
+static void FS_IndexAddSVFile( const char *filename ) {
+	char gamedir[ MAX_OSPATH ];
+	const char *sep;
+
+	if ( !fs_indexSize )
+		return;
+
+	sep = strchr( filename, '/' );
+	if ( !sep || sep - filename >= sizeof( gamedir ) )
+		return;
+
+	Q_strncpyz( gamedir, filename, sep - filename + 1 );
+	FS_IndexAddFile( fs_homepath->string, gamedir, sep + 1 );
+}
+
+
+/*
+=================
+FS_IndexFind
+
+Returns the first eligible source of the file or NULL if not found,
+directory sources are returned already opened in *fp, or unchecked
+if fp is NULL
+=================
+*/
+static const fsIndexEntry_t *FS_IndexFind( const char *filename, long fullHash, FILE **fp ) {
+	const fsIndexEntry_t *entry;
+	const directory_t *dir;
+
+	for ( entry = fs_indexTable[ fullHash & ( fs_indexSize - 1 ) ]; entry; entry = entry->next ) {
+		if ( FS_IndexNameCompare( entry, filename ) )
+			continue;
+		if ( entry->pakFile ) {
+			// skip non-pure files
+			if ( !FS_PakIsPure( entry->search->pack ) )
+				continue;
+			return entry;
+		}
+		if ( entry->search->policy == DIR_DENY )
+			continue;
+		if ( fp == NULL ) {
+			return entry;
+		}
+		dir = entry->search->dir;
+		*fp = Sys_FOpen( FS_BuildOSPath( dir->path, dir->gamedir, entry->name ), "rb" );
+		if ( *fp ) {
+			return entry;
+		}
+		// removed since indexing
+	}
+
+	return NULL;
+}
+
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1590,6 +2037,59 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 	// we can do that as long as we know properties of our hash function
 	fullHash = FS_HashFileName( filename, 0U );
 
+	if ( fs_indexSize ) {
+		const fsIndexEntry_t *entry;
+
+		// make sure the q3key file is only readable by the quake3.exe at initialization
+		// any other time the key should only be accessed in memory using the provided functions
+		if ( file && com_fullyInitialized && strstr( filename, "q3key" ) ) {
+			*file = FS_INVALID_HANDLE;
+			return -1;
+		}
+
+		temp = NULL;
+		entry = FS_IndexFind( filename, fullHash, &temp );
+		if ( !entry ) {
+#ifdef FS_MISSING
+			if ( file && missingFiles ) {
+				fprintf( missingFiles, "%s\n", filename );
+			}
+#endif
+			if ( file ) {
+				*file = FS_INVALID_HANDLE;
+			}
+			return -1;
+		}
+
+		if ( entry->pakFile ) {
+			if ( file == NULL ) {
+				return entry->pakFile->size;
+			}
+			return FS_OpenFileInPak( file, entry->search->pack, entry->pakFile, uniqueFILE );
+		}
+
+		if ( file == NULL ) {
+			length = FS_FileLength( temp );
+			fclose( temp );
+			return length;
+		}
+
+		*file = FS_HandleForFile();
+		f = &fsh[ *file ];
+		FS_InitHandle( f );
+
+		f->handleFiles.file.o = temp;
+		Q_strncpyz( f->name, filename, sizeof( f->name ) );
+		f->zipFile = qfalse;
+
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
+				entry->search->dir->path, entry->search->dir->gamedir );
+		}
+
+		return FS_FileLength( f->handleFiles.file.o );
+	}
+
 	if ( file == NULL ) {
 		// just wants to see if file is there
 		for ( search = fs_searchpaths ; search ; search = search->next ) {
@@ -2009,7 +2509,7 @@ CONVENIENCE FUNCTIONS FOR ENTIRE FILES
 
 qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName ) {
 	const searchpath_t	*search;
-	const pack_t		*pak;
+	pack_t				*pak;
 	const fileInPack_t	*pakFile;
 	long			hash;
 	long			fullHash;
@@ -2058,7 +2558,7 @@ qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName ) {
 				// case and separator insensitive comparisons
 				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
 					if ( pChecksum ) {
-						*pChecksum = pak->pure_checksum;
+						*pChecksum = FS_PakPureChecksum( pak );
 					}
 					if ( pakName ) {
 						Com_sprintf( pakName, MAX_OSPATH, "%s/%s", pak->pakGamename, pak->pakBasename );
@@ -2075,51 +2575,1213 @@ qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName ) {
 
 /*
 ============
-FS_ReadFile
+FS_FileIdentity
 
-Filename are relative to the quake search path
-a null buffer will just return the file length without loading
+Opens file the same way as FS_ReadFile does, so containing pak will be
+referenced, and returns checksum of that pak along with file length.
+Files outside of paks can't be identified without reading them
 ============
 */
-int FS_ReadFile( const char *qpath, void **buffer ) {
-	fileHandle_t	h;
-	byte*			buf;
-	qboolean		isConfig;
-	long			len;
+qboolean FS_FileIdentity( const char *qpath, int *pakChecksum, int *length ) {
+	const pack_t *pak;
+	fileHandle_t f;
+	int len;
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	len = FS_FOpenFileRead( qpath, &f, qfalse );
+	if ( f == FS_INVALID_HANDLE ) {
+		return qfalse;
 	}
 
-	if ( !qpath || !qpath[0] ) {
-		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+	pak = fsh[ f ].pak;
+	if ( pak ) {
+		*pakChecksum = pak->checksum;
+		*length = len;
 	}
 
-	buf = NULL;	// quiet compiler warning
-	isConfig = qfalse;
+	FS_FCloseFile( f );
 
-	// if this is a .cfg file and we are playing back a journal, read
-	// it from the journal file
-	if ( com_journalDataFile != FS_INVALID_HANDLE && strstr( qpath, ".cfg" ) ) {
-		if ( com_journal->integer == 2 ) {
-			int		r;
+	return ( pak != NULL );
+}
 
-			Com_DPrintf( "Loading %s from journal file.\n", qpath );
-			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
-			if ( r != sizeof( len ) ) {
-				if (buffer != NULL) *buffer = NULL;
-				return -1;
-			}
-			// if the file didn't exist when the journal was created
-			if (!len) {
-				if (buffer == NULL) {
-					return 1;			// hack for old journal files
-				}
-				*buffer = NULL;
-				return -1;
-			}
-			if (buffer == NULL) {
-				return len;
+
+/*
+=================================================================================
+
+MAPPED PK3 ACCESS
+
+=================================================================================
+*/
+
+#define MAX_MAPPED_BUFFERS	16
+
+static	cvar_t		*fs_mmap;
+static	const byte	*fs_mappedBuffers[ MAX_MAPPED_BUFFERS ];	// zero-copy FS_ReadFile() results
+static	int			fs_numMappedBuffers;
+
+
+static unsigned int FS_ZipShort( const byte *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+
+static unsigned int FS_ZipLong( const byte *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned int)p[3] << 24 );
+}
+
+
+/*
+=================
+FS_ZipCentralInfo
+
+Checks a central directory record against the expected file size and
+returns the compression method, compressed size and local header offset
+=================
+*/
+static qboolean FS_ZipCentralInfo( const byte *central, unsigned long size, unsigned long *method, unsigned long *compressed, unsigned long *local ) {
+
+	if ( FS_ZipLong( central ) != 0x02014b50 ) {
+		return qfalse; // self-extracting archive or damaged
+	}
+
+	*method = FS_ZipShort( central + 10 );
+	*compressed = FS_ZipLong( central + 20 );
+	*local = FS_ZipLong( central + 42 );
+
+	if ( FS_ZipLong( central + 24 ) != size || ( *method != 0 && *method != 8 ) || ( *method == 0 && *compressed != size ) ) {
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+/*
+=================
+FS_ZipLocalSize
+
+Returns the size of a local file header with its name and extra field, 0 if damaged
+=================
+*/
+static unsigned long FS_ZipLocalSize( const byte *local ) {
+
+	if ( FS_ZipLong( local ) != 0x04034b50 ) {
+		return 0;
+	}
+
+	return 30 + FS_ZipShort( local + 26 ) + FS_ZipShort( local + 28 );
+}
+
+
+/*
+=================
+FS_MappedEntryData
+
+Locates the data of a pk3 entry inside a pak mapping, returns NULL if the
+regular path must be used. Thread safe.
+=================
+*/
+static const byte *FS_MappedEntryData( const byte *map, size_t mapSize, unsigned long pos, unsigned long size, unsigned long *method, unsigned long *compressed ) {
+	unsigned long offset, n;
+
+	// central directory record
+	if ( pos + 46 > mapSize || !FS_ZipCentralInfo( map + pos, size, method, compressed, &offset ) ) {
+		return NULL;
+	}
+
+	// local header
+	if ( offset + 30 > mapSize || ( n = FS_ZipLocalSize( map + offset ) ) == 0 ) {
+		return NULL;
+	}
+
+	offset += n;
+	if ( offset > mapSize || *compressed > mapSize - offset ) {
+		return NULL;
+	}
+
+	return map + offset;
+}
+
+
+/*
+=================
+FS_MapPak
+
+Maps the whole pk3 on first use, the mapping lives until FS_FreePak().
+
+Paks must be replaced with a rename: truncating or rewriting a mapped file
+in place makes access to its pages fault. Such changes are detected here
+once per frame, so once per level load, and the pak is read the regular way
+from then on
+=================
+*/
+static qboolean FS_MapPak( pack_t *pak ) {
+	fileId_t id;
+
+	if ( pak->mapFailed ) {
+		return qfalse;
+	}
+
+	if ( pak->mapData ) {
+		if ( pak->mapCheckTime == com_frameTime ) {
+			return qtrue;
+		}
+		pak->mapCheckTime = com_frameTime;
+		if ( Sys_GetFileId( pak->pakFilename, &id ) && !memcmp( &id, &pak->mapId, sizeof( id ) ) ) {
+			return qtrue;
+		}
+		// keep the mapping, zero-copy buffers may still point into it
+		Com_Printf( S_COLOR_YELLOW "WARNING: %s changed on disk, no longer reading it through a mapping\n", pak->pakFilename );
+		pak->mapFailed = qtrue;
+		return qfalse;
+	}
+
+	if ( !Sys_GetFileId( pak->pakFilename, &pak->mapId ) ) {
+		pak->mapFailed = qtrue;
+		return qfalse;
+	}
+
+	pak->mapData = Sys_MapFile( pak->pakFilename, &pak->mapSize );
+	if ( pak->mapData == NULL ) {
+		Com_DPrintf( "Couldn't map %s\n", pak->pakFilename );
+		pak->mapFailed = qtrue;
+		return qfalse;
+	}
+	pak->mapCheckTime = com_frameTime;
+
+	return qtrue;
+}
+
+
+/*
+=================
+FS_SV_FileOSPath
+
+Returns the full path of a file found the same way as FS_SV_FOpenFileRead(),
+or NULL if it does not exist
+=================
+*/
+const char *FS_SV_FileOSPath( const char *filename ) {
+	const char *paths[3];
+	const char *ospath;
+	fileOffset_t fsize;
+	fileTime_t mtime, ctime;
+	int i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	paths[0] = fs_homepath->string;
+	paths[1] = fs_basepath->string;
+	paths[2] = fs_steampath->string;
+
+	for ( i = 0; i < ARRAY_LEN( paths ); i++ ) {
+		if ( !paths[i][0] || ( i == 1 && !Q_stricmp( fs_homepath->string, fs_basepath->string ) ) ) {
+			continue;
+		}
+		ospath = FS_BuildOSPath( paths[i], filename, NULL );
+		if ( Sys_GetFileStats( ospath, &fsize, &mtime, &ctime ) ) {
+			return ospath;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+=================
+FS_SV_MapFile
+
+Maps a file found the same way as FS_SV_FOpenFileRead(), returns NULL if
+it was not found, could not be mapped or fs_mmap is off.
+Release with Sys_UnmapFile()
+=================
+*/
+void *FS_SV_MapFile( const char *filename, size_t *size ) {
+	const char *ospath;
+	void *data;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !fs_mmap->integer ) {
+		return NULL;
+	}
+
+	ospath = FS_SV_FileOSPath( filename );
+	if ( !ospath ) {
+		return NULL;
+	}
+
+	data = Sys_MapFile( ospath, size );
+	if ( data && fs_debug->integer ) {
+		Com_Printf( "FS_SV_MapFile: %s\n", ospath );
+	}
+
+	return data;
+}
+
+
+/*
+=================
+FS_ZeroCopyFile
+
+Stored files of these types are only ever parsed as binary data and never
+modified in place, so they can be returned straight out of the mapping
+without a trailing zero
+=================
+*/
+static qboolean FS_ZeroCopyFile( const char *name ) {
+	static const char *exts[] = { "bsp", "md3", "tga", "jpg", "png", "pcx", "bmp" };
+	const char *ext;
+	int i;
+
+#ifdef Q3_BIG_ENDIAN
+	// loaders swap headers in place
+	return qfalse;
+#endif
+
+	ext = COM_GetExtension( name );
+	for ( i = 0; i < ARRAY_LEN( exts ); i++ ) {
+		if ( !Q_stricmp( ext, exts[i] ) ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+/*
+=================
+FS_ReadIndexEntry
+
+Returns the index entry FS_ReadFile() would read qpath from
+=================
+*/
+static const fsIndexEntry_t *FS_ReadIndexEntry( const char *qpath ) {
+	if ( qpath[0] == '/' || qpath[0] == '\\' ) {
+		qpath++;
+	}
+
+	if ( FS_CheckDirTraversal( qpath ) || ( com_fullyInitialized && strstr( qpath, "q3key" ) ) ) {
+		return NULL;
+	}
+
+	return FS_IndexFind( qpath, FS_HashFileName( qpath, 0U ), NULL );
+}
+
+
+/*
+=================
+FS_IsMappedBuffer
+=================
+*/
+static qboolean FS_IsMappedBuffer( const void *buffer ) {
+	int i;
+
+	for ( i = 0; i < fs_numMappedBuffers; i++ ) {
+		if ( fs_mappedBuffers[i] == buffer ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+/*
+=================
+FS_ReadMappedFile
+
+Serves FS_ReadFile() for pk3 entries through the pak mapping: deflated
+entries are inflated directly into the returned buffer and stored binary
+entries are returned in place. Returns -2 if the regular path must be taken.
+=================
+*/
+static int FS_ReadMappedFile( const fsIndexEntry_t *entry, const char *qpath, void **buffer ) {
+	const byte *data;
+	unsigned long compressed, size, method, offset;
+	pack_t *pak;
+	byte *buf;
+
+	pak = entry->search->pack;
+	if ( !FS_MapPak( pak ) ) {
+		return -2;
+	}
+
+	size = entry->pakFile->size;
+	data = FS_MappedEntryData( pak->mapData, pak->mapSize, entry->pakFile->pos, size, &method, &compressed );
+	if ( !data ) {
+		return -2;
+	}
+	offset = data - pak->mapData;
+
+	if ( method == 0 && fs_numMappedBuffers < MAX_MAPPED_BUFFERS && FS_ZeroCopyFile( qpath ) ) {
+		fs_mappedBuffers[ fs_numMappedBuffers++ ] = data;
+		*buffer = (void *)data;
+	} else {
+		buf = Hunk_AllocateTempMemory( size + 1 );
+		if ( method == 0 ) {
+			Com_Memcpy( buf, data, size );
+		} else if ( unzInflateMemory( buf, size, data, MIN( compressed + 1, pak->mapSize - offset ) ) != UNZ_OK ) {
+			Hunk_FreeTempMemory( buf );
+			Com_Printf( S_COLOR_YELLOW "Error inflating %s@%s\n", pak->pakBasename, qpath );
+			return -2;
+		}
+		// guarantee that it will have a trailing 0 for string operations
+		buf[ size ] = '\0';
+		*buffer = buf;
+	}
+
+	FS_MarkPakReferenced( pak, entry->pakFile );
+	fs_lastPakIndex = pak->index;
+
+	fs_readCount += size;
+	fs_loadCount++;
+	fs_loadStack++;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_ReadFile: %s (mapped from '%s')\n", qpath, pak->pakFilename );
+	}
+
+	return size;
+}
+
+
+/*
+=================================================================================
+
+DECOMPRESSED FILE CACHE
+
+Keeps the contents of recently read pk3 entries so that map changes and
+renderer restarts don't have to read and inflate the same files again.
+Entries are keyed by pak checksum and directory position, so they stay
+valid across filesystem restarts as long as the pak contents don't change.
+
+=================================================================================
+*/
+
+#define FILE_CACHE_HASH_SIZE	1024
+
+typedef struct fileCacheEntry_s {
+	struct fileCacheEntry_s	*prev, *next;	// LRU list, most recently used first
+	struct fileCacheEntry_s	*hashNext;
+	int				checksum;				// pak checksum
+	unsigned long	pos;					// file info position in zip
+	int				size;
+	byte			data[1];				// size + 1 bytes, zero-terminated
+} fileCacheEntry_t;
+
+static	cvar_t				*fs_cacheMegs;
+static	fileCacheEntry_t	*fs_cacheHash[ FILE_CACHE_HASH_SIZE ];
+static	fileCacheEntry_t	fs_cacheList;	// sentinel of the LRU list
+static	size_t				fs_cacheBytes;
+static	int					fs_cacheEntries;
+static	int					fs_cacheHits;
+static	int					fs_cacheMisses;
+static	int					fs_cacheEvictions;
+
+
+static unsigned int FS_CacheHash( int checksum, unsigned long pos ) {
+	return ( (unsigned int)checksum ^ (unsigned int)( pos * 2654435761U ) ) & ( FILE_CACHE_HASH_SIZE - 1 );
+}
+
+
+/*
+=================
+FS_CacheUnlink
+=================
+*/
+static void FS_CacheUnlink( fileCacheEntry_t *entry ) {
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+
+/*
+=================
+FS_CacheLinkFront
+=================
+*/
+static void FS_CacheLinkFront( fileCacheEntry_t *entry ) {
+	entry->prev = &fs_cacheList;
+	entry->next = fs_cacheList.next;
+	entry->next->prev = entry;
+	fs_cacheList.next = entry;
+}
+
+
+/*
+=================
+FS_CacheFree
+=================
+*/
+static void FS_CacheFree( fileCacheEntry_t *entry ) {
+	fileCacheEntry_t **prev;
+
+	prev = &fs_cacheHash[ FS_CacheHash( entry->checksum, entry->pos ) ];
+	while ( *prev != entry ) {
+		prev = &(*prev)->hashNext;
+	}
+	*prev = entry->hashNext;
+
+	FS_CacheUnlink( entry );
+
+	fs_cacheBytes -= entry->size;
+	fs_cacheEntries--;
+
+	Z_Free( entry );
+}
+
+
+/*
+=================
+FS_CacheTrim
+
+Drops least recently used entries until the cache fits in limit bytes
+=================
+*/
+static void FS_CacheTrim( size_t limit ) {
+
+	if ( !fs_cacheList.next ) {
+		return;
+	}
+
+	while ( fs_cacheBytes > limit && fs_cacheList.prev != &fs_cacheList ) {
+		FS_CacheFree( fs_cacheList.prev );
+		fs_cacheEvictions++;
+	}
+}
+
+
+static size_t FS_CacheLimit( void ) {
+	return (size_t)fs_cacheMegs->integer * 1024 * 1024;
+}
+
+
+/*
+=================
+FS_CacheFind
+=================
+*/
+static fileCacheEntry_t *FS_CacheFind( const fsIndexEntry_t *entry ) {
+	const pack_t *pak = entry->search->pack;
+	fileCacheEntry_t *c;
+
+	for ( c = fs_cacheHash[ FS_CacheHash( pak->checksum, entry->pakFile->pos ) ]; c; c = c->hashNext ) {
+		if ( c->checksum == pak->checksum && c->pos == entry->pakFile->pos && c->size == entry->pakFile->size ) {
+			return c;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+=================
+FS_ReadCachedFile
+
+Serves FS_ReadFile() from the cache, returns -2 on a miss
+=================
+*/
+static int FS_ReadCachedFile( const fsIndexEntry_t *entry, const char *qpath, void **buffer ) {
+	fileCacheEntry_t *c;
+	pack_t *pak;
+	byte *buf;
+
+	pak = entry->search->pack;
+
+	c = FS_CacheFind( entry );
+	if ( !c ) {
+		fs_cacheMisses++;
+		return -2;
+	}
+
+	fs_cacheHits++;
+
+	FS_CacheUnlink( c );
+	FS_CacheLinkFront( c );
+
+	buf = Hunk_AllocateTempMemory( c->size + 1 );
+	Com_Memcpy( buf, c->data, c->size + 1 );
+	*buffer = buf;
+
+	FS_MarkPakReferenced( pak, entry->pakFile );
+	fs_lastPakIndex = pak->index;
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_ReadFile: %s (cached from '%s')\n", qpath, pak->pakFilename );
+	}
+
+	return c->size;
+}
+
+
+/*
+=================
+FS_CacheStore
+
+Remembers the contents of a pk3 entry just read by FS_ReadFile()
+=================
+*/
+static void FS_CacheStore( const fsIndexEntry_t *entry, const byte *data, int size ) {
+	fileCacheEntry_t *c;
+	unsigned int hash;
+	size_t limit;
+	pack_t *pak;
+
+	limit = FS_CacheLimit();
+
+	// a single file may not take more than a quarter of the cache
+	if ( size < 0 || (size_t)size > limit / 4 || FS_IsMappedBuffer( data ) ) {
+		return;
+	}
+
+	if ( !fs_cacheList.next ) {
+		fs_cacheList.next = fs_cacheList.prev = &fs_cacheList;
+	}
+
+	FS_CacheTrim( limit - size );
+
+	pak = entry->search->pack;
+	hash = FS_CacheHash( pak->checksum, entry->pakFile->pos );
+
+	c = Z_TagMalloc( sizeof( *c ) + size, TAG_FILE_CACHE );
+	c->checksum = pak->checksum;
+	c->pos = entry->pakFile->pos;
+	c->size = size;
+	Com_Memcpy( c->data, data, size );
+	c->data[ size ] = '\0';
+
+	c->hashNext = fs_cacheHash[ hash ];
+	fs_cacheHash[ hash ] = c;
+	FS_CacheLinkFront( c );
+
+	fs_cacheBytes += size;
+	fs_cacheEntries++;
+}
+
+
+/*
+============
+FS_CacheInfo_f
+============
+*/
+static void FS_CacheInfo_f( void ) {
+	int lookups;
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "flush" ) ) {
+		FS_CacheTrim( 0 );
+		fs_cacheHits = fs_cacheMisses = fs_cacheEvictions = 0;
+		Com_Printf( "File cache flushed.\n" );
+		return;
+	}
+
+	lookups = fs_cacheHits + fs_cacheMisses;
+
+	Com_Printf( "File cache: %i entries, %.2f of %i MB\n", fs_cacheEntries,
+		(double)fs_cacheBytes / ( 1024.0 * 1024.0 ), fs_cacheMegs->integer );
+	Com_Printf( "%i hits, %i misses (%.1f%% hit rate), %i evictions\n", fs_cacheHits, fs_cacheMisses,
+		lookups ? fs_cacheHits * 100.0 / lookups : 0.0, fs_cacheEvictions );
+}
+
+
+/*
+=================================================================================
+
+ASYNCHRONOUS READS
+
+FS_ReadFilesAsync() hands a list of files to background I/O threads which
+read and inflate them into private buffers. The threads only use stdio,
+pak mappings and malloc. Requests without a callback just prefetch:
+FS_ReadFile() takes finished files over, waits for running ones and reads
+files still in the queue itself. Requests with a callback deliver every
+file on the main thread from FS_AsyncFinish().
+
+=================================================================================
+*/
+
+#define MAX_ASYNC_REQUESTS	8
+#define MAX_IO_THREADS		8
+#define MAX_ASYNC_BYTES		(64*1024*1024)	// read ahead limit for files not yet taken over
+
+#define ASYNC_QUEUED	0
+#define ASYNC_RUNNING	1
+#define ASYNC_DONE		2
+#define ASYNC_FAILED	3
+#define ASYNC_RELEASED	4
+
+typedef struct {
+	const char		*qpath;
+	const fsIndexEntry_t *entry;	// NULL if the file is not in the index
+	char			*ospath;		// pk3 or loose file
+	qboolean		isPak;
+	const byte		*mapData;		// pak mapping, if there is one
+	size_t			mapSize;
+	unsigned long	pos;			// central record position of a pk3 entry
+	unsigned long	size;
+	byte			*data;			// malloc'ed, size + 1 bytes
+	volatile long	state;
+} fsAsyncFile_t;
+
+typedef struct {
+	int				handle;
+	fsAsyncCallback_t callback;
+	void			*arg;
+	void			*threads[ MAX_IO_THREADS ];
+	int				numThreads;
+	volatile long	next;			// next file for the background threads
+	int				numFiles;
+	fsAsyncFile_t	files[1];
+} fsAsyncRequest_t;
+
+static	cvar_t				*fs_ioThreads;
+static	fsAsyncRequest_t	*fs_asyncRequests[ MAX_ASYNC_REQUESTS ];
+static	int					fs_numAsyncRequests;
+static	int					fs_asyncHandle;
+static	volatile long		fs_asyncBytes;
+static	void				*fs_asyncEvent;		// signaled whenever a file leaves ASYNC_RUNNING
+
+
+/*
+=================
+FS_AsyncLoadPakFile
+
+Reads a pk3 entry without a mapping. Thread safe.
+=================
+*/
+static const byte *FS_AsyncLoadPakFile( fsAsyncFile_t *file, FILE *f, byte **source, unsigned long *method, unsigned long *compressed ) {
+	byte header[ 46 ];
+	unsigned long offset, n;
+
+	if ( fseek( f, file->pos, SEEK_SET ) != 0 || fread( header, 46, 1, f ) != 1 ) {
+		return NULL;
+	}
+	if ( !FS_ZipCentralInfo( header, file->size, method, compressed, &offset ) ) {
+		return NULL;
+	}
+
+	if ( fseek( f, offset, SEEK_SET ) != 0 || fread( header, 30, 1, f ) != 1 ) {
+		return NULL;
+	}
+	if ( ( n = FS_ZipLocalSize( header ) ) == 0 ) {
+		return NULL;
+	}
+
+	// keep a zero byte past the end for the streaming inflate
+	*source = malloc( *compressed + 1 );
+	if ( !*source ) {
+		return NULL;
+	}
+	(*source)[ *compressed ] = '\0';
+
+	if ( fseek( f, offset + n, SEEK_SET ) != 0 || ( *compressed && fread( *source, *compressed, 1, f ) != 1 ) ) {
+		return NULL;
+	}
+
+	return *source;
+}
+
+
+/*
+=================
+FS_AsyncLoad
+
+Reads a queued file into file->data. Thread safe.
+=================
+*/
+static qboolean FS_AsyncLoad( fsAsyncFile_t *file ) {
+	unsigned long method, compressed;
+	const byte *data;
+	byte *source;
+	qboolean ok;
+	FILE *f;
+	long len;
+
+	f = NULL;
+	source = NULL;
+	ok = qfalse;
+
+	if ( !file->isPak ) {
+		f = Sys_FOpen( file->ospath, "rb" );
+		if ( !f ) {
+			return qfalse;
+		}
+		if ( fseek( f, 0, SEEK_END ) == 0 && ( len = ftell( f ) ) >= 0 && len < 0x7FFFFFFF && fseek( f, 0, SEEK_SET ) == 0 ) {
+			file->size = len;
+			file->data = malloc( file->size + 1 );
+			if ( file->data && ( !len || fread( file->data, len, 1, f ) == 1 ) ) {
+				file->data[ len ] = '\0';
+				ok = qtrue;
+			}
+		}
+		fclose( f );
+		return ok;
+	}
+
+	compressed = 0;
+	method = 0;
+	data = NULL;
+	if ( file->mapData ) {
+		data = FS_MappedEntryData( file->mapData, file->mapSize, file->pos, file->size, &method, &compressed );
+	} else {
+		f = Sys_FOpen( file->ospath, "rb" );
+		if ( f ) {
+			data = FS_AsyncLoadPakFile( file, f, &source, &method, &compressed );
+			fclose( f );
+		}
+	}
+
+	if ( data ) {
+		file->data = malloc( file->size + 1 );
+		if ( file->data ) {
+			if ( method == 0 ) {
+				Com_Memcpy( file->data, data, file->size );
+				ok = qtrue;
+			} else {
+				if ( file->mapData ) {
+					compressed = MIN( compressed + 1, file->mapSize - ( data - file->mapData ) );
+				} else {
+					compressed++;
+				}
+				ok = ( unzInflateMemory( file->data, file->size, data, compressed ) == UNZ_OK );
+			}
+			file->data[ file->size ] = '\0';
+		}
+	}
+
+	free( source );
+	return ok;
+}
+
+
+/*
+=================
+FS_AsyncRun
+=================
+*/
+static void FS_AsyncRun( fsAsyncFile_t *file ) {
+
+	if ( FS_AsyncLoad( file ) ) {
+		FS_AtomicAdd( fs_asyncBytes, (long)file->size );
+		FS_AtomicCAS( file->state, ASYNC_RUNNING, ASYNC_DONE );
+	} else {
+		free( file->data );
+		file->data = NULL;
+		FS_AtomicCAS( file->state, ASYNC_RUNNING, ASYNC_FAILED );
+	}
+
+	if ( fs_asyncEvent ) {
+		Sys_SignalEvent( fs_asyncEvent );
+	}
+}
+
+
+/*
+=================
+FS_AsyncThread
+=================
+*/
+static void FS_AsyncThread( void *arg ) {
+	fsAsyncRequest_t *req = (fsAsyncRequest_t *)arg;
+	fsAsyncFile_t *file;
+	long i;
+
+	while ( ( i = FS_AtomicInc( req->next ) ) < req->numFiles ) {
+		file = &req->files[ i ];
+		if ( FS_AtomicGet( fs_asyncBytes ) >= MAX_ASYNC_BYTES ) {
+			continue; // left for the main thread
+		}
+		if ( FS_AtomicCAS( file->state, ASYNC_QUEUED, ASYNC_RUNNING ) == ASYNC_QUEUED ) {
+			FS_AsyncRun( file );
+		}
+	}
+}
+
+
+/*
+=================
+FS_AsyncWaitFile
+
+Reads a queued file on the calling thread or waits for a background thread
+to finish it, returns ASYNC_DONE or ASYNC_FAILED
+=================
+*/
+static long FS_AsyncWaitFile( fsAsyncFile_t *file ) {
+	long state;
+
+	if ( FS_AtomicCAS( file->state, ASYNC_QUEUED, ASYNC_RUNNING ) == ASYNC_QUEUED ) {
+		FS_AsyncRun( file );
+	}
+
+	while ( ( state = FS_AtomicGet( file->state ) ) == ASYNC_RUNNING ) {
+		Sys_WaitEvent( fs_asyncEvent );
+	}
+
+	return state;
+}
+
+
+/*
+=================
+FS_AsyncRelease
+=================
+*/
+static void FS_AsyncRelease( fsAsyncFile_t *file ) {
+
+	if ( file->data ) {
+		FS_AtomicAdd( fs_asyncBytes, -(long)file->size );
+		free( file->data );
+		file->data = NULL;
+	}
+
+	file->state = ASYNC_RELEASED;
+}
+
+
+/*
+=================
+FS_AsyncFindRequest
+=================
+*/
+static int FS_AsyncFindRequest( int handle ) {
+	int i;
+
+	for ( i = 0; i < fs_numAsyncRequests; i++ ) {
+		if ( fs_asyncRequests[i]->handle == handle ) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+=================
+FS_ReadAsyncFile
+
+Serves FS_ReadFile() from prefetch requests, returns -2 if qpath was not requested
+=================
+*/
+static int FS_ReadAsyncFile( const fsIndexEntry_t *entry, const char *qpath, void **buffer ) {
+	fsAsyncRequest_t *req;
+	fsAsyncFile_t *file;
+	pack_t *pak;
+	byte *buf;
+	int i, n, len;
+
+	for ( i = 0; i < fs_numAsyncRequests; i++ ) {
+		req = fs_asyncRequests[i];
+		if ( req->callback ) {
+			continue;
+		}
+		for ( n = 0; n < req->numFiles; n++ ) {
+			file = &req->files[n];
+			if ( file->entry != entry || file->state == ASYNC_RELEASED ) {
+				continue;
+			}
+
+			if ( FS_AsyncWaitFile( file ) != ASYNC_DONE ) {
+				FS_AsyncRelease( file );
+				return -2;
+			}
+
+			len = file->size;
+			buf = Hunk_AllocateTempMemory( len + 1 );
+			Com_Memcpy( buf, file->data, len + 1 );
+			*buffer = buf;
+
+			FS_AsyncRelease( file );
+
+			if ( entry->pakFile ) {
+				pak = entry->search->pack;
+				FS_MarkPakReferenced( pak, entry->pakFile );
+				fs_lastPakIndex = pak->index;
+			} else {
+				fs_lastPakIndex = -1;
+			}
+
+			fs_readCount += len;
+			fs_loadCount++;
+			fs_loadStack++;
+
+			if ( fs_debug->integer ) {
+				Com_Printf( "FS_ReadFile: %s (prefetched from '%s')\n", qpath, file->ospath );
+			}
+
+			return len;
+		}
+	}
+
+	return -2;
+}
+
+
+/*
+=================
+FS_ReadFilesAsync
+=================
+*/
+int FS_ReadFilesAsync( const char **qpaths, int numFiles, fsAsyncCallback_t callback, void *arg ) {
+	const fsIndexEntry_t *entry;
+	const directory_t *dir;
+	fsAsyncRequest_t *req;
+	fsAsyncFile_t *file;
+	char *names;
+	int i, n, size;
+	void *thread;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	// without threads a prefetch would only add a copy
+	if ( numFiles <= 0 || ( !callback && !fs_ioThreads->integer ) ) {
+		return 0;
+	}
+
+	if ( fs_numAsyncRequests == MAX_ASYNC_REQUESTS ) {
+		FS_AsyncFinish( fs_asyncRequests[0]->handle );
+	}
+
+	size = sizeof( *req ) + ( numFiles - 1 ) * sizeof( req->files[0] );
+	for ( i = 0; i < numFiles; i++ ) {
+		size += strlen( qpaths[i] ) + 1;
+	}
+
+	req = Z_Malloc( size );
+	names = (char *)&req->files[ numFiles ];
+
+	for ( i = 0, n = 0; i < numFiles; i++ ) {
+		entry = fs_indexSize ? FS_ReadIndexEntry( qpaths[i] ) : NULL;
+
+		// prefetching only makes sense for files that will be found and are not cached yet
+		if ( !callback && ( !entry || ( entry->pakFile && fs_cacheMegs->integer && FS_CacheFind( entry ) ) ) ) {
+			continue;
+		}
+
+		file = &req->files[ n++ ];
+		file->qpath = names;
+		names = Q_stradd( names, qpaths[i] ) + 1;
+		file->entry = entry;
+		file->state = ASYNC_QUEUED;
+
+		if ( !entry ) {
+			file->state = ASYNC_FAILED;
+		} else if ( entry->pakFile ) {
+			pack_t *pak = entry->search->pack;
+			file->ospath = CopyString( pak->pakFilename );
+			file->isPak = qtrue;
+			file->pos = entry->pakFile->pos;
+			file->size = entry->pakFile->size;
+			if ( fs_mmap->integer && FS_MapPak( pak ) ) {
+				file->mapData = pak->mapData;
+				file->mapSize = pak->mapSize;
+			}
+		} else {
+			dir = entry->search->dir;
+			file->ospath = CopyString( FS_BuildOSPath( dir->path, dir->gamedir, entry->name ) );
+		}
+	}
+
+	if ( n == 0 ) {
+		Z_Free( req );
+		return 0;
+	}
+
+	req->numFiles = n;
+	req->callback = callback;
+	req->arg = arg;
+	if ( ++fs_asyncHandle <= 0 ) {
+		fs_asyncHandle = 1;
+	}
+	req->handle = fs_asyncHandle;
+
+	// without the event nothing could wait for the threads, the main thread reads everything then
+	if ( !fs_asyncEvent ) {
+		fs_asyncEvent = Sys_CreateEvent();
+	}
+
+	for ( i = 0; i < fs_ioThreads->integer && i < n && fs_asyncEvent; i++ ) {
+		thread = Sys_StartThread( FS_AsyncThread, req );
+		if ( !thread ) {
+			break;
+		}
+		req->threads[ req->numThreads++ ] = thread;
+	}
+
+	fs_asyncRequests[ fs_numAsyncRequests++ ] = req;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_ReadFilesAsync: %i of %i files queued on %i threads\n", n, numFiles, req->numThreads );
+	}
+
+	return req->handle;
+}
+
+
+/*
+=================
+FS_AsyncComplete
+=================
+*/
+qboolean FS_AsyncComplete( int handle ) {
+	const fsAsyncRequest_t *req;
+	int i;
+
+	i = FS_AsyncFindRequest( handle );
+	if ( i < 0 ) {
+		return qtrue;
+	}
+
+	req = fs_asyncRequests[i];
+	for ( i = 0; i < req->numFiles; i++ ) {
+		if ( req->files[i].state == ASYNC_RUNNING ) {
+			return qfalse;
+		}
+		if ( req->files[i].state == ASYNC_QUEUED && req->numThreads && req->next < req->numFiles ) {
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+
+/*
+=================
+FS_AsyncFreeRequest
+=================
+*/
+static void FS_AsyncFreeRequest( int index, qboolean deliver ) {
+	fsAsyncRequest_t *req;
+	fsAsyncFile_t *file;
+	void *buf;
+	int i, len;
+
+	req = fs_asyncRequests[ index ];
+	fs_asyncRequests[ index ] = fs_asyncRequests[ --fs_numAsyncRequests ];
+
+	for ( i = 0; i < req->numThreads; i++ ) {
+		Sys_JoinThread( req->threads[i] );
+	}
+
+	for ( i = 0; i < req->numFiles; i++ ) {
+		file = &req->files[i];
+		if ( deliver && req->callback ) {
+			if ( FS_AsyncWaitFile( file ) == ASYNC_DONE ) {
+				if ( file->entry->pakFile ) {
+					FS_MarkPakReferenced( file->entry->search->pack, file->entry->pakFile );
+				}
+				req->callback( file->qpath, file->data, file->size, req->arg );
+			} else {
+				len = FS_ReadFile( file->qpath, &buf );
+				req->callback( file->qpath, len >= 0 ? buf : NULL, len, req->arg );
+				if ( len >= 0 ) {
+					FS_FreeFile( buf );
+				}
+			}
+		} else if ( deliver && file->state == ASYNC_DONE && file->entry->pakFile && fs_cacheMegs->integer ) {
+			// keep read ahead that was not used
+			FS_CacheStore( file->entry, file->data, file->size );
+		}
+		FS_AsyncRelease( file );
+		if ( file->ospath ) {
+			Z_Free( file->ospath );
+		}
+	}
+
+	Z_Free( req );
+}
+
+
+/*
+=================
+FS_AsyncFinish
+=================
+*/
+void FS_AsyncFinish( int handle ) {
+	int i;
+
+	i = FS_AsyncFindRequest( handle );
+	if ( i >= 0 ) {
+		FS_AsyncFreeRequest( i, qtrue );
+	}
+}
+
+
+/*
+=================
+FS_AsyncShutdown
+
+Drops all requests without delivering callbacks, the index entries
+and pak mappings they refer to are about to go away
+=================
+*/
+static void FS_AsyncShutdown( void ) {
+	while ( fs_numAsyncRequests ) {
+		FS_AsyncFreeRequest( 0, qfalse );
+	}
+}
+
+
+/*
+============
+FS_ReadFile
+
+Filename are relative to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+int FS_ReadFile( const char *qpath, void **buffer ) {
+	const fsIndexEntry_t *indexEntry;
+	const fsIndexEntry_t *pakEntry;
+	fileHandle_t	h;
+	byte*			buf;
+	qboolean		isConfig;
+	long			len;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFile with empty name" );
+	}
+
+	buf = NULL;	// quiet compiler warning
+	isConfig = qfalse;
+
+	// if this is a .cfg file and we are playing back a journal, read
+	// it from the journal file
+	if ( com_journalDataFile != FS_INVALID_HANDLE && strstr( qpath, ".cfg" ) ) {
+		if ( com_journal->integer == 2 ) {
+			int		r;
+
+			Com_DPrintf( "Loading %s from journal file.\n", qpath );
+			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
+			if ( r != sizeof( len ) ) {
+				if (buffer != NULL) *buffer = NULL;
+				return -1;
+			}
+			// if the file didn't exist when the journal was created
+			if (!len) {
+				if (buffer == NULL) {
+					return 1;			// hack for old journal files
+				}
+				*buffer = NULL;
+				return -1;
+			}
+			if (buffer == NULL) {
+				return len;
 			}
 
 			buf = Hunk_AllocateTempMemory(len+1);
@@ -2142,6 +3804,47 @@ int FS_ReadFile( const char *qpath, void **buffer ) {
 		}
 	}
 
+	if ( buffer && !isConfig && fs_indexSize ) {
+		indexEntry = FS_ReadIndexEntry( qpath );
+	} else {
+		indexEntry = NULL;
+	}
+
+	pakEntry = ( indexEntry && indexEntry->pakFile ) ? indexEntry : NULL;
+
+	if ( indexEntry && fs_numAsyncRequests ) {
+		len = FS_ReadAsyncFile( indexEntry, qpath, buffer );
+		if ( len >= 0 ) {
+			if ( pakEntry && fs_cacheMegs->integer ) {
+				FS_CacheStore( pakEntry, *buffer, len );
+			}
+			return len;
+		}
+	}
+
+	if ( pakEntry ) {
+		if ( fs_cacheBytes > FS_CacheLimit() ) {
+			FS_CacheTrim( FS_CacheLimit() );
+		}
+		if ( fs_cacheMegs->integer ) {
+			len = FS_ReadCachedFile( pakEntry, qpath, buffer );
+			if ( len >= 0 ) {
+				return len;
+			}
+		}
+
+		// pk3 entries are read straight from the mapping
+		if ( fs_mmap->integer ) {
+			len = FS_ReadMappedFile( pakEntry, qpath, buffer );
+			if ( len >= 0 ) {
+				if ( fs_cacheMegs->integer ) {
+					FS_CacheStore( pakEntry, *buffer, len );
+				}
+				return len;
+			}
+		}
+	}
+
 	// look for it in the filesystem or pack files
 	len = FS_FOpenFileRead( qpath, &h, qfalse );
 	if ( h == FS_INVALID_HANDLE ) {
@@ -2180,6 +3883,10 @@ int FS_ReadFile( const char *qpath, void **buffer ) {
 	buf[ len ] = '\0';
 	FS_FCloseFile( h );
 
+	if ( pakEntry && fs_cacheMegs->integer ) {
+		FS_CacheStore( pakEntry, buf, len );
+	}
+
 	// if we are journalling and it is a config file, write it to the journal file
 	if ( isConfig ) {
 		Com_DPrintf( "Writing %s to journal file.\n", qpath );
@@ -2197,6 +3904,8 @@ FS_FreeFile
 =============
 */
 void FS_FreeFile( void *buffer ) {
+	int i;
+
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
 	}
@@ -2205,7 +3914,18 @@ void FS_FreeFile( void *buffer ) {
 	}
 	fs_loadStack--;
 
-	Hunk_FreeTempMemory( buffer );
+	for ( i = 0; i < fs_numMappedBuffers; i++ ) {
+		if ( fs_mappedBuffers[i] == buffer ) {
+			break;
+		}
+	}
+
+	if ( i < fs_numMappedBuffers ) {
+		// points into a pak mapping
+		fs_mappedBuffers[i] = fs_mappedBuffers[ --fs_numMappedBuffers ];
+	} else {
+		Hunk_FreeTempMemory( buffer );
+	}
 
 	// if all of our temp files are free, clear all of our space
 	if ( fs_loadStack == 0 ) {
@@ -2335,7 +4055,7 @@ static qboolean fs_cacheSynced = qtrue;
 // 3: [size of file offset and file time]
 // non-matching header will cause whole file being ignored
 static const byte cache_header[ 4 ] = {
-	0, //version
+	1, //version
 #ifdef Q3_LITTLE_ENDIAN
 	0x0,
 #else
@@ -2351,6 +4071,7 @@ typedef struct pk3cacheHeader_s {
 	int numFiles;
 	int numHeaderLongs; // including first uninitialized
 	int contentLen;
+	int checksum;		// regular checksum, the pure one depends from the feed
 	fileTime_t ctime;	// creation/status change time
 	fileTime_t mtime;	// modification time
 	fileOffset_t size;	// zip file size
@@ -2569,6 +4290,8 @@ static qboolean FS_SavePackToFile( const pack_t *pak, FILE *f )
 	pk.numHeaderLongs = pak->numHeaderLongs;
 	// content of some files
 	pk.contentLen = contentLen;
+	// regular checksum
+	pk.checksum = pak->checksum;
 	// creation/status change time
 	pk.ctime = pak->ctime;
 	// modification time
@@ -2788,14 +4511,8 @@ static qboolean FS_LoadPakFromFile( FILE *f )
 		goto __error;
 	}
 
-	pack->checksumFeed = fs_checksumFeed;
-	pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
-
-	pack->checksum = Com_BlockChecksum( pack->headerLongs + 1, sizeof( pack->headerLongs[0] ) * ( pack->numHeaderLongs - 1 ) );
-	pack->checksum = LittleLong( pack->checksum );
-
-	pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
-	pack->pure_checksum = LittleLong( pack->pure_checksum );
+	// pure checksum is computed on first use
+	pack->checksum = pk.checksum;
 
 	// seek through unused content
 	if ( pk.contentLen > 0 )
@@ -2824,113 +4541,376 @@ __error:
 ============
 FS_SaveCache
 
-Called at th end of FS_Startup() after releasing unused paks
-============
-*/
-static qboolean FS_SaveCache( void )
-{
-	const char *filename = CACHE_FILE_NAME;
-	const char *ospath;
-	const searchpath_t *sp;
-	FILE *f;
+Called at th end of FS_Startup() after releasing unused paks
+============
+*/
+static qboolean FS_SaveCache( void )
+{
+	const char *filename = CACHE_FILE_NAME;
+	const char *ospath;
+	const searchpath_t *sp;
+	FILE *f;
+
+	if ( !fs_searchpaths )
+		return qfalse;
+
+	if ( !fs_cacheLoaded )
+	{
+		Com_DPrintf( "synced FS cache on startup\n" );
+		fs_cacheSynced = qfalse;
+		fs_cacheLoaded = qtrue;
+	}
+	else if ( CACHE_SYNC_CONDITION )
+	{
+		Com_DPrintf( "synced FS cache on readed=%i, released=%i, skipped=%i\n",
+			fs_paksReaded, fs_paksReleased, fs_paksSkipped );
+		fs_cacheSynced = qfalse;
+	}
+
+	if ( fs_cacheSynced )
+		return qtrue;
+
+	sp = fs_searchpaths;
+
+	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+
+	f = Sys_FOpen( ospath, "wb" );
+	if ( f == NULL )
+		return qfalse;
+
+	FS_WriteCacheHeader( f );
+
+	while ( sp != NULL )
+	{
+		if ( sp->pack )
+		{
+			FS_SavePackToFile( sp->pack, f );
+		}
+		sp = sp->next;
+	}
+
+	fclose( f );
+
+	fs_paksReleased = 0;
+	fs_paksSkipped = 0;
+	fs_paksReaded = 0;
+
+	fs_cacheSynced = qtrue;
+
+	return qtrue;
+}
+
+
+/*
+============
+FS_LoadCache
+
+Called at FS_Startup() before loading any pk3 file
+============
+*/
+static void FS_LoadCache( void )
+{
+	const char *filename = CACHE_FILE_NAME;
+	const char *ospath;
+	FILE *f;
+
+	fs_paksReaded = 0;
+	fs_paksReleased = 0;
+
+	if ( fs_cacheLoaded )
+		return;
+
+	fs_paksCached = 0;
+	fs_paksSkipped = 0;
+
+	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+
+	f = Sys_FOpen( ospath, "rb" );
+	if ( f == NULL )
+		return;
+
+	if ( !FS_ValidateCacheHeader( f ) )
+	{
+		fclose( f );
+		return;
+	}
+
+	while ( FS_LoadPakFromFile( f ) )
+		;
+
+	fclose( f );
+
+	fs_cacheLoaded = qtrue;
+
+	Com_Printf( "...found %i cached paks\n", fs_paksCached );
+}
+
+#endif // USE_PK3_CACHE_FILE
+
+#endif // USE_PK3_CACHE
+
+
+/*
+=================================================================================
+
+PK3 DIRECTORY SCANNING
+
+Central directories are parsed here without an unzip handle so that
+many pk3 files can be scanned at once from Sys_RunThreads() workers,
+nothing but stdio, malloc and pure helpers may be used
+
+=================================================================================
+*/
+
+#define ZIP_EOCD_SIZE		22
+#define ZIP_CENTRAL_SIZE	46
+#define MAX_SCAN_THREADS	8
+
+typedef struct {
+	char			*name;
+	unsigned long	pos;		// central record position, as for unzSetCurrentFileInfoPosition()
+	unsigned long	size;		// uncompressed size
+	unsigned long	fullHash;
+	int				method;
+	qboolean		banned;
+} fsZipEntry_t;
+
+typedef struct {
+	char			*zipfile;
+	fsZipEntry_t	*entries;	// single malloc'ed block with header longs and names
+	int				numEntries;
+	int				numFiles;	// entries with supported compression method
+	int				namelen;
+	int				*headerLongs;
+	int				numHeaderLongs;
+	int				checksum;
+	int				pure_checksum;
+} fsZipScan_t;
+
+typedef struct {
+	fsZipScan_t		*scans;
+	long			count;
+	volatile long	next;
+} fsZipScanJobs_t;
+
+static	cvar_t		*fs_scanThreads;
+
+
+/*
+=================
+FS_ScanZipFile
+
+Reads the central directory, converts and hashes file names
+and computes both pak checksums
+=================
+*/
+static void FS_ScanZipFile( fsZipScan_t *scan )
+{
+	FILE			*f;
+	byte			*buf, *eocd, *p, *end;
+	long			fileSize, tailSize, central, offset, size, byteBefore;
+	unsigned int	i, count, nameLen;
+	fsZipEntry_t	*entry;
+	char			*names;
+
+	f = Sys_FOpen( scan->zipfile, "rb" );
+	if ( f == NULL ) {
+		return;
+	}
+
+	buf = NULL;
+
+	if ( fseek( f, 0, SEEK_END ) != 0 || ( fileSize = ftell( f ) ) < ZIP_EOCD_SIZE ) {
+		goto done;
+	}
+
+	// end of central directory record may be followed by up to 64k of comment
+	tailSize = MIN( fileSize, 0xFFFF + ZIP_EOCD_SIZE );
+	buf = malloc( tailSize );
+	if ( buf == NULL || fseek( f, fileSize - tailSize, SEEK_SET ) != 0 || fread( buf, tailSize, 1, f ) != 1 ) {
+		goto done;
+	}
+
+	for ( eocd = buf + tailSize - ZIP_EOCD_SIZE; eocd >= buf; eocd-- ) {
+		if ( FS_ZipLong( eocd ) == 0x06054b50 ) {
+			break;
+		}
+	}
+	if ( eocd < buf ) {
+		goto done;
+	}
+
+	// multi-disk archives are not supported
+	count = FS_ZipShort( eocd + 10 );
+	if ( FS_ZipShort( eocd + 4 ) != 0 || FS_ZipShort( eocd + 6 ) != 0 || FS_ZipShort( eocd + 8 ) != count ) {
+		goto done;
+	}
 
-	if ( !fs_searchpaths )
-		return qfalse;
+	size = FS_ZipLong( eocd + 12 );
+	offset = FS_ZipLong( eocd + 16 );
+	central = fileSize - tailSize + (long)( eocd - buf );
+	byteBefore = central - ( offset + size );
+	if ( count == 0 || size <= 0 || offset < 0 || byteBefore < 0 ) {
+		goto done;
+	}
 
-	if ( !fs_cacheLoaded )
-	{
-		Com_DPrintf( "synced FS cache on startup\n" );
-		fs_cacheSynced = qfalse;
-		fs_cacheLoaded = qtrue;
+	free( buf );
+	buf = malloc( size );
+	if ( buf == NULL || fseek( f, offset + byteBefore, SEEK_SET ) != 0 || fread( buf, size, 1, f ) != 1 ) {
+		goto done;
 	}
-	else if ( CACHE_SYNC_CONDITION )
-	{
-		Com_DPrintf( "synced FS cache on readed=%i, released=%i, skipped=%i\n",
-			fs_paksReaded, fs_paksReleased, fs_paksSkipped );
-		fs_cacheSynced = qfalse;
+
+	// names take less space than their central records
+	scan->entries = malloc( count * sizeof( scan->entries[0] ) + ( count + 1 ) * sizeof( scan->headerLongs[0] ) + size );
+	if ( scan->entries == NULL ) {
+		goto done;
 	}
+	scan->headerLongs = (int *)( scan->entries + count );
+	names = (char *)( scan->headerLongs + count + 1 );
 
-	if ( fs_cacheSynced )
-		return qtrue;
+	scan->headerLongs[ scan->numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
 
-	sp = fs_searchpaths;
+	p = buf;
+	end = buf + size;
+	for ( i = 0; i < count; i++ ) {
+		if ( p + ZIP_CENTRAL_SIZE > end || FS_ZipLong( p ) != 0x02014b50 ) {
+			break;
+		}
+		nameLen = FS_ZipShort( p + 28 );
+		if ( p + ZIP_CENTRAL_SIZE + nameLen > end ) {
+			break;
+		}
 
-	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+		entry = &scan->entries[ scan->numEntries++ ];
+		entry->name = names;
+		entry->pos = offset + (long)( p - buf );
+		entry->method = FS_ZipShort( p + 10 );
+		entry->size = FS_ZipLong( p + 24 );
 
-	f = Sys_FOpen( ospath, "wb" );
-	if ( f == NULL )
-		return qfalse;
+		// same truncation as unzGetCurrentFileInfo() into a MAX_ZPATH buffer
+		Com_Memcpy( names, p + ZIP_CENTRAL_SIZE, MIN( nameLen, MAX_ZPATH - 1 ) );
+		names[ MIN( nameLen, MAX_ZPATH - 1 ) ] = '\0';
+		names += strlen( names ) + 1;
 
-	FS_WriteCacheHeader( f );
+		if ( entry->method == 0 || entry->method == 8 /*Z_DEFLATED*/ ) {
+			if ( entry->size > 0 ) {
+				scan->headerLongs[ scan->numHeaderLongs++ ] = LittleLong( FS_ZipLong( p + 16 ) );
+			}
+			scan->namelen += strlen( entry->name ) + 1;
+			scan->numFiles++;
 
-	while ( sp != NULL )
-	{
-		if ( sp->pack )
-		{
-			FS_SavePackToFile( sp->pack, f );
+			FS_ConvertFilename( entry->name );
+			entry->banned = FS_BannedPakFile( entry->name );
+			entry->fullHash = FS_HashFileName( entry->name, 0U );
 		}
-		sp = sp->next;
+
+		p += ZIP_CENTRAL_SIZE + nameLen + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
 	}
 
-	fclose( f );
+	scan->checksum = Com_BlockChecksum( scan->headerLongs + 1, sizeof( scan->headerLongs[0] ) * ( scan->numHeaderLongs - 1 ) );
+	scan->checksum = LittleLong( scan->checksum );
 
-	fs_paksReleased = 0;
-	fs_paksSkipped = 0;
-	fs_paksReaded = 0;
+	scan->pure_checksum = Com_BlockChecksum( scan->headerLongs, sizeof( scan->headerLongs[0] ) * scan->numHeaderLongs );
+	scan->pure_checksum = LittleLong( scan->pure_checksum );
 
-	fs_cacheSynced = qtrue;
+done:
+	free( buf );
+	fclose( f );
+}
 
-	return qtrue;
+
+static void FS_FreeZipScan( fsZipScan_t *scan )
+{
+	free( scan->entries );
+	scan->entries = NULL;
+	scan->numEntries = 0;
+	scan->numFiles = 0;
 }
 
 
-/*
-============
-FS_LoadCache
+static void FS_ScanZipFilesThread( void *arg )
+{
+	fsZipScanJobs_t *jobs = (fsZipScanJobs_t *)arg;
+	long i;
 
-Called at FS_Startup() before loading any pk3 file
-============
-*/
-static void FS_LoadCache( void )
+	while ( ( i = FS_AtomicInc( jobs->next ) ) < jobs->count ) {
+		if ( jobs->scans[ i ].zipfile ) {
+			FS_ScanZipFile( &jobs->scans[ i ] );
+		}
+	}
+}
+
+
+static void FS_FreeZipScans( fsZipScan_t *scans, int numfiles )
 {
-	const char *filename = CACHE_FILE_NAME;
-	const char *ospath;
-	FILE *f;
+	int i;
 
-	fs_paksReaded = 0;
-	fs_paksReleased = 0;
+	for ( i = 0; i < numfiles; i++ ) {
+		if ( scans[i].zipfile ) {
+			FS_FreeZipScan( &scans[i] );
+			Z_Free( scans[i].zipfile );
+		}
+	}
 
-	if ( fs_cacheLoaded )
-		return;
+	Z_Free( scans );
+}
 
-	fs_paksCached = 0;
-	fs_paksSkipped = 0;
 
-	ospath = FS_BuildOSPath( fs_homepath->string, filename, NULL );
+/*
+=================
+FS_ScanZipFiles
 
-	f = Sys_FOpen( ospath, "rb" );
-	if ( f == NULL )
-		return;
+Scans all listed pk3 files which are not in the pak cache ahead of
+FS_LoadZipFile(), results are indexed like pakfiles.
+Returns NULL if a parallel scan is not worth it.
+=================
+*/
+static fsZipScan_t *FS_ScanZipFiles( const char *path, const char *dir, char **pakfiles, int numfiles )
+{
+	fsZipScanJobs_t	jobs;
+	fsZipScan_t		*scans;
+	const char		*pakfile;
+	int				i, count, numThreads;
 
-	if ( !FS_ValidateCacheHeader( f ) )
-	{
-		fclose( f );
-		return;
+	numThreads = fs_scanThreads->integer;
+	if ( numThreads == 0 ) {
+		numThreads = MIN( Sys_CPUCount(), MAX_SCAN_THREADS );
 	}
 
-	while ( FS_LoadPakFromFile( f ) )
-		;
+	if ( numThreads <= 1 || numfiles < 2 ) {
+		return NULL;
+	}
 
-	fclose( f );
+	scans = Z_Malloc( numfiles * sizeof( scans[0] ) );
+	count = 0;
 
-	fs_cacheLoaded = qtrue;
+	for ( i = 0; i < numfiles; i++ ) {
+		if ( !FS_IsExt( pakfiles[i], ".pk3", strlen( pakfiles[i] ) ) ) {
+			continue;
+		}
+		pakfile = FS_BuildOSPath( path, dir, pakfiles[i] );
+#ifdef USE_PK3_CACHE
+		if ( FS_FindInCache( pakfile ) ) {
+			continue;
+		}
+#endif
+		scans[i].zipfile = CopyString( pakfile );
+		count++;
+	}
 
-	Com_Printf( "...found %i cached paks\n", fs_paksCached );
-}
+	// a single pak is not worth the threads, FS_LoadZipFile() reads it itself
+	if ( count < 2 ) {
+		FS_FreeZipScans( scans, numfiles );
+		return NULL;
+	}
 
-#endif // USE_PK3_CACHE_FILE
+	jobs.scans = scans;
+	jobs.count = numfiles;
+	jobs.next = 0;
+	Sys_RunThreads( FS_ScanZipFilesThread, &jobs, MIN( numThreads, count ) );
 
-#endif // USE_PK3_CACHE
+	return scans;
+}
 
 
 /*
@@ -2938,22 +4918,17 @@ static void FS_LoadCache( void )
 FS_LoadZipFile
 
 Creates a new pak_t in the search chain for the contents
-of a zip file.
+of a zip file, scan may hold its already parsed directory
 =================
 */
-static pack_t *FS_LoadZipFile( const char *zipfile )
+static pack_t *FS_LoadZipFile( const char *zipfile, fsZipScan_t *scan )
 {
 	fileInPack_t	*curFile;
 	pack_t			*pack;
-	unzFile			uf;
-	int				err;
-	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
-	unz_file_info	file_info;
+	fsZipScan_t		local;
+	const fsZipEntry_t *entry;
 	unsigned int	i, namelen, hashSize, size;
 	long			hash;
-	int				fs_numHeaderLongs;
-	int				*fs_headerLongs;
 	int				filecount;
 	char			*namePtr;
 	const char		*basename;
@@ -2964,15 +4939,7 @@ static pack_t *FS_LoadZipFile( const char *zipfile )
 	pack = FS_LoadCachedPK3( zipfile );
 	if ( pack )
 	{
-		// update pure checksum
-		if ( pack->checksumFeed != fs_checksumFeed )
-		{
-			pack->headerLongs[ 0 ] = LittleLong( fs_checksumFeed );
-			pack->pure_checksum = Com_BlockChecksum( pack->headerLongs, sizeof( pack->headerLongs[0] ) * pack->numHeaderLongs );
-			pack->pure_checksum = LittleLong( pack->pure_checksum );
-			pack->checksumFeed = fs_checksumFeed;
-		}
-
+		// pure checksum is updated on first use
 		pack->touched = qtrue;
 		return pack; // loaded from cache
 	}
@@ -2989,35 +4956,22 @@ static pack_t *FS_LoadZipFile( const char *zipfile )
 	fileNameLen = (int) strlen( zipfile ) + 1;
 	baseNameLen = (int) strlen( basename ) + 1;
 
-	uf = unzOpen( zipfile );
-	err = unzGetGlobalInfo( uf, &gi );
-
-	if ( err != UNZ_OK ) {
-		return NULL;
+	if ( scan == NULL ) {
+		Com_Memset( &local, 0, sizeof( local ) );
+		local.zipfile = (char *)zipfile;
+		FS_ScanZipFile( &local );
+		scan = &local;
 	}
 
-	namelen = 0;
-	filecount = 0;
-	unzGoToFirstFile( uf );
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		filename_inzip[sizeof(filename_inzip)-1] = '\0';
-		if (err != UNZ_OK) {
-			break;
+	for ( i = 0, entry = scan->entries; i < scan->numEntries; i++, entry++ ) {
+		if ( entry->method != 0 && entry->method != 8 /*Z_DEFLATED*/ ) {
+			Com_Printf( S_COLOR_YELLOW "%s|%s: unsupported compression method %i\n", basename, entry->name, entry->method );
 		}
-		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
-			Com_Printf( S_COLOR_YELLOW "%s|%s: unsupported compression method %i\n", basename, filename_inzip, (int)file_info.compression_method );
-			unzGoToNextFile( uf );
-			continue;
-		} 
-		namelen += strlen( filename_inzip ) + 1;
-		unzGoToNextFile( uf );
-		filecount++;
 	}
 
+	filecount = scan->numFiles;
 	if ( filecount == 0 ) {
-		unzClose( uf );
+		FS_FreeZipScan( scan );
 		return NULL;
 	}
 
@@ -3025,17 +4979,16 @@ static pack_t *FS_LoadZipFile( const char *zipfile )
 	// because lots of custom pk3 files have less than 32 or 64 files
 	hashSize = FS_PakHashSize( filecount );
 
-	namelen = PAD( namelen, sizeof( int ) );
+	namelen = PAD( scan->namelen, sizeof( int ) );
 	size = sizeof( *pack ) + hashSize * sizeof( pack->hashTable[0] ) + filecount * sizeof( pack->buildBuffer[0] ) + namelen;
 	size += PAD( fileNameLen, sizeof( int ) );
 	size += PAD( baseNameLen, sizeof( int ) );
 #ifdef USE_PK3_CACHE
-	size += ( filecount + 1 ) * sizeof( fs_headerLongs[0] );
+	size += scan->numHeaderLongs * sizeof( pack->headerLongs[0] );
 #endif
 	pack = Z_TagMalloc( size, TAG_PACK );
 	Com_Memset( pack, 0, size );
 
-	pack->handle = uf;
 	pack->numfiles = filecount;
 	pack->hashSize = hashSize;
 	pack->hashTable = (fileInPack_t **)( pack + 1 );
@@ -3046,80 +4999,55 @@ static pack_t *FS_LoadZipFile( const char *zipfile )
 	pack->pakFilename = (char*)( namePtr + namelen );
 	pack->pakBasename = (char*)( pack->pakFilename + PAD( fileNameLen, sizeof( int ) ) );
 
-#ifdef USE_PK3_CACHE
-	fs_headerLongs = (int*)( pack->pakBasename + PAD( baseNameLen, sizeof( int ) ) );
-#else
-	fs_headerLongs = Z_Malloc( ( filecount + 1 ) * sizeof( fs_headerLongs[0] ) );
-#endif
-
-	fs_numHeaderLongs = 0;
-	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
-
 	Com_Memcpy( pack->pakFilename, zipfile, fileNameLen );
 	Com_Memcpy( pack->pakBasename, basename, baseNameLen );
 
 	// strip .pk3 if needed
 	FS_StripExt( pack->pakBasename, ".pk3" );
 
-	unzGoToFirstFile( uf );
 	curFile = pack->buildBuffer;
-	for ( i = 0; i < gi.number_entry; i++ )
+	for ( i = 0, entry = scan->entries; i < scan->numEntries; i++, entry++ )
 	{
-		err = unzGetCurrentFileInfo( uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0 );
-		filename_inzip[sizeof(filename_inzip)-1] = '\0';
-		if (err != UNZ_OK) {
-			break;
-		}
-		if ( file_info.compression_method != 0 && file_info.compression_method != 8 /*Z_DEFLATED*/ ) {
-			unzGoToNextFile( uf );
+		if ( entry->method != 0 && entry->method != 8 /*Z_DEFLATED*/ ) {
 			continue;
-		} 
-		if ( file_info.uncompressed_size > 0 ) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong( file_info.crc );
 		}
 
-		FS_ConvertFilename( filename_inzip );
-		if ( !FS_BannedPakFile( filename_inzip ) ) {
+		if ( !entry->banned ) {
 			// store the file position in the zip
-			unzGetCurrentFileInfoPosition( uf, &curFile->pos );
-			curFile->size = file_info.uncompressed_size;
+			curFile->pos = entry->pos;
+			curFile->size = entry->size;
 			curFile->name = namePtr;
-			strcpy( curFile->name, filename_inzip );
-			namePtr += strlen( filename_inzip ) + 1;
+			strcpy( curFile->name, entry->name );
+			namePtr += strlen( entry->name ) + 1;
 
 			// update hash table
-			hash = FS_HashFileName( filename_inzip, pack->hashSize );
+			hash = entry->fullHash & ( pack->hashSize - 1 );
 			curFile->next = pack->hashTable[ hash ];
 			pack->hashTable[ hash ] = curFile; 
 			curFile++;
 		} else {
 			pack->numfiles--;
 		}
-
-		unzGoToNextFile( uf );
 	}
 
-	pack->checksum = Com_BlockChecksum( fs_headerLongs + 1, sizeof( fs_headerLongs[0] ) * ( fs_numHeaderLongs - 1 ) );
-	pack->checksum = LittleLong( pack->checksum );
-
-	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, sizeof( fs_headerLongs[0] ) * fs_numHeaderLongs );
-	pack->pure_checksum = LittleLong( pack->pure_checksum );
+	pack->checksum = scan->checksum;
+	pack->pure_checksum = scan->pure_checksum;
 
 #ifdef USE_PK3_CACHE
-	pack->headerLongs = fs_headerLongs;
-	pack->numHeaderLongs = fs_numHeaderLongs;
+	pack->headerLongs = (int*)( pack->pakBasename + PAD( baseNameLen, sizeof( int ) ) );
+	pack->numHeaderLongs = scan->numHeaderLongs;
 	pack->checksumFeed = fs_checksumFeed;
-#else
-	Z_Free( fs_headerLongs );
+	pack->pureChecksumValid = qtrue;
+	Com_Memcpy( pack->headerLongs, scan->headerLongs, scan->numHeaderLongs * sizeof( pack->headerLongs[0] ) );
 #endif
 
-#ifdef USE_HANDLE_CACHE
-	FS_AddToHandleList( pack );
-#else
-	if ( fs_locked->integer == 0 )
+	FS_FreeZipScan( scan );
+
+	// zip handles are opened on first use
+#ifndef USE_HANDLE_CACHE
+	if ( fs_locked->integer )
 	{
-		unzClose( pack->handle );
-		pack->handle = NULL;
+		pack->handle = unzOpen( zipfile );
 	}
 #endif
 
@@ -3153,6 +5081,18 @@ static void FS_FreePak( pack_t *pak )
 		pak->handle = NULL;
 	}
 
+	if ( pak->mapData )
+	{
+		Sys_UnmapFile( pak->mapData, pak->mapSize );
+		pak->mapData = NULL;
+	}
+
+	if ( pak->sortedFiles )
+	{
+		Z_Free( pak->sortedFiles );
+		pak->sortedFiles = NULL;
+	}
+
 	Z_Free( pak );
 }
 
@@ -3169,7 +5109,7 @@ qboolean FS_CompareZipChecksum(const char *zipfile)
 	pack_t *thepak;
 	int index, checksum;
 	
-	thepak = FS_LoadZipFile( zipfile );
+	thepak = FS_LoadZipFile( zipfile, NULL );
 	
 	if ( !thepak )
 		return qfalse;
@@ -3199,7 +5139,7 @@ int FS_GetZipChecksum( const char *zipfile )
 	pack_t *pak;
 	int checksum;
 	
-	pak = FS_LoadZipFile( zipfile );
+	pak = FS_LoadZipFile( zipfile, NULL );
 	
 	if ( !pak )
 		return 0xFFFFFFFF;
@@ -3254,29 +5194,165 @@ char *FS_CopyString( const char *in ) {
 }
 
 
+static char *fs_modList;		// cached FS_GetModList() result
+static int fs_modListLength;
+static int fs_modListCount;
+static int fs_modListBufSize;
+
+
+/*
+==================
+FS_FreeModList
+==================
+*/
+static void FS_FreeModList( void ) {
+	if ( fs_modList ) {
+		Z_Free( fs_modList );
+		fs_modList = NULL;
+	}
+	fs_modListLength = 0;
+	fs_modListCount = 0;
+	fs_modListBufSize = 0;
+}
+
+
+#define FS_LIST_HASH_SIZE 4096
+
+static int fs_listHash[ FS_LIST_HASH_SIZE ];	// first list entry for each hash, -1 if none
+static int fs_listNext[ MAX_FOUND_FILES ];
+
+
 /*
 ==================
 FS_AddFileToList
+
+fs_listHash must be cleared before adding the first file
 ==================
 */
 static int FS_AddFileToList( const char *name, char **list, int nfiles ) {
+	unsigned long hash;
 	int		i;
 
 	if ( nfiles == MAX_FOUND_FILES - 1 ) {
 		return nfiles;
 	}
-	for ( i = 0 ; i < nfiles ; i++ ) {
+	hash = FS_HashFileName( name, FS_LIST_HASH_SIZE );
+	for ( i = fs_listHash[ hash ]; i >= 0; i = fs_listNext[ i ] ) {
 		if ( !Q_stricmp( name, list[i] ) ) {
 			return nfiles; // already in list
 		}
 	}
 	list[ nfiles ] = FS_CopyString( name );
+	fs_listNext[ nfiles ] = fs_listHash[ hash ];
+	fs_listHash[ hash ] = nfiles;
 	nfiles++;
 
 	return nfiles;
 }
 
 
+/*
+==================
+FS_ListChar
+
+Folds characters the way both Q_stricmpn() and Com_FilterPath() consider
+them equal, so that any name they match falls into a single sorted range
+==================
+*/
+static int FS_ListChar( char c ) {
+	if ( c == '\\' || c == ':' ) {
+		return '/';
+	}
+	return locase[ (byte)c ];
+}
+
+
+/*
+==================
+FS_ListCompare
+==================
+*/
+static int FS_ListCompare( const void *a, const void *b ) {
+	const char *s1 = (*(const fileInPack_t * const *)a)->name;
+	const char *s2 = (*(const fileInPack_t * const *)b)->name;
+	int c1, c2;
+
+	do {
+		c1 = FS_ListChar( *s1++ );
+		c2 = FS_ListChar( *s2++ );
+	} while ( c1 == c2 && c1 );
+
+	return c1 - c2;
+}
+
+
+/*
+==================
+FS_ListPrefixCompare
+==================
+*/
+static int FS_ListPrefixCompare( const char *name, const char *prefix, int prefixLen ) {
+	int i, c1, c2;
+
+	for ( i = 0; i < prefixLen; i++ ) {
+		c1 = FS_ListChar( name[i] );
+		c2 = FS_ListChar( prefix[i] );
+		if ( c1 != c2 ) {
+			return c1 - c2;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+==================
+FS_PakListRange
+
+Returns the range of pak files starting with prefix, sorting pak files on first use
+==================
+*/
+static fileInPack_t **FS_PakListRange( pack_t *pak, const char *prefix, int prefixLen, int *count ) {
+	int i, low, high, mid;
+
+	if ( !pak->sortedFiles ) {
+		pak->sortedFiles = Z_TagMalloc( pak->numfiles * sizeof( pak->sortedFiles[0] ), TAG_PACK );
+		for ( i = 0; i < pak->numfiles; i++ ) {
+			pak->sortedFiles[i] = &pak->buildBuffer[i];
+		}
+		qsort( pak->sortedFiles, pak->numfiles, sizeof( pak->sortedFiles[0] ), FS_ListCompare );
+	}
+
+	// first file not below prefix
+	low = 0;
+	high = pak->numfiles;
+	while ( low < high ) {
+		mid = ( low + high ) >> 1;
+		if ( FS_ListPrefixCompare( pak->sortedFiles[mid]->name, prefix, prefixLen ) < 0 ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	// first file above prefix
+	i = low;
+	high = pak->numfiles;
+	while ( low < high ) {
+		mid = ( low + high ) >> 1;
+		if ( FS_ListPrefixCompare( pak->sortedFiles[mid]->name, prefix, prefixLen ) <= 0 ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	*count = low - i;
+	return pak->sortedFiles + i;
+}
+
+
 /*
 ===============
 FS_AllowListExternal
@@ -3325,7 +5401,9 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 	int				extLen;
 	int				length, pathDepth, temp;
 	pack_t			*pak;
-	fileInPack_t	*buildBuffer;
+	fileInPack_t	**range;
+	int				rangeCount;
+	int				filterLength;
 	char			zpath[MAX_ZPATH];
 	qboolean		hasPatterns;
 	const char		*x;
@@ -3362,6 +5440,16 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 	nfiles = 0;
 	FS_ReturnPath(path, zpath, &pathDepth);
 
+	// filter matching is anchored, so its leading literal part is a prefix of all matches
+	filterLength = 0;
+	if ( filter ) {
+		while ( filter[ filterLength ] && filterLength < MAX_QPATH - 1 && !strchr( "*?[", filter[ filterLength ] ) ) {
+			filterLength++;
+		}
+	}
+
+	Com_Memset( fs_listHash, -1, sizeof( fs_listHash ) );
+
 	//
 	// search through the path, one element at a time, adding to list
 	//
@@ -3375,15 +5463,19 @@ static char **FS_ListFilteredFiles( const char *path, const char *extension, con
 				continue;
 			}
 
-			// look through all the pak file elements
+			// look through pak file elements with a matching prefix
 			pak = search->pack;
-			buildBuffer = pak->buildBuffer;
-			for (i = 0; i < pak->numfiles; i++) {
+			if ( filter ) {
+				range = FS_PakListRange( pak, filter, filterLength, &rangeCount );
+			} else {
+				range = FS_PakListRange( pak, path, pathLength, &rangeCount );
+			}
+			for (i = 0; i < rangeCount; i++) {
 				const char *name;
 				int zpathLen, depth;
 
 				// check for directory match
-				name = buildBuffer[i].name;
+				name = range[i]->name;
 				//
 				if ( filter ) {
 					// case insensitive
@@ -3644,13 +5736,13 @@ static void FS_GetModDescription( const char *modDir, char *description, int des
 
 /*
 ================
-FS_GetModList
+FS_ScanModList
 
 Returns a list of mod directory names
 A mod directory is a peer to baseq3 with a pk3 in it
 ================
 */
-static int FS_GetModList( char *listbuf, int bufsize ) {
+static int FS_ScanModList( char *listbuf, int bufsize ) {
 	int i, j, k;
 	int	nMods, nTotal, nLen, nPaks, nPotential, nDescLen;
 	int nDirs, nPakDirs;
@@ -3756,6 +5848,43 @@ static int FS_GetModList( char *listbuf, int bufsize ) {
 }
 
 
+/*
+================
+FS_GetModList
+
+Scanning every directory in all base paths is slow on large installs,
+so the result is kept until filesystem restart or until the engine creates
+a directory or finishes a download, mods added by hand show up after restart
+================
+*/
+static int FS_GetModList( char *listbuf, int bufsize ) {
+	const char *s;
+	int i;
+
+	if ( fs_modList && fs_modListBufSize == bufsize ) {
+		Com_Memcpy( listbuf, fs_modList, fs_modListLength );
+		return fs_modListCount;
+	}
+
+	FS_FreeModList();
+
+	fs_modListCount = FS_ScanModList( listbuf, bufsize );
+	fs_modListBufSize = bufsize;
+
+	// name and description for each mod
+	s = listbuf;
+	for ( i = 0; i < fs_modListCount * 2; i++ ) {
+		s += strlen( s ) + 1;
+	}
+	fs_modListLength = MAX( (int)( s - listbuf ), 1 );
+
+	fs_modList = Z_Malloc( fs_modListLength );
+	Com_Memcpy( fs_modList, listbuf, fs_modListLength );
+
+	return fs_modListCount;
+}
+
+
 //============================================================================
 
 /*
@@ -4088,6 +6217,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	int				pakwhich;
 	int				path_len;
 	int				dir_len;
+	fsZipScan_t		*scans;
 
 	for ( sp = fs_searchpaths ; sp ; sp = sp->next ) {
 		if ( sp->dir && !Q_stricmp( sp->dir->path, path ) && !Q_stricmp( sp->dir->gamedir, dir )) {
@@ -4129,6 +6259,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	if ( numfiles >= 2 )
 		FS_SortFileList( pakfiles, numfiles - 1 );
 
+	// parse pk3 directories in parallel, they are still added in order below
+	scans = FS_ScanZipFiles( path, dir, pakfiles, numfiles );
+
 	pakfilesi = 0;
 	pakdirsi = 0;
 
@@ -4170,7 +6303,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 			// The next .pk3 file is before the next .pk3dir
 			pakfile = FS_BuildOSPath( path, dir, pakfiles[pakfilesi] );
-			if ( (pak = FS_LoadZipFile( pakfile ) ) == NULL ) {
+			if ( (pak = FS_LoadZipFile( pakfile, ( scans && scans[pakfilesi].zipfile ) ? &scans[pakfilesi] : NULL ) ) == NULL ) {
 				// This isn't a .pk3! Next!
 				pakfilesi++;
 				continue;
@@ -4230,6 +6363,10 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 		}
 	}
 
+	if ( scans ) {
+		FS_FreeZipScans( scans, numfiles );
+	}
+
 	// done
 	Sys_FreeFileList( pakdirs );
 	Sys_FreeFileList( pakfiles );
@@ -4428,6 +6565,9 @@ void FS_Shutdown( qboolean closemfp )
 	}
 #endif
 
+	// background reads may still use pak mappings
+	FS_AsyncShutdown();
+
 #ifdef USE_PK3_CACHE
 	FS_ResetCacheReferences();
 #endif
@@ -4449,10 +6589,16 @@ void FS_Shutdown( qboolean closemfp )
 #endif
 			p->pack = NULL;
 		}
-
-		Z_Free( p );
 	}
 
+	FS_FreeIndex();
+	FS_FreeModList();
+
+	// search paths are arena-allocated so release them per tag
+	Z_FreeTags( TAG_SEARCH_PATH );
+	Z_FreeTags( TAG_SEARCH_PACK );
+	Z_FreeTags( TAG_SEARCH_DIR );
+
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
 	fs_packFiles = 0;
@@ -4468,6 +6614,7 @@ void FS_Shutdown( qboolean closemfp )
 	Cmd_RemoveCommand( "which" );
 	Cmd_RemoveCommand( "lsof" );
 	Cmd_RemoveCommand( "fs_restart" );
+	Cmd_RemoveCommand( "fs_cacheinfo" );
 }
 
 
@@ -4592,11 +6739,13 @@ FS_LoadedPakPureChecksums
 */
 static int fs_numPureChecksums;
 static int fs_pureChecksum[ MAX_FOUND_FILES ];
+static qboolean fs_pureChecksumsLoaded;
 
 static void FS_LoadedPakPureChecksums( void )
 {
 	const searchpath_t *search;
 
+	fs_pureChecksumsLoaded = qtrue;
 	fs_numPureChecksums = 0;
 	for ( search = fs_searchpaths ; search ; search = search->next ) {
 		if ( search->pack ) {
@@ -4605,7 +6754,7 @@ static void FS_LoadedPakPureChecksums( void )
 				fs_numPureChecksums = 0;
 				return;
 			}
-			fs_pureChecksum[ fs_numPureChecksums ] = search->pack->pure_checksum;
+			fs_pureChecksum[ fs_numPureChecksums ] = FS_PakPureChecksum( search->pack );
 			fs_numPureChecksums++;
 		}
 	}
@@ -4621,6 +6770,9 @@ qboolean FS_IsPureChecksum( int sum )
 {
 	int i;
 
+	if ( !fs_pureChecksumsLoaded )
+		FS_LoadedPakPureChecksums();
+
 	if ( fs_numPureChecksums == 0 )
 		return qtrue;
 	
@@ -4644,6 +6796,25 @@ static void FS_Startup( void ) {
 	Com_Printf( "----- FS_Startup -----\n" );
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
+	fs_index = Cvar_Get( "fs_index", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_index, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( fs_index, "Look up files through a merged index of all search paths, rebuilt on fs_restart" );
+
+	fs_mmap = Cvar_Get( "fs_mmap", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_mmap, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( fs_mmap, "Read pk3 files through memory mappings, stored models, maps and images are used in place without copying. Requires fs_index" );
+
+	fs_cacheMegs = Cvar_Get( "fs_cacheMegs", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_cacheMegs, "0", "1024", CV_INTEGER );
+	Cvar_SetDescription( fs_cacheMegs, "Size of the decompressed pk3 file cache in megabytes, repeated reads of the same files are served from memory. Requires fs_index. See fs_cacheinfo for statistics" );
+
+	fs_ioThreads = Cvar_Get( "fs_ioThreads", "2", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_ioThreads, "0", XSTRING( MAX_IO_THREADS ), CV_INTEGER );
+	Cvar_SetDescription( fs_ioThreads, "Number of background threads reading files requested ahead of time, e.g. map textures and sounds, 0 - files are read when first used. Requires fs_index" );
+
+	fs_scanThreads = Cvar_Get( "fs_scanThreads", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_scanThreads, "0", XSTRING( MAX_SYS_THREADS ), CV_INTEGER );
+	Cvar_SetDescription( fs_scanThreads, "Number of threads parsing pk3 directories at filesystem startup, 0 - one per CPU core up to " XSTRING( MAX_SCAN_THREADS ) ", 1 - no worker threads" );
 	fs_copyfiles = Cvar_Get( "fs_copyfiles", "0", CVAR_INIT );
 	fs_basepath = Cvar_Get( "fs_basepath", Sys_DefaultBasePath(), CVAR_INIT | CVAR_PROTECTED | CVAR_PRIVATE );
 	fs_basegame = Cvar_Get( "fs_basegame", BASEGAME, CVAR_INIT | CVAR_PROTECTED );
@@ -4722,8 +6893,12 @@ static void FS_Startup( void ) {
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
 
-	// get the pure checksums of the pk3 files loaded by the server
-	FS_LoadedPakPureChecksums();
+	// merged lookup index for the final search order
+	FS_BuildIndex();
+
+	// pure checksums of the pk3 files loaded by the server depend from
+	// the checksum feed, they are collected on first FS_IsPureChecksum()
+	fs_pureChecksumsLoaded = qfalse;
 
 	end = Sys_Milliseconds();
 
@@ -4742,6 +6917,7 @@ static void FS_Startup( void ) {
  	Cmd_AddCommand( "which", FS_Which_f );
 	Cmd_SetCommandCompletionFunc( "which", FS_CompleteFileName );
 	Cmd_AddCommand( "fs_restart", FS_Reload );
+	Cmd_AddCommand( "fs_cacheinfo", FS_CacheInfo_f );
 
 	// print the current search paths
 	//FS_Path_f();
@@ -4749,6 +6925,9 @@ static void FS_Startup( void ) {
 
 	Com_Printf( "----------------------\n" );
 	Com_Printf( "%d files in %d pk3 files\n", fs_packFiles, fs_packCount );
+	if ( fs_indexSize ) {
+		Com_Printf( "%d files in index\n", fs_indexFiles );
+	}
 
 	fs_gamedirvar->modified = qfalse; // We just loaded, it's not modified
 
@@ -5044,13 +7223,13 @@ const char *FS_ReferencedPakPureChecksums( int maxlen ) {
 		for ( search = fs_searchpaths ; search ; search = search->next ) {
 			// is the element a pak file and has it been referenced based on flag?
 			if ( search->pack && (search->pack->referenced & nFlags)) {
-				s = Q_stradd( s, va( "%i ", search->pack->pure_checksum ) );
+				s = Q_stradd( s, va( "%i ", FS_PakPureChecksum( search->pack ) ) );
 				if ( s > max ) // client-side overflow
 					break;
 				if ( nFlags & (FS_CGAME_REF | FS_UI_REF) ) {
 					break;
 				}
-				checksum ^= search->pack->pure_checksum;
+				checksum ^= FS_PakPureChecksum( search->pack );
 				numPaks++;
 			}
 		}
@@ -5422,6 +7601,8 @@ qboolean FS_ConditionalRestart( int checksumFeed, qboolean clientRestart )
 	else if( fs_numServerPaks && !fs_reordered ) 
 	{
 		FS_ReorderPurePaks();
+		if ( fs_reordered )
+			FS_BuildIndex();
 	}
 	
 	return qfalse;
@@ -5696,6 +7877,8 @@ fileHandle_t FS_PipeOpenWrite( const char *cmd, const char *filename ) {
 	fd->handleSync = qfalse;
 	fd->zipFile = qfalse;
 
+	FS_IndexAddFile( fs_homepath->string, fs_gamedir, filename );
+
 	return f;
 }
 
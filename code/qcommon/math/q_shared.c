@@ -245,32 +245,220 @@ int Com_Split( char *in, char **out, int outsz, int delim )
 /*
 ==================
 crc32_buffer
+
+Reflected CRC-32 (zip/png polynomial). Uses carry-less multiplication
+folding on x86 CPUs that support PCLMULQDQ, the ARMv8 CRC32 instructions
+when the target has them and slicing-by-8 tables otherwise.
 ==================
 */
-unsigned int crc32_buffer( const byte *buf, unsigned int len ) {
-	static unsigned int crc32_table[256];
-	static qboolean crc32_inited = qfalse;
+#if (idx64 || id386) && (defined(_MSC_VER) || defined(__GNUC__))
+#define USE_CRC32_PCLMUL
+#endif
 
-	unsigned int crc = 0xFFFFFFFFUL;
+#if defined(__ARM_FEATURE_CRC32)
+#define USE_CRC32_ARM
+#endif
 
-	if ( !crc32_inited )
+#ifdef USE_CRC32_PCLMUL
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_TARGET
+#else
+#include <cpuid.h>
+#define CRC32_TARGET __attribute__((target("sse2,pclmul")))
+#endif
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#ifdef USE_CRC32_ARM
+#include <arm_acle.h>
+#endif
+
+static unsigned int crc32_table[8][256];
+static qboolean crc32_inited = qfalse;
+#ifdef USE_CRC32_PCLMUL
+static qboolean crc32_pclmul = qfalse;
+#endif
+
+static void crc32_init( void )
+{
+	unsigned int c;
+	int i, j;
+
+	for ( i = 0; i < 256; i++ )
 	{
-		unsigned int c;
-		int i, j;
+		c = i;
+		for ( j = 0; j < 8; j++ )
+			c = (c & 1) ? (c >> 1) ^ 0xEDB88320UL : c >> 1;
+		crc32_table[0][i] = c;
+	}
 
-		for (i = 0; i < 256; i++)
+	for ( i = 0; i < 256; i++ )
+	{
+		c = crc32_table[0][i];
+		for ( j = 1; j < 8; j++ )
 		{
-			c = i;
-			for ( j = 0; j < 8; j++ )
-				c = (c & 1) ? (c >> 1) ^ 0xEDB88320UL : c >> 1;
-			crc32_table[i] = c;
+			c = crc32_table[0][c & 0xFF] ^ (c >> 8);
+			crc32_table[j][i] = c;
 		}
-		crc32_inited = qtrue;
+	}
+
+#ifdef USE_CRC32_PCLMUL
+	{
+		unsigned int regs[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+		__cpuid( (int*)regs, 1 );
+#else
+		__get_cpuid( 1, &regs[0], &regs[1], &regs[2], &regs[3] );
+#endif
+		// bit 1 of ECX denotes PCLMULQDQ, bit 26 of EDX denotes SSE2
+		if ( ( regs[2] & ( 1 << 1 ) ) && ( regs[3] & ( 1 << 26 ) ) )
+			crc32_pclmul = qtrue;
+	}
+#endif
+
+	crc32_inited = qtrue;
+}
+
+
+#ifdef USE_CRC32_PCLMUL
+/*
+==================
+crc32_fold_pclmul
+
+Folds 64-byte blocks with carry-less multiplication and reduces the
+remainder with a Barrett step, see Intel's "Fast CRC Computation for
+Generic Polynomials Using PCLMULQDQ Instruction".
+len must be at least 64 and a multiple of 16.
+==================
+*/
+static CRC32_TARGET unsigned int crc32_fold_pclmul( const byte *buf, unsigned int len, unsigned int crc )
+{
+	const __m128i k1k2 = _mm_set_epi64x( 0x01c6e41596LL, 0x0154442bd4LL );
+	const __m128i k3k4 = _mm_set_epi64x( 0x00ccaa009eLL, 0x01751997d0LL );
+	const __m128i k5k0 = _mm_set_epi64x( 0x0000000000LL, 0x0163cd6124LL );
+	const __m128i poly = _mm_set_epi64x( 0x01f7011641LL, 0x01db710641LL );
+	const __m128i mask = _mm_setr_epi32( ~0, 0, ~0, 0 );
+	__m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128( (const __m128i*)( buf + 0x00 ) );
+	x2 = _mm_loadu_si128( (const __m128i*)( buf + 0x10 ) );
+	x3 = _mm_loadu_si128( (const __m128i*)( buf + 0x20 ) );
+	x4 = _mm_loadu_si128( (const __m128i*)( buf + 0x30 ) );
+	x1 = _mm_xor_si128( x1, _mm_cvtsi32_si128( (int)crc ) );
+	buf += 64;
+	len -= 64;
+
+	// fold four lanes in parallel
+	while ( len >= 64 )
+	{
+		x5 = _mm_clmulepi64_si128( x1, k1k2, 0x00 );
+		x6 = _mm_clmulepi64_si128( x2, k1k2, 0x00 );
+		x7 = _mm_clmulepi64_si128( x3, k1k2, 0x00 );
+		x8 = _mm_clmulepi64_si128( x4, k1k2, 0x00 );
+
+		x1 = _mm_clmulepi64_si128( x1, k1k2, 0x11 );
+		x2 = _mm_clmulepi64_si128( x2, k1k2, 0x11 );
+		x3 = _mm_clmulepi64_si128( x3, k1k2, 0x11 );
+		x4 = _mm_clmulepi64_si128( x4, k1k2, 0x11 );
+
+		x1 = _mm_xor_si128( _mm_xor_si128( x1, x5 ), _mm_loadu_si128( (const __m128i*)( buf + 0x00 ) ) );
+		x2 = _mm_xor_si128( _mm_xor_si128( x2, x6 ), _mm_loadu_si128( (const __m128i*)( buf + 0x10 ) ) );
+		x3 = _mm_xor_si128( _mm_xor_si128( x3, x7 ), _mm_loadu_si128( (const __m128i*)( buf + 0x20 ) ) );
+		x4 = _mm_xor_si128( _mm_xor_si128( x4, x8 ), _mm_loadu_si128( (const __m128i*)( buf + 0x30 ) ) );
+
+		buf += 64;
+		len -= 64;
+	}
+
+	// fold the lanes into one
+	x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x2 ), x5 );
+
+	x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x3 ), x5 );
+
+	x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x4 ), x5 );
+
+	// remaining 16-byte blocks
+	while ( len >= 16 )
+	{
+		x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+		x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+		x1 = _mm_xor_si128( _mm_xor_si128( x1, _mm_loadu_si128( (const __m128i*)buf ) ), x5 );
+		buf += 16;
+		len -= 16;
+	}
+
+	// 128 -> 64 bits
+	x2 = _mm_clmulepi64_si128( x1, k3k4, 0x10 );
+	x1 = _mm_xor_si128( _mm_srli_si128( x1, 8 ), x2 );
+
+	x2 = _mm_srli_si128( x1, 4 );
+	x1 = _mm_and_si128( x1, mask );
+	x1 = _mm_clmulepi64_si128( x1, k5k0, 0x00 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_and_si128( x1, mask );
+	x2 = _mm_clmulepi64_si128( x2, poly, 0x10 );
+	x2 = _mm_and_si128( x2, mask );
+	x2 = _mm_clmulepi64_si128( x2, poly, 0x00 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	return (unsigned int)_mm_cvtsi128_si32( _mm_srli_si128( x1, 4 ) );
+}
+#endif // USE_CRC32_PCLMUL
+
+
+unsigned int crc32_buffer( const byte *buf, unsigned int len ) {
+	unsigned int crc = 0xFFFFFFFFUL;
+	unsigned int one, two;
+
+	if ( !crc32_inited )
+		crc32_init();
+
+#ifdef USE_CRC32_PCLMUL
+	if ( crc32_pclmul && len >= 64 )
+	{
+		unsigned int n = len & ~15U;
+		crc = crc32_fold_pclmul( buf, n, crc );
+		buf += n;
+		len -= n;
+	}
+#endif
+
+#ifdef USE_CRC32_ARM
+	while ( len >= 8 )
+	{
+		uint64_t v;
+		memcpy( &v, buf, 8 );
+		crc = __crc32d( crc, v );
+		buf += 8;
+		len -= 8;
+	}
+#endif
+
+	while ( len >= 8 )
+	{
+		one = ( buf[0] | ( buf[1] << 8 ) | ( buf[2] << 16 ) | ( (unsigned int)buf[3] << 24 ) ) ^ crc;
+		two = ( buf[4] | ( buf[5] << 8 ) | ( buf[6] << 16 ) | ( (unsigned int)buf[7] << 24 ) );
+		crc = crc32_table[7][one & 0xFF] ^ crc32_table[6][(one >> 8) & 0xFF] ^
+			crc32_table[5][(one >> 16) & 0xFF] ^ crc32_table[4][one >> 24] ^
+			crc32_table[3][two & 0xFF] ^ crc32_table[2][(two >> 8) & 0xFF] ^
+			crc32_table[1][(two >> 16) & 0xFF] ^ crc32_table[0][two >> 24];
+		buf += 8;
+		len -= 8;
 	}
 
 	while ( len-- )
 	{
-		crc = crc32_table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+		crc = crc32_table[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
 	}
 
 	return crc ^ 0xFFFFFFFFUL;
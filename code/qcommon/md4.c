@@ -36,15 +36,15 @@ struct mdfour {
 };
 
 
-/* NOTE: This code makes no attempt to be fast!
+/* The state is passed around explicitly so pk3 directories can be
+   checksummed from several threads, message words are copied in one
+   go on little-endian targets.
 
    It assumes that an int is at least 32 bits long
 */
 
-static struct mdfour *m;
-
-#define F(X,Y,Z) (((X)&(Y)) | ((~(X))&(Z)))
-#define G(X,Y,Z) (((X)&(Y)) | ((X)&(Z)) | ((Y)&(Z)))
+#define F(X,Y,Z) ((((Y)^(Z))&(X))^(Z))
+#define G(X,Y,Z) (((X)&(Y)) | ((Z)&((X)|(Y))))
 #define H(X,Y,Z) ((X)^(Y)^(Z))
 #define lshift(x,s) (((x)<<(s)) | ((x)>>(32-(s))))
 
@@ -53,56 +53,47 @@ static struct mdfour *m;
 #define ROUND3(a,b,c,d,k,s) a = lshift(a + H(b,c,d) + X[k] + 0x6ED9EBA1,s)
 
 /* this applies md4 to 64 byte chunks */
-static void mdfour64(uint32_t *M)
+static void mdfour64(struct mdfour *md, const uint32_t *X)
 {
-	int j;
-	uint32_t AA, BB, CC, DD;
-	uint32_t X[16];
 	uint32_t A,B,C,D;
 
-	for (j=0;j<16;j++)
-		X[j] = M[j];
-
-	A = m->A; B = m->B; C = m->C; D = m->D;
-	AA = A; BB = B; CC = C; DD = D;
+	A = md->A; B = md->B; C = md->C; D = md->D;
 
-        ROUND1(A,B,C,D,  0,  3);  ROUND1(D,A,B,C,  1,  7);
+	ROUND1(A,B,C,D,  0,  3);  ROUND1(D,A,B,C,  1,  7);
 	ROUND1(C,D,A,B,  2, 11);  ROUND1(B,C,D,A,  3, 19);
-        ROUND1(A,B,C,D,  4,  3);  ROUND1(D,A,B,C,  5,  7);
+	ROUND1(A,B,C,D,  4,  3);  ROUND1(D,A,B,C,  5,  7);
 	ROUND1(C,D,A,B,  6, 11);  ROUND1(B,C,D,A,  7, 19);
-        ROUND1(A,B,C,D,  8,  3);  ROUND1(D,A,B,C,  9,  7);
+	ROUND1(A,B,C,D,  8,  3);  ROUND1(D,A,B,C,  9,  7);
 	ROUND1(C,D,A,B, 10, 11);  ROUND1(B,C,D,A, 11, 19);
-        ROUND1(A,B,C,D, 12,  3);  ROUND1(D,A,B,C, 13,  7);
+	ROUND1(A,B,C,D, 12,  3);  ROUND1(D,A,B,C, 13,  7);
 	ROUND1(C,D,A,B, 14, 11);  ROUND1(B,C,D,A, 15, 19);
 
-        ROUND2(A,B,C,D,  0,  3);  ROUND2(D,A,B,C,  4,  5);
+	ROUND2(A,B,C,D,  0,  3);  ROUND2(D,A,B,C,  4,  5);
 	ROUND2(C,D,A,B,  8,  9);  ROUND2(B,C,D,A, 12, 13);
-        ROUND2(A,B,C,D,  1,  3);  ROUND2(D,A,B,C,  5,  5);
+	ROUND2(A,B,C,D,  1,  3);  ROUND2(D,A,B,C,  5,  5);
 	ROUND2(C,D,A,B,  9,  9);  ROUND2(B,C,D,A, 13, 13);
-        ROUND2(A,B,C,D,  2,  3);  ROUND2(D,A,B,C,  6,  5);
+	ROUND2(A,B,C,D,  2,  3);  ROUND2(D,A,B,C,  6,  5);
 	ROUND2(C,D,A,B, 10,  9);  ROUND2(B,C,D,A, 14, 13);
-        ROUND2(A,B,C,D,  3,  3);  ROUND2(D,A,B,C,  7,  5);
+	ROUND2(A,B,C,D,  3,  3);  ROUND2(D,A,B,C,  7,  5);
 	ROUND2(C,D,A,B, 11,  9);  ROUND2(B,C,D,A, 15, 13);
 
 	ROUND3(A,B,C,D,  0,  3);  ROUND3(D,A,B,C,  8,  9);
 	ROUND3(C,D,A,B,  4, 11);  ROUND3(B,C,D,A, 12, 15);
-        ROUND3(A,B,C,D,  2,  3);  ROUND3(D,A,B,C, 10,  9);
+	ROUND3(A,B,C,D,  2,  3);  ROUND3(D,A,B,C, 10,  9);
 	ROUND3(C,D,A,B,  6, 11);  ROUND3(B,C,D,A, 14, 15);
-        ROUND3(A,B,C,D,  1,  3);  ROUND3(D,A,B,C,  9,  9);
+	ROUND3(A,B,C,D,  1,  3);  ROUND3(D,A,B,C,  9,  9);
 	ROUND3(C,D,A,B,  5, 11);  ROUND3(B,C,D,A, 13, 15);
-        ROUND3(A,B,C,D,  3,  3);  ROUND3(D,A,B,C, 11,  9);
+	ROUND3(A,B,C,D,  3,  3);  ROUND3(D,A,B,C, 11,  9);
 	ROUND3(C,D,A,B,  7, 11);  ROUND3(B,C,D,A, 15, 15);
 
-	A += AA; B += BB; C += CC; D += DD;
-
-	for (j=0;j<16;j++)
-		X[j] = 0;
-
-	m->A = A; m->B = B; m->C = C; m->D = D;
+	md->A += A; md->B += B; md->C += C; md->D += D;
 }
 
 static void copy64(uint32_t *M, const byte *in)
 {
+#ifdef Q3_LITTLE_ENDIAN
+	Com_Memcpy(M, in, 64);
+#else
 	int i;
 
 	for (i=0;i<16;i++)
@@ -111,6 +102,7 @@ static void copy64(uint32_t *M, const byte *in)
 			((uint32_t)in[i*4+2] << 16) |
 			((uint32_t)in[i*4+1] <<	 8) |
 			((uint32_t)in[i*4+0] <<	 0) ;
+#endif
 }
 
 static void copy4(byte *out,uint32_t x)
@@ -121,7 +113,7 @@ static void copy4(byte *out,uint32_t x)
 	out[3] = (x>>24)&0xFF;
 }
 
-void mdfour_begin(struct mdfour *md)
+static void mdfour_begin(struct mdfour *md)
 {
 	md->A = 0x67452301;
 	md->B = 0xefcdab89;
@@ -131,15 +123,15 @@ void mdfour_begin(struct mdfour *md)
 }
 
 
-static void mdfour_tail(const byte *in, int n)
+static void mdfour_tail(struct mdfour *md, const byte *in, int n)
 {
 	byte buf[128];
 	uint32_t M[16];
 	uint32_t b;
 
-	m->totalN += n;
+	md->totalN += n;
 
-	b = m->totalN * 8;
+	b = md->totalN * 8;
 
 	Com_Memset(buf, 0, 128);
 	if (n) Com_Memcpy(buf, in, n);
@@ -148,13 +140,13 @@ static void mdfour_tail(const byte *in, int n)
 	if (n <= 55) {
 		copy4(buf+56, b);
 		copy64(M, buf);
-		mdfour64(M);
+		mdfour64(md, M);
 	} else {
 		copy4(buf+120, b);
 		copy64(M, buf);
-		mdfour64(M);
+		mdfour64(md, M);
 		copy64(M, buf+64);
-		mdfour64(M);
+		mdfour64(md, M);
 	}
 }
 
@@ -162,19 +154,18 @@ static void mdfour_update(struct mdfour *md, const byte *in, int n)
 {
 	uint32_t M[16];
 
-	m = md;
-
-	if (n == 0) mdfour_tail(in, n);
+	// an empty block gets two tails, checksums of empty lumps depend on it
+	if (n == 0) mdfour_tail(md, in, n);
 
 	while (n >= 64) {
 		copy64(M, in);
-		mdfour64(M);
+		mdfour64(md, M);
 		in += 64;
 		n -= 64;
-		m->totalN += 64;
+		md->totalN += 64;
 	}
 
-	mdfour_tail(in, n);
+	mdfour_tail(md, in, n);
 }
 
 
@@ -352,6 +352,54 @@ char *Com_MD5Buf( const char *data, int length, const char *data2, int length2 )
 }
 
 
+/*
+=================
+Com_MD5HMAC
+
+HMAC-MD5 of data followed by data2, writes MD5_DIGEST_SIZE bytes to digest
+=================
+*/
+void Com_MD5HMAC( const byte *key, int keyLength, const void *data, int length, const void *data2, int length2, byte *digest )
+{
+	byte k[MD5_BLOCK_SIZE];
+	byte pad[MD5_BLOCK_SIZE];
+	byte inner[MD5_DIGEST_SIZE];
+	MD5_CTX md5;
+	int i;
+
+	Com_Memset( k, 0, sizeof( k ) );
+	if ( keyLength > MD5_BLOCK_SIZE ) {
+		MD5Init( &md5 );
+		MD5Update( &md5, key, keyLength );
+		MD5Final( &md5, k );
+	} else {
+		Com_Memcpy( k, key, keyLength );
+	}
+
+	// inner = MD5( (key ^ ipad) | data | data2 )
+	for ( i = 0; i < MD5_BLOCK_SIZE; i++ )
+		pad[i] = k[i] ^ 0x36;
+	MD5Init( &md5 );
+	MD5Update( &md5, pad, sizeof( pad ) );
+	if ( data && length > 0 )
+		MD5Update( &md5, (const unsigned char *)data, length );
+	if ( data2 && length2 > 0 )
+		MD5Update( &md5, (const unsigned char *)data2, length2 );
+	MD5Final( &md5, inner );
+
+	// digest = MD5( (key ^ opad) | inner )
+	for ( i = 0; i < MD5_BLOCK_SIZE; i++ )
+		pad[i] = k[i] ^ 0x5C;
+	MD5Init( &md5 );
+	MD5Update( &md5, pad, sizeof( pad ) );
+	MD5Update( &md5, inner, sizeof( inner ) );
+	MD5Final( &md5, digest );
+
+	Com_Memset( k, 0, sizeof( k ) );
+	Com_Memset( pad, 0, sizeof( pad ) );
+}
+
+
 // stateless challenges
 
 static struct MD5Context hmac_ctx_in;
@@ -471,36 +471,39 @@ typedef struct packetQueue_s {
         byte *data;
         netadr_t to;
         int release;
+        byte buf[MAX_PACKETLEN];	// data for regular sized packets
 } packetQueue_t;
 
-packetQueue_t *packetQueue = NULL;
+static packetQueue_t *packetQueue = NULL;
+static packetQueue_t *packetQueueTail = NULL;
+static mempool_t *packetPool = NULL;
 
 static void NET_QueuePacket( int length, const void *data, const netadr_t *to, int offset )
 {
-	packetQueue_t *new, *next = packetQueue;
+	packetQueue_t *new;
 
 	if(offset > 999)
 		offset = 999;
 
-	new = S_Malloc(sizeof(packetQueue_t));
-	new->data = S_Malloc(length);
+	if ( !packetPool )
+		packetPool = Pool_Create( "packet queue", sizeof( packetQueue_t ) );
+
+	new = Pool_Alloc( packetPool );
+	if ( length <= sizeof( new->buf ) )
+		new->data = new->buf;
+	else
+		new->data = S_Malloc(length);
 	Com_Memcpy(new->data, data, length);
 	new->length = length;
 	new->to = *to;
 	new->release = Sys_Milliseconds() + (int)((float)offset / com_timescale->value);	
 	new->next = NULL;
 
-	if(!packetQueue) {
+	if(!packetQueue)
 		packetQueue = new;
-		return;
-	}
-	while(next) {
-		if(!next->next) {
-			next->next = new;
-			return;
-		}
-		next = next->next;
-	}
+	else
+		packetQueueTail->next = new;
+	packetQueueTail = new;
 }
 
 
@@ -516,8 +519,9 @@ void NET_FlushPacketQueue( void )
 		Sys_SendPacket( packetQueue->length, packetQueue->data, &packetQueue->to );
 		last = packetQueue;
 		packetQueue = packetQueue->next;
-		Z_Free( last->data );
-		Z_Free( last );
+		if ( last->data != last->buf )
+			Z_Free( last->data );
+		Pool_Free( packetPool, last );
 	}
 }
 
@@ -217,6 +217,14 @@ typedef int		clipHandle_t;
 #define QALIGN(x)
 #endif
 
+#if defined(_MSC_VER)
+#define QTHREADLOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define QTHREADLOCAL __thread
+#else
+#define QTHREADLOCAL
+#endif
+
 #ifndef NULL
 #define NULL ((void *)0)
 #endif
@@ -389,11 +389,21 @@ typedef enum {
 typedef intptr_t (QDECL *vmMainFunc_t)( int command, int arg0, int arg1, int arg2 );
 
 typedef intptr_t (*syscall_t)( intptr_t *parms );
+
+// called directly from compiled code with args pointing to QVM stack,
+// args[0] is a syscall number, so VMA()/VMF() may be used as usual
+typedef intptr_t (*vmFastSyscall_t)( int32_t *args );
+
+typedef struct {
+	int				num;
+	vmFastSyscall_t	func;
+} vmFastSyscallDef_t;
 typedef intptr_t (QDECL *dllSyscall_t)( intptr_t callNum, ... );
 typedef void (QDECL *dllEntry_t)( dllSyscall_t syscallptr );
 
 void	VM_Init( void );
 vm_t	*VM_Create( vmIndex_t index, syscall_t systemCalls, dllSyscall_t dllSyscalls, vmInterpret_t interpret );
+void	VM_SetFastSyscalls( vmIndex_t index, const vmFastSyscallDef_t *defs, int count );
 
 void	VM_Free( vm_t *vm );
 void	VM_Clear(void);
@@ -404,6 +414,7 @@ vm_t	*VM_Restart( vm_t *vm );
 intptr_t	QDECL VM_Call( vm_t *vm, int nargs, int callNum, ... );
 
 void	VM_Debug( int level );
+void	VM_ProfileFrame( void );
 void	VM_CheckBounds( const vm_t *vm, unsigned int address, unsigned int length );
 void	VM_CheckBounds2( const vm_t *vm, unsigned int addr1, unsigned int addr2, unsigned int length );
 
@@ -686,6 +697,13 @@ typedef	_off_t  fileOffset_t;
 typedef	off_t  fileOffset_t;
 #endif
 
+// tells versions of a file apart, compare with memcmp()
+typedef struct {
+	uint64_t	size;
+	uint64_t	mtime;		// in the finest unit the platform keeps
+	uint64_t	index;		// inode or NTFS file index
+} fileId_t;
+
 qboolean FS_Initialized( void );
 
 void	FS_InitFilesystem ( void );
@@ -726,6 +744,8 @@ qboolean FS_SV_FileExists( const char *file );
 
 fileHandle_t FS_SV_FOpenFileWrite( const char *filename );
 int		FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp );
+const char *FS_SV_FileOSPath( const char *filename );
+void	*FS_SV_MapFile( const char *filename, size_t *size );
 void	FS_SV_Rename( const char *from, const char *to );
 int		FS_FOpenFileRead( const char *qpath, fileHandle_t *file, qboolean uniqueFILE );
 // if uniqueFILE is true, then a new FILE will be fopened even if the file
@@ -744,6 +764,9 @@ int FS_Home_FOpenFileRead( const char *filename, fileHandle_t *file );
 qboolean FS_FileIsInPAK( const char *filename, int *pChecksum, char *pakName );
 // returns qtrue if a file is in the PAK file, otherwise qfalse
 
+qboolean FS_FileIdentity( const char *qpath, int *pakChecksum, int *length );
+// returns qtrue and checksum of containing pak if file comes from pak
+
 int		FS_PakIndexForHandle( fileHandle_t f );
 
 // returns pak index or -1 if file is not in pak
@@ -773,6 +796,20 @@ void	FS_ForceFlush( fileHandle_t f );
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+typedef void (*fsAsyncCallback_t)( const char *qpath, void *buffer, int len, void *arg );
+
+int		FS_ReadFilesAsync( const char **qpaths, int numFiles, fsAsyncCallback_t callback, void *arg );
+// reads the files on background threads and returns a request handle, 0 if nothing was queued.
+// Without a callback the files are only prefetched for later FS_ReadFile calls.
+// With a callback it is called on the main thread for every file from FS_AsyncFinish,
+// buffer is only valid during the call and is NULL with len -1 if the file could not be read.
+
+qboolean FS_AsyncComplete( int handle );
+// returns qtrue once all files of the request have been read
+
+void	FS_AsyncFinish( int handle );
+// waits for the request, delivers callbacks and releases files that were not used
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -950,6 +987,7 @@ unsigned	Com_BlockChecksum( const void *buffer, int length );
 
 char		*Com_MD5File(const char *filename, int length, const char *prefix, int prefix_len);
 char		*Com_MD5Buf( const char *data, int length, const char *data2, int length2 );
+void		Com_MD5HMAC( const byte *key, int keyLength, const void *data, int length, const void *data2, int length2, byte *digest );
 
 // stateless challenge functions
 void		Com_MD5Init( void );
@@ -1053,6 +1091,7 @@ typedef enum {
 	TAG_CLIENTS,
 	TAG_SMALL,
 	TAG_STATIC,
+	TAG_FILE_CACHE,
 	TAG_COUNT
 } memtag_t;
 
@@ -1096,6 +1135,12 @@ int Z_FreeTags( memtag_t tag );
 int Z_AvailableMemory( void );
 void Z_LogHeap( void );
 
+// fixed-size object pools with per-thread caches, objects are never returned to the system
+typedef struct mempool_s mempool_t;
+mempool_t *Pool_Create( const char *name, int objectSize );
+void *Pool_Alloc( mempool_t *pool );	// NOT 0 filled memory
+void Pool_Free( mempool_t *pool, void *obj );
+
 void Hunk_Clear( void );
 void Hunk_ClearToMark( void );
 void Hunk_SetMark( void );
@@ -1106,6 +1151,12 @@ void Hunk_FreeTempMemory( void *buf );
 int	Hunk_MemoryRemaining( void );
 void Hunk_Log( void);
 
+// map data cache, keeps loaded map data resident across map changes
+void *Com_MapCacheFind( const char *qpath, const char *type, int *size );
+qboolean Com_MapCacheBegin( const char *qpath, const char *type );
+void *Com_MapCacheAlloc( int size );
+void Com_MapCacheEnd( qboolean success );
+
 void Com_TouchMemory( void );
 
 // commandLine should not include the executable name (argv[0])
@@ -1265,11 +1316,40 @@ void	QDECL Sys_SetStatus( const char *format, ...) __attribute__ ((format (print
 void	Sys_SetAffinityMask( int mask );
 #endif
 
+// zero filled and page aligned, hugePages: 0 - off, 1 - transparent, 2 - explicit
+void	*Sys_AllocPages( size_t size, int hugePages );
+
+// private copy-on-write file mapping: pages are writable, e.g. for in-place
+// byte swapping, but writes never reach the file
+void	*Sys_MapFile( const char *ospath, size_t *size );
+void	Sys_UnmapFile( void *ptr, size_t size );
+
+#define MAX_SYS_THREADS 32
+
+// func must not touch the zone, hunk, cvars or console
+void	Sys_RunThreads( void (*func)( void *arg ), void *arg, int numThreads );
+void	*Sys_StartThread( void (*func)( void *arg ), void *arg );
+void	Sys_JoinThread( void *thread );
+
+// auto-reset event, the signal is kept until a waiter consumes it
+void	*Sys_CreateEvent( void );
+void	Sys_DestroyEvent( void *event );
+void	Sys_SignalEvent( void *event );
+void	Sys_WaitEvent( void *event );
+int		Sys_CPUCount( void );
+
 // Sys_Milliseconds should only be used for profiling purposes,
 // any game related timing information should come from event timestamps
 int		Sys_Milliseconds( void );
 int64_t	Sys_Microseconds( void );
 
+// sampling timer, func is called from signal context with interrupted
+// program counter and register which holds QVM programStack in x86
+// compiled code, -1 if that can't be obtained
+typedef void (*sysSampleFunc_t)( const void *pc, intptr_t pstack );
+qboolean Sys_StartSampler( int hz, sysSampleFunc_t func );
+void	Sys_StopSampler( void );
+
 void	Sys_SnapVector( float *vector );
 
 qboolean Sys_RandomBytes( byte *string, int len );
@@ -1288,7 +1368,7 @@ qboolean	Sys_StringToAdr( const char *s, netadr_t *a, netadrtype_t family );
 qboolean	Sys_IsLANAddress(const netadr_t *adr);
 void		Sys_ShowIP(void);
 
-void	Sys_Mkdir( const char *path );
+qboolean Sys_Mkdir( const char *path );
 FILE	*Sys_FOpen( const char *ospath, const char *mode );
 qboolean Sys_ResetReadOnlyAttribute( const char *ospath );
 
@@ -1301,6 +1381,7 @@ char **Sys_ListFiles( const char *directory, const char *extension, const char *
 void Sys_FreeFileList( char **list );
 
 qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t *mtime, fileTime_t *ctime );
+qboolean Sys_GetFileId( const char *filename, fileId_t *id );
 
 void Sys_BeginProfiling( void );
 void Sys_EndProfiling( void );
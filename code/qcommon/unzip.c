@@ -1060,6 +1060,11 @@ static void   zcfree  OF((voidp opaque, voidp ptr));
 #define UNZ_BUFSIZE (65536)
 #endif
 
+/* deflated entries up to this size are inflated in one pass when read whole */
+#ifndef UNZ_FASTREAD_MAXSIZE
+#define UNZ_FASTREAD_MAXSIZE (4*1024*1024)
+#endif
+
 #ifndef UNZ_MAXFILENAMEINZIP
 #define UNZ_MAXFILENAMEINZIP (256)
 #endif
@@ -1995,6 +2000,49 @@ extern int unzOpenCurrentFile (unzFile file)
 }
 
 
+static int unzlocal_FastInflate OF((Byte *dest, uLong destLen, const Byte *source, uLong sourceLen));
+
+/*
+  Read and inflate the whole current file in one pass.
+  return the number of bytes produced, UNZ_ERRNO on IO error
+  or another negative value if the stream must be decoded the usual way
+*/
+static int unzlocal_ReadWholeFile (unz_s* s, file_in_zip_read_info_s* pfile_in_zip_read_info, Byte* buf)
+{
+	uLong compressed = pfile_in_zip_read_info->rest_read_compressed;
+	uLong uncompressed = pfile_in_zip_read_info->rest_read_uncompressed;
+	Byte* source;
+	int err;
+
+	/* up to UNZ_FASTREAD_MAXSIZE, too much to take from the zone */
+	source = (Byte*)malloc(compressed ? compressed : 1);
+	if (source==NULL)
+		return UNZ_INTERNALERROR; /* stream it instead */
+
+	if (fseek(pfile_in_zip_read_info->file,
+			  pfile_in_zip_read_info->pos_in_zipfile +
+				pfile_in_zip_read_info->byte_before_the_zipfile,SEEK_SET)!=0 ||
+		(compressed && fread(source,compressed,1,pfile_in_zip_read_info->file)!=1))
+	{
+		free(source);
+		return UNZ_ERRNO;
+	}
+
+	err = unzlocal_FastInflate(buf, uncompressed, source, compressed);
+	free(source);
+	if (err != Z_OK)
+		return UNZ_BADZIPFILE;
+
+	pfile_in_zip_read_info->pos_in_zipfile += compressed;
+	pfile_in_zip_read_info->rest_read_compressed = 0;
+	pfile_in_zip_read_info->rest_read_uncompressed = 0;
+	pfile_in_zip_read_info->stream.total_out = uncompressed;
+	pfile_in_zip_read_info->stream.avail_in = 0;
+
+	return (int)uncompressed;
+}
+
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -2033,6 +2081,21 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 		pfile_in_zip_read_info->stream.avail_out = 
 		  (uInt)pfile_in_zip_read_info->rest_read_uncompressed;
 
+	if (pfile_in_zip_read_info->compression_method!=0 &&
+		pfile_in_zip_read_info->stream.total_out == 0 &&
+		pfile_in_zip_read_info->rest_read_uncompressed > 0 &&
+		len >= pfile_in_zip_read_info->rest_read_uncompressed &&
+		s->cur_file_info.compressed_size == pfile_in_zip_read_info->rest_read_compressed &&
+		s->cur_file_info.compressed_size <= UNZ_FASTREAD_MAXSIZE)
+	{
+		err = unzlocal_ReadWholeFile(s, pfile_in_zip_read_info, (Byte*)buf);
+		if (err > 0)
+			return err;
+		if (err == UNZ_ERRNO)
+			return err;
+		err = UNZ_OK; /* leave it to the streaming inflate */
+	}
+
 	while (pfile_in_zip_read_info->stream.avail_out>0)
 	{
 		if ((pfile_in_zip_read_info->stream.avail_in==0) &&
@@ -2293,6 +2356,55 @@ extern int unzGetGlobalComment (unzFile file, char *szComment, uLong uSizeBuf)
 	return (int)uReadThis;
 }
 
+
+/* the zone is not thread safe, unzInflateMemory may run on worker threads */
+static voidp unzlocal_Calloc (voidp opaque, uInt items, uInt size)
+{
+	return calloc(items, size);
+}
+
+static void unzlocal_Free (voidp opaque, voidp ptr)
+{
+	free(ptr);
+}
+
+/*
+  Inflate a complete raw deflate stream from memory.
+  return UNZ_OK if exactly destLen bytes were produced
+  Safe to call from any thread.
+*/
+extern int unzInflateMemory (unsigned char *dest, uLong destLen, const unsigned char *source, uLong sourceLen)
+{
+	z_stream stream;
+	int err;
+
+	if (unzlocal_FastInflate(dest, destLen, source, sourceLen) == Z_OK)
+		return UNZ_OK;
+
+	memset(&stream, 0, sizeof(stream));
+	stream.next_in = (Byte*)source;
+	stream.avail_in = (uInt)sourceLen;
+	stream.next_out = (Byte*)dest;
+	stream.avail_out = (uInt)destLen;
+	stream.zalloc = (void *(*)(void *, unsigned, unsigned))unzlocal_Calloc;
+	stream.zfree = (void (*)(void *, void *))unzlocal_Free;
+
+	err = inflateInit2(&stream, -MAX_WBITS);
+	if (err != Z_OK)
+		return UNZ_INTERNALERROR;
+
+	err = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+
+	/* output may be complete before the end of stream marker is seen */
+	if (stream.total_out != destLen)
+		return UNZ_BADZIPFILE;
+	if (err != Z_STREAM_END && err != Z_OK && err != Z_BUF_ERROR)
+		return UNZ_BADZIPFILE;
+
+	return UNZ_OK;
+}
+
 /* infblock.h -- header to use infblock.c
  * Copyright (C) 1995-1998 Mark Adler
  * For conditions of distribution and use, see copyright notice in zlib.h 
@@ -3905,6 +4017,551 @@ void inflate_codes_free(inflate_codes_statef *c, z_streamp z)
   Tracev(("inflate:       codes free\n"));
 }
 
+/* fast one-shot inflate
+ *
+ * Decodes a complete raw deflate stream straight into the destination
+ * buffer. Since the whole output is addressable there is no sliding
+ * window to flush, so matches are copied from the output itself. The
+ * bit buffer is 64 bits wide and refilled eight bytes at a time, which
+ * guarantees enough bits for a full length/distance pair per refill.
+ * Literal/length codes are resolved with an 11-bit primary table and
+ * distances with an 8-bit one, longer codes go through subtables.
+ */
+
+#define FI_LITLEN_BITS	11
+#define FI_DIST_BITS	8
+#define FI_CODELEN_BITS	7
+
+/* worst-case table sizes including subtables for 288/32 symbols and 15-bit codes */
+#define FI_LITLEN_ENOUGH	2342
+#define FI_DIST_ENOUGH		402
+
+/* table entry layout: bits to drop | type | extra bits | value */
+#define FI_LITERAL	0x00
+#define FI_LENGTH	0x20
+#define FI_END		0x40
+#define FI_SUBTABLE	0x60
+#define FI_INVALID	0x80
+
+#define FI_ENTRY(type,extra,value)	((type) | ((extra) << 8) | ((uInt)(value) << 16))
+#define FI_DROPBITS(e)	((e) & 0x1F)
+#define FI_TYPE(e)		((e) & 0xE0)
+#define FI_EXTRA(e)		(((e) >> 8) & 0xFF)
+#define FI_VALUE(e)		((e) >> 16)
+
+/* slack left past the output end for unaligned 8-byte stores */
+#define FI_COPY_SLACK	8
+
+typedef struct {
+	const Byte	*in;
+	const Byte	*inEnd;
+	uint64_t	bitbuf;
+	uInt		bitcount;
+	uInt		overrun;		/* zero bytes fed past the end of input */
+
+	Byte		*outStart;
+	Byte		*out;
+	Byte		*outEnd;
+
+	uInt		litlen[FI_LITLEN_ENOUGH];
+	uInt		dist[FI_DIST_ENOUGH];
+	uInt		codelen[1 << FI_CODELEN_BITS];
+} fastInflate_t;
+
+
+/*
+  Top up the bit buffer to at least 56 bits. With eight or more input
+  bytes left a single unaligned load is used; bits above bitcount are
+  then already the next stream bits, so OR-ing them in again later is
+  harmless.
+*/
+static void unzlocal_FastRefill( fastInflate_t *fi )
+{
+	if ( fi->inEnd - fi->in >= 8 )
+	{
+		uint64_t word;
+#ifdef Q3_LITTLE_ENDIAN
+		memcpy( &word, fi->in, 8 );
+#else
+		const Byte *p = fi->in;
+		word = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+			((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+#endif
+		fi->bitbuf |= word << fi->bitcount;
+		fi->in += (63 - fi->bitcount) >> 3;
+		fi->bitcount |= 56;
+		return;
+	}
+
+	while ( fi->bitcount < 56 )
+	{
+		if ( fi->in < fi->inEnd )
+			fi->bitbuf |= (uint64_t)*fi->in++ << fi->bitcount;
+		else
+			fi->overrun++;
+		fi->bitcount += 8;
+	}
+}
+
+
+static uInt unzlocal_FastBits( fastInflate_t *fi, uInt n )
+{
+	uInt v = (uInt)fi->bitbuf & ((1U << n) - 1);
+	fi->bitbuf >>= n;
+	fi->bitcount -= n;
+	return v;
+}
+
+
+/*
+  Return true if more bits were consumed than the input provided.
+*/
+static int unzlocal_FastOverrun( const fastInflate_t *fi )
+{
+	return fi->overrun * 8 > fi->bitcount;
+}
+
+
+/*
+  Build a primary lookup table with subtables for codes longer than
+  tableBits. Incomplete codes are accepted, unused slots decode as
+  invalid. Returns Z_OK or Z_DATA_ERROR.
+*/
+static int unzlocal_FastBuildTable( uInt *table, uInt tableBits, uInt tableSize,
+	const Byte *lens, uInt numSyms, const uInt *entries )
+{
+	uInt count[16], nextCode[16], code[16];
+	Byte prefixLen[1 << FI_LITLEN_BITS];
+	uInt primary, used, left;
+	uInt sym, len, rev, i, j;
+
+	memset( count, 0, sizeof( count ) );
+	for ( sym = 0; sym < numSyms; sym++ )
+		count[lens[sym]]++;
+	count[0] = 0;
+
+	left = 1;
+	for ( len = 1; len < 16; len++ )
+	{
+		left <<= 1;
+		if ( count[len] > left )
+			return Z_DATA_ERROR;	/* over-subscribed */
+		left -= count[len];
+	}
+
+	nextCode[1] = 0;
+	for ( len = 1; len < 15; len++ )
+		nextCode[len + 1] = ( nextCode[len] + count[len] ) << 1;
+
+	primary = 1U << tableBits;
+	for ( i = 0; i < primary; i++ )
+		table[i] = FI_INVALID;
+
+	/* size a subtable for every primary slot shared by longer codes */
+	memset( prefixLen, 0, primary );
+	memcpy( code, nextCode, sizeof( code ) );
+	for ( sym = 0; sym < numSyms; sym++ )
+	{
+		len = lens[sym];
+		if ( len <= tableBits )
+		{
+			if ( len )
+				code[len]++;
+			continue;
+		}
+		for ( rev = 0, j = code[len]++, i = 0; i < len; i++, j >>= 1 )
+			rev = ( rev << 1 ) | ( j & 1 );
+		i = rev & ( primary - 1 );
+		if ( prefixLen[i] < len )
+			prefixLen[i] = (Byte)len;
+	}
+
+	used = primary;
+	for ( i = 0; i < primary; i++ )
+	{
+		if ( prefixLen[i] == 0 )
+			continue;
+		len = prefixLen[i] - tableBits;
+		if ( used + ( 1U << len ) > tableSize )
+			return Z_DATA_ERROR;
+		table[i] = FI_ENTRY( FI_SUBTABLE, len, used ) | tableBits;
+		for ( j = 0; j < ( 1U << len ); j++ )
+			table[used + j] = FI_INVALID;
+		used += 1U << len;
+	}
+
+	/* fill in replicated entries for every symbol */
+	memcpy( code, nextCode, sizeof( code ) );
+	for ( sym = 0; sym < numSyms; sym++ )
+	{
+		len = lens[sym];
+		if ( len == 0 )
+			continue;
+		for ( rev = 0, j = code[len]++, i = 0; i < len; i++, j >>= 1 )
+			rev = ( rev << 1 ) | ( j & 1 );
+		if ( len <= tableBits )
+		{
+			for ( i = rev; i < primary; i += 1U << len )
+				table[i] = entries[sym] | len;
+		}
+		else
+		{
+			uInt sub = table[rev & ( primary - 1 )];
+			uInt *t = table + FI_VALUE( sub );
+			for ( i = rev >> tableBits; i < ( 1U << FI_EXTRA( sub ) ); i += 1U << ( len - tableBits ) )
+				t[i] = entries[sym] | ( len - tableBits );
+		}
+	}
+
+	return Z_OK;
+}
+
+
+static uInt unzlocal_FastDecode( fastInflate_t *fi, const uInt *table, uInt tableBits )
+{
+	uInt e = table[fi->bitbuf & ( ( 1U << tableBits ) - 1 )];
+
+	if ( FI_TYPE( e ) == FI_SUBTABLE )
+	{
+		fi->bitbuf >>= tableBits;
+		fi->bitcount -= tableBits;
+		e = table[FI_VALUE( e ) + ( fi->bitbuf & ( ( 1U << FI_EXTRA( e ) ) - 1 ) )];
+	}
+
+	fi->bitbuf >>= FI_DROPBITS( e );
+	fi->bitcount -= FI_DROPBITS( e );
+	return e;
+}
+
+
+static int unzlocal_FastBuildCodes( fastInflate_t *fi, const Byte *lens, uInt nlen, uInt ndist )
+{
+	uInt entries[288];
+	uInt i;
+
+	for ( i = 0; i < 256; i++ )
+		entries[i] = FI_ENTRY( FI_LITERAL, 0, i );
+	entries[256] = FI_ENTRY( FI_END, 0, 0 );
+	for ( i = 257; i < 286; i++ )
+		entries[i] = FI_ENTRY( FI_LENGTH, cplext[i - 257], cplens[i - 257] );
+	entries[286] = entries[287] = FI_INVALID;
+
+	if ( unzlocal_FastBuildTable( fi->litlen, FI_LITLEN_BITS, FI_LITLEN_ENOUGH, lens, nlen, entries ) != Z_OK )
+		return Z_DATA_ERROR;
+
+	for ( i = 0; i < 30; i++ )
+		entries[i] = FI_ENTRY( FI_LENGTH, cpdext[i], cpdist[i] );
+	entries[30] = entries[31] = FI_INVALID;
+
+	return unzlocal_FastBuildTable( fi->dist, FI_DIST_BITS, FI_DIST_ENOUGH, lens + nlen, ndist, entries );
+}
+
+
+static int unzlocal_FastFixedCodes( fastInflate_t *fi )
+{
+	Byte lens[288 + 32];
+	uInt i;
+
+	for ( i = 0; i < 144; i++ ) lens[i] = 8;
+	for ( ; i < 256; i++ ) lens[i] = 9;
+	for ( ; i < 280; i++ ) lens[i] = 7;
+	for ( ; i < 288; i++ ) lens[i] = 8;
+	for ( ; i < 288 + 32; i++ ) lens[i] = 5;
+
+	return unzlocal_FastBuildCodes( fi, lens, 288, 32 );
+}
+
+
+static int unzlocal_FastDynamicCodes( fastInflate_t *fi )
+{
+	Byte lens[288 + 32];
+	uInt entries[19];
+	uInt nlen, ndist, ncode;
+	uInt i, n, e, rep;
+
+	unzlocal_FastRefill( fi );
+	nlen = unzlocal_FastBits( fi, 5 ) + 257;
+	ndist = unzlocal_FastBits( fi, 5 ) + 1;
+	ncode = unzlocal_FastBits( fi, 4 ) + 4;
+	if ( nlen > 286 || ndist > 30 )
+		return Z_DATA_ERROR;
+
+	memset( lens, 0, 19 );
+	for ( i = 0; i < ncode; i++ )
+	{
+		unzlocal_FastRefill( fi );
+		lens[border[i]] = (Byte)unzlocal_FastBits( fi, 3 );
+	}
+
+	for ( i = 0; i < 19; i++ )
+		entries[i] = FI_ENTRY( FI_LITERAL, 0, i );
+	if ( unzlocal_FastBuildTable( fi->codelen, FI_CODELEN_BITS, 1 << FI_CODELEN_BITS, lens, 19, entries ) != Z_OK )
+		return Z_DATA_ERROR;
+
+	n = 0;
+	while ( n < nlen + ndist )
+	{
+		unzlocal_FastRefill( fi );
+		e = unzlocal_FastDecode( fi, fi->codelen, FI_CODELEN_BITS );
+		if ( FI_TYPE( e ) != FI_LITERAL )
+			return Z_DATA_ERROR;
+		e = FI_VALUE( e );
+		if ( e < 16 )
+		{
+			lens[n++] = (Byte)e;
+			continue;
+		}
+		if ( e == 16 )
+		{
+			if ( n == 0 )
+				return Z_DATA_ERROR;
+			rep = 3 + unzlocal_FastBits( fi, 2 );
+			e = lens[n - 1];
+		}
+		else if ( e == 17 )
+		{
+			rep = 3 + unzlocal_FastBits( fi, 3 );
+			e = 0;
+		}
+		else
+		{
+			rep = 11 + unzlocal_FastBits( fi, 7 );
+			e = 0;
+		}
+		if ( n + rep > nlen + ndist )
+			return Z_DATA_ERROR;
+		while ( rep-- )
+			lens[n++] = (Byte)e;
+	}
+
+	/* end of block code must be present */
+	if ( lens[256] == 0 )
+		return Z_DATA_ERROR;
+
+	return unzlocal_FastBuildCodes( fi, lens, nlen, ndist );
+}
+
+
+static int unzlocal_FastStored( fastInflate_t *fi )
+{
+	uInt len, nlen, avail;
+
+	unzlocal_FastBits( fi, fi->bitcount & 7 );
+	unzlocal_FastRefill( fi );
+	len = unzlocal_FastBits( fi, 16 );
+	nlen = unzlocal_FastBits( fi, 16 );
+	if ( len != ( ~nlen & 0xFFFF ) || unzlocal_FastOverrun( fi ) )
+		return Z_DATA_ERROR;
+
+	/* hand buffered whole bytes back to the input */
+	avail = fi->bitcount >> 3;
+	if ( avail > fi->overrun )
+		fi->in -= avail - fi->overrun;
+	fi->overrun = 0;
+	fi->bitbuf = 0;
+	fi->bitcount = 0;
+
+	if ( (uLong)( fi->inEnd - fi->in ) < len || (uLong)( fi->outEnd - fi->out ) < len )
+		return Z_DATA_ERROR;
+
+	memcpy( fi->out, fi->in, len );
+	fi->out += len;
+	fi->in += len;
+	return Z_OK;
+}
+
+
+/*
+  Decode literal/length and distance codes until the end of block code.
+  The bit buffer state is kept in locals since output stores could
+  otherwise alias it.
+*/
+static int unzlocal_FastCodes( fastInflate_t *fi )
+{
+	const uInt *litlen = fi->litlen;
+	const uInt *dist = fi->dist;
+	const Byte *in = fi->in;
+	const Byte *inFast = fi->inEnd - 8;
+	uint64_t bitbuf = fi->bitbuf;
+	uInt bitcount = fi->bitcount;
+	Byte *out = fi->out;
+	Byte *outEnd = fi->outEnd;
+	Byte *outFast = outEnd - 258 - FI_COPY_SLACK;
+	uInt e, len, d;
+	const Byte *from;
+	int err = Z_DATA_ERROR;
+
+#define FI_DROP(n) { bitbuf >>= (n); bitcount -= (n); }
+#define FI_DECODE(table,bits) { \
+	e = table[bitbuf & ( ( 1U << (bits) ) - 1 )]; \
+	if ( FI_TYPE( e ) == FI_SUBTABLE ) { \
+		FI_DROP( bits ) \
+		e = table[FI_VALUE( e ) + ( bitbuf & ( ( 1U << FI_EXTRA( e ) ) - 1 ) )]; \
+	} \
+	FI_DROP( FI_DROPBITS( e ) ) }
+
+	for ( ;; )
+	{
+		if ( in <= inFast )
+		{
+			uint64_t word;
+#ifdef Q3_LITTLE_ENDIAN
+			memcpy( &word, in, 8 );
+#else
+			word = (uint64_t)in[0] | ((uint64_t)in[1] << 8) | ((uint64_t)in[2] << 16) | ((uint64_t)in[3] << 24) |
+				((uint64_t)in[4] << 32) | ((uint64_t)in[5] << 40) | ((uint64_t)in[6] << 48) | ((uint64_t)in[7] << 56);
+#endif
+			bitbuf |= word << bitcount;
+			in += ( 63 - bitcount ) >> 3;
+			bitcount |= 56;
+		}
+		else
+		{
+			fi->in = in;
+			fi->bitbuf = bitbuf;
+			fi->bitcount = bitcount;
+			unzlocal_FastRefill( fi );
+			in = fi->in;
+			bitbuf = fi->bitbuf;
+			bitcount = fi->bitcount;
+		}
+
+		FI_DECODE( litlen, FI_LITLEN_BITS )
+		if ( FI_TYPE( e ) == FI_LITERAL )
+		{
+			if ( out >= outEnd )
+				break;
+			*out++ = (Byte)FI_VALUE( e );
+			/* a second literal fits in the remaining bits */
+			if ( out < outFast )
+			{
+				FI_DECODE( litlen, FI_LITLEN_BITS )
+				if ( FI_TYPE( e ) == FI_LITERAL )
+				{
+					*out++ = (Byte)FI_VALUE( e );
+					continue;
+				}
+			}
+			else
+				continue;
+		}
+		if ( FI_TYPE( e ) != FI_LENGTH )
+		{
+			if ( FI_TYPE( e ) == FI_END )
+				err = Z_OK;
+			break;
+		}
+
+		len = FI_VALUE( e ) + ( (uInt)bitbuf & ( ( 1U << FI_EXTRA( e ) ) - 1 ) );
+		FI_DROP( FI_EXTRA( e ) )
+
+		if ( bitcount < 28 )
+		{
+			/* only reachable after two literals, top up slowly */
+			fi->in = in;
+			fi->bitbuf = bitbuf;
+			fi->bitcount = bitcount;
+			unzlocal_FastRefill( fi );
+			in = fi->in;
+			bitbuf = fi->bitbuf;
+			bitcount = fi->bitcount;
+		}
+
+		FI_DECODE( dist, FI_DIST_BITS )
+		if ( FI_TYPE( e ) != FI_LENGTH )
+			break;
+		d = FI_VALUE( e ) + ( (uInt)bitbuf & ( ( 1U << FI_EXTRA( e ) ) - 1 ) );
+		FI_DROP( FI_EXTRA( e ) )
+
+		if ( d > (uInt)( out - fi->outStart ) || len > (uInt)( outEnd - out ) )
+			break;
+
+		from = out - d;
+		if ( out < outFast && d >= 8 )
+		{
+			/* may overshoot by up to 7 bytes, rewritten by the next symbols */
+			Byte *end = out + len;
+			do {
+				memcpy( out, from, 8 );
+				out += 8;
+				from += 8;
+			} while ( out < end );
+			out = end;
+		}
+		else if ( d == 1 )
+		{
+			memset( out, *from, len );
+			out += len;
+		}
+		else
+		{
+			do {
+				*out++ = *from++;
+			} while ( --len );
+		}
+	}
+
+#undef FI_DECODE
+#undef FI_DROP
+
+	fi->in = in;
+	fi->bitbuf = bitbuf;
+	fi->bitcount = bitcount;
+	fi->out = out;
+	return err;
+}
+
+
+/*
+  Inflate a raw deflate stream that is fully present in memory into
+  a buffer of exactly destLen bytes. Returns Z_OK on success, any
+  other value means the caller should fall back to the regular
+  streaming inflate.
+*/
+static int unzlocal_FastInflate( Byte *dest, uLong destLen, const Byte *source, uLong sourceLen )
+{
+	fastInflate_t state;
+	fastInflate_t *fi = &state;
+	uInt last, type;
+	int err;
+
+	fi->in = source;
+	fi->inEnd = source + sourceLen;
+	fi->bitbuf = 0;
+	fi->bitcount = 0;
+	fi->overrun = 0;
+	fi->outStart = fi->out = dest;
+	fi->outEnd = dest + destLen;
+
+	do {
+		unzlocal_FastRefill( fi );
+		last = unzlocal_FastBits( fi, 1 );
+		type = unzlocal_FastBits( fi, 2 );
+
+		if ( type == 0 )
+			err = unzlocal_FastStored( fi );
+		else if ( type == 1 )
+			err = unzlocal_FastFixedCodes( fi );
+		else if ( type == 2 )
+			err = unzlocal_FastDynamicCodes( fi );
+		else
+			err = Z_DATA_ERROR;
+
+		if ( err == Z_OK && type != 0 )
+			err = unzlocal_FastCodes( fi );
+
+		if ( err == Z_OK && unzlocal_FastOverrun( fi ) )
+			err = Z_DATA_ERROR;
+
+	} while ( err == Z_OK && !last && fi->out < fi->outEnd );
+
+	if ( err == Z_OK && fi->out != fi->outEnd )
+		err = Z_DATA_ERROR;
+
+	return err;
+}
+
+
 /* adler32.c -- compute the Adler-32 checksum of a data stream
  * Copyright (C) 1995-1998 Mark Adler
  * For conditions of distribution and use, see copyright notice in zlib.h 
@@ -334,3 +334,14 @@ extern int unzGetLocalExtrafield (unzFile file, void* buf, unsigned len);
   the return value is the number of unsigned chars copied in buf, or (if <0) 
 	the error code
 */
+
+extern int unzInflateMemory (unsigned char *dest, unsigned long destLen, const unsigned char *source, unsigned long sourceLen);
+
+/*
+  Inflate a complete raw deflate stream (as stored in a zip entry) from
+    memory into dest, without going through an opened file.
+  destLen must be the exact uncompressed size.
+  sourceLen may include one extra byte past the compressed data, the old
+    inflate needs it to report the end of a stream without zlib header.
+  return UNZ_OK if all destLen bytes were produced
+*/
@@ -204,6 +204,9 @@ const char *opname[ 256 ] = {
 };
 
 cvar_t	*vm_rtChecks;
+cvar_t	*vm_jitCache;
+cvar_t	*vm_inline;
+cvar_t	*vm_profileCallSites;
 
 #ifdef DEBUG
 int		vm_debugLevel;
@@ -220,6 +223,9 @@ static const char *vmName[ VM_COUNT ] = {
 	"ui"
 };
 
+static const vmFastSyscallDef_t *fastSyscallDefs[ VM_COUNT ];
+static int numFastSyscallDefs[ VM_COUNT ];
+
 static void VM_VmInfo_f( void );
 static void VM_VmProfile_f( void );
 
@@ -275,8 +281,21 @@ void VM_Init( void ) {
 #endif
 	Cvar_Get( "vm_game", "2", CVAR_ARCHIVE | CVAR_PROTECTED );	// !@# SHIP WITH SET TO 2
 
+	vm_jitCache = Cvar_Get( "vm_jitCache", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( vm_jitCache, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( vm_jitCache, "Store compiled QVM code in homepath and reuse it while the QVM and engine build stay the same." );
+
+	vm_inline = Cvar_Get( "vm_inline", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	Cvar_CheckRange( vm_inline, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( vm_inline, "Replace calls to tiny leaf functions in QVM code with their bodies at load time." );
+
+	vm_profileCallSites = Cvar_Get( "vm_profileCallSites", "0", 0 );
+	Cvar_CheckRange( vm_profileCallSites, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( vm_profileCallSites, "Make compiled QVM code record call sites so vmprof can report full call chains, takes effect on next module load." );
+
 	Cmd_AddCommand( "vmprofile", VM_VmProfile_f );
 	Cmd_AddCommand( "vminfo", VM_VmInfo_f );
+	Cmd_AddCommand( "vmprof", VM_Prof_f );
 
 	Com_Memset( vmTable, 0, sizeof( vmTable ) );
 }
@@ -1562,6 +1581,243 @@ __noJTS:
 }
 
 
+/*
+=================
+VM_ApplyDataFixes
+
+Fixups which do not touch instructions, must be applied
+even when compiled code is restored from the jit cache
+=================
+*/
+void VM_ApplyDataFixes( vm_t *vm ) {
+
+	if ( vm->index == VM_GAME ) {
+		if ( vm->crc32sum == 0x5AAE0ACC && vm->instructionCount == 251521 && vm->exactDataLength == 1872720 ) {
+			vm->forceDataMask = qtrue; // OSP server doing some bad things with memory
+		} else {
+			vm->forceDataMask = qfalse;
+		}
+	}
+
+	if ( vm->index == VM_UI ) {
+		// fix OSP demo UI
+		if ( vm->crc32sum == 0xCA84F31D && vm->instructionCount == 78585 && vm->exactDataLength == 542180 ) {
+			if ( memcmp( vm->dataBase + 0x3D2E, "dm_67", 5 ) == 0 ) {
+				memcpy( vm->dataBase + 0x3D2E, "dm_??", 5 );
+			}
+			if ( memcmp( vm->dataBase + 0x3D50, "\"%s.%s\"\n", 8 ) == 0 ) {
+				memcpy( vm->dataBase + 0x3D50, "\"%s\"\n", 6 );
+			}
+		}
+	}
+}
+
+
+#define MAX_INLINE_OPS 3
+
+typedef struct {
+	int		numArgs;
+	int		count;
+	instruction_t ops[ MAX_INLINE_OPS ];
+} inlineBody_t;
+
+
+/*
+=================
+VM_InlineOp
+
+Stack-only instructions without side effects or traps
+=================
+*/
+static qboolean VM_InlineOp( int op ) {
+	switch ( op ) {
+		case OP_CONST:
+		case OP_LOAD1:
+		case OP_LOAD2:
+		case OP_LOAD4:
+		case OP_SEX8:
+		case OP_SEX16:
+		case OP_NEGI:
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MULI:
+		case OP_MULU:
+		case OP_BAND:
+		case OP_BOR:
+		case OP_BXOR:
+		case OP_BCOM:
+		case OP_LSH:
+		case OP_RSHI:
+		case OP_RSHU:
+			return qtrue;
+		default:
+			return qfalse;
+	}
+}
+
+
+/*
+=================
+VM_InlineCandidate
+
+Accepts leaf procedures in form of:
+
+ENTER n; [LOCAL n+8; LOAD4]; <stack-only ops>; LEAVE n; PUSH; LEAVE n
+
+i.e. an expression of at most one argument which is used once, first
+=================
+*/
+static qboolean VM_InlineCandidate( const instruction_t *buf, int instructionCount, int target, inlineBody_t *body ) {
+	const instruction_t *ci, *end;
+	int frame, maxOps;
+
+	if ( target <= 0 || target >= instructionCount || buf[ target ].op != OP_ENTER ) {
+		return qfalse;
+	}
+
+	frame = buf[ target ].value;
+	ci = buf + target + 1;
+	end = buf + instructionCount - 2;
+
+	body->numArgs = 0;
+	body->count = 0;
+
+	if ( ci->op == OP_LOCAL && ci->value == frame + 8 && (ci+1)->op == OP_LOAD4 ) {
+		body->numArgs = 1;
+		ci += 2;
+	}
+
+	// ARG + CONST + CALL or CONST + CALL
+	maxOps = body->numArgs ? 3 : 2;
+
+	while ( ci < end && ci->op != OP_LEAVE ) {
+		if ( !VM_InlineOp( ci->op ) || body->count >= maxOps ) {
+			return qfalse;
+		}
+		body->ops[ body->count++ ] = *ci;
+		ci++;
+	}
+
+	if ( ci >= end || ci->value != frame || (ci+1)->op != OP_PUSH || (ci+2)->op != OP_LEAVE ) {
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+/*
+=================
+VM_ResultConsumer
+
+Returns opcode which pops result of call at specified position
+=================
+*/
+static int VM_ResultConsumer( const instruction_t *buf, int instructionCount, int call ) {
+	const instruction_t *ci;
+	int n, depth;
+
+	depth = buf[ call ].opStack;
+
+	for ( n = call + 1, ci = buf + n; n < instructionCount && n < call + 64; n++, ci++ ) {
+		if ( ci->opStack + ops[ ci->op ].stack < depth ) {
+			return ci->op;
+		}
+	}
+
+	return OP_UNDEF;
+}
+
+
+/*
+=================
+VM_InlineCalls
+
+Replace calls of tiny leaf procedures with their bodies, which also
+exposes constant arguments to constant folding in compilers and drops
+argument stores. Instruction numbering must be preserved for jump tables
+in data segment so replacement is done in place with OP_IGNORE padding.
+Must be called after VM_CheckInstructions() as it relies on jused flags.
+=================
+*/
+static void VM_InlineCalls( vm_t *vm, instruction_t *buf ) {
+	inlineBody_t body;
+	instruction_t *ci, *site, *proc;
+	int i, n, k, slots, opStack, inlined;
+
+	proc = NULL;
+	inlined = 0;
+
+	for ( i = 0, ci = buf; i < vm->instructionCount; i++, ci++ ) {
+		if ( ci->op == OP_ENTER ) {
+			proc = ci;
+			continue;
+		}
+
+		if ( ci->op != OP_CALL || i < 2 || (ci-1)->op != OP_CONST || proc == NULL ) {
+			continue;
+		}
+
+		// discarded result, compilers expect only call results there
+		k = VM_ResultConsumer( buf, vm->instructionCount, i );
+		if ( k == OP_POP || k == OP_UNDEF ) {
+			continue;
+		}
+
+		if ( !VM_InlineCandidate( buf, vm->instructionCount, (ci-1)->value, &body ) ) {
+			continue;
+		}
+
+		if ( body.numArgs ) {
+			if ( (ci-2)->op != OP_ARG || (ci-2)->value != 8 ) {
+				continue;
+			}
+			site = ci - 2;
+			slots = 3;
+		} else {
+			site = ci - 1;
+			slots = 2;
+		}
+
+		// no jumps into the middle of call sequence
+		for ( k = 0; k < slots; k++ ) {
+			if ( site[k].jused ) {
+				break;
+			}
+		}
+		if ( k != slots ) {
+			continue;
+		}
+
+		opStack = site->opStack;
+		n = slots - body.count;
+		if ( n > 0 ) {
+			VM_IgnoreInstructions( site, n );
+			for ( k = 0; k < n; k++ ) {
+				site[k].opStack = opStack;
+			}
+		}
+
+		for ( k = 0; k < body.count; k++ ) {
+			Com_Memset( site + n + k, 0, sizeof( *site ) );
+			site[n+k].op = body.ops[k].op;
+			site[n+k].value = body.ops[k].value;
+			site[n+k].opStack = opStack;
+			opStack += ops[ body.ops[k].op ].stack;
+			if ( opStack > proc->opStack ) {
+				proc->opStack = opStack;
+			}
+		}
+
+		inlined++;
+	}
+
+	if ( inlined ) {
+		Com_DPrintf( "%s: inlined %i call sites\n", __func__, inlined );
+	}
+}
+
+
 /*
 =================
 VM_ReplaceInstructions
@@ -1605,24 +1861,9 @@ void VM_ReplaceInstructions( vm_t *vm, instruction_t *buf ) {
 		}
 	}
 
-	if ( vm->index == VM_GAME ) {
-		if ( vm->crc32sum == 0x5AAE0ACC && vm->instructionCount == 251521 && vm->exactDataLength == 1872720 ) {
-			vm->forceDataMask = qtrue; // OSP server doing some bad things with memory
-		} else {
-			vm->forceDataMask = qfalse;
-		}
-	}
+	VM_ApplyDataFixes( vm );
 
 	if ( vm->index == VM_UI ) {
-		// fix OSP demo UI
-		if ( vm->crc32sum == 0xCA84F31D && vm->instructionCount == 78585 && vm->exactDataLength == 542180 ) {
-			if ( memcmp( vm->dataBase + 0x3D2E, "dm_67", 5 ) == 0 ) {
-				memcpy( vm->dataBase + 0x3D2E, "dm_??", 5 );
-			}
-			if ( memcmp( vm->dataBase + 0x3D50, "\"%s.%s\"\n", 8 ) == 0 ) {
-				memcpy( vm->dataBase + 0x3D50, "\"%s\"\n", 6 );
-			}
-		}
 		// fix defrag-1.91.25 demo UI - masked Q_strupr() calls for directories and filenames
 		if ( vm->crc32sum == 0x6E51985F && vm->instructionCount == 125942 && vm->exactDataLength == 1334788 ) {
 			ip = buf + 60150;
@@ -1633,6 +1874,10 @@ void VM_ReplaceInstructions( vm_t *vm, instruction_t *buf ) {
 			}
 		}
 	}
+
+	if ( vm_inline->integer ) {
+		VM_InlineCalls( vm, buf );
+	}
 }
 
 
@@ -1724,6 +1969,63 @@ static void * QDECL VM_LoadDll( const char *name, vmMainFunc_t *entryPoint, dllS
 }
 
 
+/*
+================
+VM_SetFastSyscalls
+
+Registers system calls which compiled code may call directly,
+must be done before VM_Create() to take effect
+================
+*/
+void VM_SetFastSyscalls( vmIndex_t index, const vmFastSyscallDef_t *defs, int count ) {
+
+	if ( (unsigned)index >= VM_COUNT ) {
+		Com_Error( ERR_DROP, "VM_SetFastSyscalls: bad vm index %i", index );
+	}
+
+	fastSyscallDefs[ index ] = defs;
+	numFastSyscallDefs[ index ] = count;
+}
+
+
+/*
+================
+VM_BuildFastSyscalls
+================
+*/
+static void VM_BuildFastSyscalls( vm_t *vm ) {
+	const vmFastSyscallDef_t *defs;
+	int i, count, maxNum;
+
+	defs = fastSyscallDefs[ vm->index ];
+	count = numFastSyscallDefs[ vm->index ];
+
+	vm->fastSyscalls = NULL;
+	vm->numFastSyscalls = 0;
+
+	maxNum = -1;
+	for ( i = 0; i < count; i++ ) {
+		if ( defs[i].num < 0 || !defs[i].func ) {
+			Com_Error( ERR_FATAL, "VM_BuildFastSyscalls: bad syscall %i", defs[i].num );
+		}
+		if ( defs[i].num > maxNum ) {
+			maxNum = defs[i].num;
+		}
+	}
+
+	if ( maxNum < 0 ) {
+		return;
+	}
+
+	vm->numFastSyscalls = maxNum + 1;
+	vm->fastSyscalls = Hunk_Alloc( vm->numFastSyscalls * sizeof( vm->fastSyscalls[0] ), h_high );
+
+	for ( i = 0; i < count; i++ ) {
+		vm->fastSyscalls[ defs[i].num ] = defs[i].func;
+	}
+}
+
+
 /*
 ================
 VM_Create
@@ -1809,6 +2111,10 @@ vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, dllSyscall_t dllSyscall
 
 	vm->compiled = qfalse;
 
+	VM_ProfileBuildProcs( vm, header );
+
+	VM_BuildFastSyscalls( vm );
+
 #ifdef NO_VM_COMPILED
 	if ( interpret >= VMI_COMPILED ) {
 		Com_Printf( "Architecture doesn't have a bytecode compiler, using interpreter\n" );
@@ -1862,6 +2168,8 @@ void VM_Free( vm_t *vm ) {
 		}
 	}
 
+	VM_ProfileRelease( vm );
+
 	if ( vm->destroy )
 		vm->destroy( vm );
 
@@ -2015,7 +2323,7 @@ static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 VM_NameToVM
 ==============
 */
-static vm_t *VM_NameToVM( const char *name )
+vm_t *VM_NameToVM( const char *name )
 {
 	vmIndex_t index;
 
@@ -66,6 +66,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define NUM_PASSES       1
 #endif
 
+#if idx64
+#define USE_JIT_CACHE	// store relocatable native code in homepath
+#endif
+
 #define DYN_ALLOC_RX
 #define DYN_ALLOC_SX
 
@@ -174,6 +178,7 @@ typedef enum
 	FUNC_CALL,
 	FUNC_SYSC,
 	FUNC_BCPY,
+	FUNC_FSYS,
 	FUNC_PSOF,
 	FUNC_OSOF,
 	FUNC_BADJ,
@@ -2769,6 +2774,71 @@ static void( *const badDataReadPtr )( void ) = BadDataRead;
 static void( *const badDataWritePtr )( void ) = BadDataWrite;
 
 
+// absolute pointers embedded in generated code, resolved
+// again when code is loaded from the jit cache
+typedef enum {
+	RELOC_VM,				// vm_t fields
+	RELOC_DATA,				// vm->dataBase
+	RELOC_CODE,				// vm->codeBase
+	RELOC_SYSCALL,			// vm->systemCall
+	RELOC_ERRJUMP,
+	RELOC_BADJUMP,
+	RELOC_BADSTACK,
+	RELOC_BADOPSTACK,
+	RELOC_BADDATAREAD,
+	RELOC_BADDATAWRITE,
+	RELOC_COUNT
+} relocBase_t;
+
+typedef struct {
+	int32_t		offset;		// of 64-bit immediate in code
+	int32_t		base;		// relocBase_t
+	int64_t		addend;
+} vmReloc_t;
+
+#define MAX_RELOCS 32
+
+static vmReloc_t relocs[ MAX_RELOCS ];
+static int numRelocs;
+
+
+static intptr_t VM_RelocBase( const vm_t *vm, relocBase_t base )
+{
+	switch ( base ) {
+		case RELOC_VM:			return (intptr_t) vm;
+		case RELOC_DATA:		return (intptr_t) vm->dataBase;
+		case RELOC_CODE:		return (intptr_t) vm->codeBase.ptr;
+		case RELOC_SYSCALL:		return (intptr_t) vm->systemCall;
+		case RELOC_ERRJUMP:		return (intptr_t) &errJumpPtr;
+		case RELOC_BADJUMP:		return (intptr_t) &badJumpPtr;
+		case RELOC_BADSTACK:	return (intptr_t) &badStackPtr;
+		case RELOC_BADOPSTACK:	return (intptr_t) &badOpStackPtr;
+		case RELOC_BADDATAREAD:	return (intptr_t) &badDataReadPtr;
+		case RELOC_BADDATAWRITE:return (intptr_t) &badDataWritePtr;
+		default:				return 0;
+	}
+}
+
+
+// loads pointer with fixed size encoding and records its location
+static void mov_rx_reloc( const vm_t *vm, uint32_t reg, relocBase_t base, intptr_t addend )
+{
+#if idx64
+	emit_mov_rx_imm64( reg, VM_RelocBase( vm, base ) + addend );
+	if ( code ) {
+		if ( numRelocs < MAX_RELOCS ) {
+			relocs[ numRelocs ].offset = compiledOfs - 8;
+			relocs[ numRelocs ].base = base;
+			relocs[ numRelocs ].addend = addend;
+		}
+		numRelocs++;
+	}
+#else
+	mov_rx_ptr( reg, (void *)( VM_RelocBase( vm, base ) + addend ) );
+#endif
+}
+
+
 static void VM_FreeBuffers( void )
 {
 	// should be freed in reversed allocation order
@@ -3057,6 +3127,26 @@ static void EmitCallOffset( func_t Func )
 }
 
 
+#if idx64
+// forward jumps with 32-bit displacement, resolved by emit_jump_target()
+static int emit_jump_forward( const char *opcode )
+{
+	EmitString( opcode );
+	Emit4( 0 );
+	return compiledOfs;
+}
+
+
+static void emit_jump_target( int from )
+{
+	const int32_t rel = compiledOfs - from;
+	if ( code ) {
+		memcpy( code + from - 4, &rel, sizeof( rel ) );
+	}
+}
+#endif
+
+
 static void emit_CheckReg( vm_t *vm, uint32_t reg, func_t func )
 {
 	if ( vm->forceDataMask || !( vm_rtChecks->integer & VM_RTCHECK_DATA ) )
@@ -3216,7 +3306,7 @@ static void EmitCallFunc( vm_t *vm )
 	emit_store_rx( R_EAX | R_REX, R_ECX, 0 );	// mov [rcx], rax
 
 	// vm->programStack = programStack - 4; // or 8
-	mov_rx_ptr( R_EDX, &vm->programStack ); // mov rdx, &vm->programStack
+	mov_rx_reloc( vm, R_EDX, RELOC_VM, offsetof( vm_t, programStack ) ); // mov rdx, &vm->programStack
 
 	emit_lea( R_EAX, R_PSTACK, -8 );		// lea eax, [programStack-8]
 	emit_store_rx( R_EAX, R_EDX, 0 );		// mov [rdx], eax
@@ -3337,6 +3427,65 @@ static void EmitBCPYFunc( vm_t *vm )
 }
 
 
+#if idx64
+/*
+=================
+EmitFastSysCallFunc
+
+Calls vm->fastSyscalls[ eax ]( procBase + 4 ) directly on QVM stack,
+without widening arguments to intptr_t like generic system call does
+=================
+*/
+static void EmitFastSysCallFunc( vm_t *vm )
+{
+	// allocate stack for shadow(win32) and saved registers
+	emit_op_rx_imm32( X_SUB, R_ESP | R_REX, SHADOW_BASE + PUSH_STACK ); // sub rsp, 40
+
+	emit_lea( R_EDX | R_REX, R_ESP, SHADOW_BASE ); // lea rdx, [ rsp + SHADOW_BASE ]
+
+	// save scratch registers
+	emit_store_rx( R_ESI | R_REX, R_EDX, 0 );	// mov [rdx+00], rsi
+	emit_store_rx( R_EDI | R_REX, R_EDX, 8 );	// mov [rdx+08], rdi
+	emit_store_rx( R_R11 | R_REX, R_EDX, 16 );	// mov [rdx+16], r11 - dataMask
+
+	// vm->programStack = programStack - 8;
+	mov_rx_reloc( vm, R_EDX, RELOC_VM, offsetof( vm_t, programStack ) ); // mov rdx, &vm->programStack
+	emit_lea( R_ECX, R_PSTACK, -8 );		// lea ecx, [programStack-8]
+	emit_store_rx( R_ECX, R_EDX, 0 );		// mov [rdx], ecx
+
+	// args[0] = syscallNum
+	emit_store_rx( R_EAX, R_PROCBASE, 4 );	// mov [procBase+4], eax
+
+	// rax = vm->fastSyscalls[ syscallNum ]
+	mov_rx_reloc( vm, R_EDX, RELOC_VM, offsetof( vm_t, fastSyscalls ) ); // mov rdx, &vm->fastSyscalls
+	emit_load4( R_EDX | R_REX, R_EDX, 0 );	// mov rdx, [rdx]
+	EmitString( "48 8B 04 C2" );			// mov rax, [rdx+rax*8]
+
+#ifdef _WIN32
+	emit_lea( R_ECX | R_REX, R_PROCBASE, 4 ); // lea rcx, [procBase+4]
+#else // linux/*BSD ABI
+	emit_lea( R_EDI | R_REX, R_PROCBASE, 4 ); // lea rdi, [procBase+4]
+#endif
+
+	emit_call_rx( R_EAX );					// call rax
+
+	// restore registers
+	emit_lea( R_EDX | R_REX, R_ESP, SHADOW_BASE ); // lea rdx, [rsp + SHADOW_BASE]
+
+	emit_load4( R_ESI | R_REX, R_EDX, 0 );	// mov rsi, [rdx+00]
+	emit_load4( R_EDI | R_REX, R_EDX, 8 );	// mov rdi, [rdx+08]
+	emit_load4( R_R11 | R_REX, R_EDX, 16 );	// mov r11, [rdx+16]
+
+	// store result in opStack[4]
+	emit_store_rx( R_EAX, R_OPSTACK, 4 );	// *opstack[ opStack + 4 ] = eax
+
+	emit_op_rx_imm32( X_ADD, R_ESP | R_REX, SHADOW_BASE + PUSH_STACK ); // add rsp, 40
+
+	emit_ret();								// ret
+}
+#endif
+
+
 static void EmitFloatJump( instruction_t *i, int op, int addr )
 {
 	switch ( op ) {
@@ -3375,7 +3524,7 @@ static void EmitFloatJump( instruction_t *i, int op, int addr )
 
 static void EmitPSOFFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &badStackPtr ); // mov eax, &badStackPtr
+	mov_rx_reloc( vm, R_EAX, RELOC_BADSTACK, 0 ); // mov eax, &badStackPtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3383,7 +3532,7 @@ static void EmitPSOFFunc( vm_t *vm )
 
 static void EmitOSOFFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &badOpStackPtr ); // mov eax, &badOpStackPtr
+	mov_rx_reloc( vm, R_EAX, RELOC_BADOPSTACK, 0 ); // mov eax, &badOpStackPtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3391,7 +3540,7 @@ static void EmitOSOFFunc( vm_t *vm )
 
 static void EmitBADJFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &badJumpPtr ); // mov eax, &badJumpPtr
+	mov_rx_reloc( vm, R_EAX, RELOC_BADJUMP, 0 ); // mov eax, &badJumpPtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3399,7 +3548,7 @@ static void EmitBADJFunc( vm_t *vm )
 
 static void EmitERRJFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &errJumpPtr ); // mov eax, &errJumpPtr
+	mov_rx_reloc( vm, R_EAX, RELOC_ERRJUMP, 0 ); // mov eax, &errJumpPtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3407,7 +3556,7 @@ static void EmitERRJFunc( vm_t *vm )
 
 static void EmitDATRFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &badDataReadPtr ); // mov eax, &badDataReadPtr
+	mov_rx_reloc( vm, R_EAX, RELOC_BADDATAREAD, 0 ); // mov eax, &badDataReadPtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3415,7 +3564,7 @@ static void EmitDATRFunc( vm_t *vm )
 
 static void EmitDATWFunc( vm_t *vm )
 {
-	mov_rx_ptr( R_EAX, &badDataWritePtr ); // mov eax, &badDataWritePtr
+	mov_rx_reloc( vm, R_EAX, RELOC_BADDATAWRITE, 0 ); // mov eax, &badDataWritePtr
 	EmitString( "FF 10" );		// call [eax]
 	emit_ret();					// ret
 }
@@ -3423,6 +3572,97 @@ static void EmitDATWFunc( vm_t *vm )
 
 #ifdef CONST_OPTIMIZE
 
+/*
+=================
+EmitSysCall
+
+eax must be masked by caller
+=================
+*/
+static void EmitSysCall( vm_t *vm, int callnum )
+{
+	func_t func = FUNC_SYSC;
+
+#if idx64
+	if ( callnum < vm->numFastSyscalls && vm->fastSyscalls[ callnum ] ) {
+		func = FUNC_FSYS;
+	}
+#endif
+
+	mov_rx_imm32( R_EAX, callnum ); // eax - syscall number
+	if ( opstack != 1 ) {
+		emit_op_rx_imm32( X_ADD, R_OPSTACK | R_REX, (opstack-1) * sizeof( int32_t ) );
+		EmitCallOffset( func );
+		emit_op_rx_imm32( X_SUB, R_OPSTACK | R_REX, (opstack-1) * sizeof( int32_t ) );
+	} else {
+		EmitCallOffset( func );
+	}
+}
+
+
+#if idx64
+/*
+=================
+EmitMemTrap
+
+Inline TRAP_MEMSET/TRAP_MEMCPY when all ranges are within data segment,
+otherwise take regular system call path which will validate arguments
+=================
+*/
+static void EmitMemTrap( vm_t *vm, int callnum )
+{
+	int slow[3], done, n, i;
+
+	n = 0;
+
+	emit_load4( R_EDX, R_PROCBASE, 8 );				// mov edx, [procBase+8] - dest
+	emit_load4( R_ECX, R_PROCBASE, 16 );			// mov ecx, [procBase+16] - count
+	emit_mov_rx( R_EAX, R_EDX );					// mov eax, edx
+	emit_or_rx( R_EAX, R_ECX );						// or eax, ecx
+	if ( callnum == TRAP_MEMCPY ) {
+		emit_load4( R_R8, R_PROCBASE, 12 );			// mov r8d, [procBase+12] - src
+		emit_or_rx( R_EAX, R_R8 );					// or eax, r8d
+	}
+	emit_op_rx_imm32( X_CMP, R_EAX, vm->dataMask );	// cmp eax, dataMask
+	slow[n++] = emit_jump_forward( "0F 87" );		// ja +slow
+
+	emit_lea_base_index( R_EAX, R_EDX, R_ECX );		// lea eax, [rdx+rcx]
+	emit_op_rx_imm32( X_CMP, R_EAX, vm->dataMask );	// cmp eax, dataMask
+	slow[n++] = emit_jump_forward( "0F 87" );		// ja +slow
+
+	if ( callnum == TRAP_MEMCPY ) {
+		emit_lea_base_index( R_EAX, R_R8, R_ECX );	// lea eax, [r8+rcx]
+		emit_op_rx_imm32( X_CMP, R_EAX, vm->dataMask ); // cmp eax, dataMask
+		slow[n++] = emit_jump_forward( "0F 87" );	// ja +slow
+	}
+
+	emit_push( R_EDI );								// push rdi
+	emit_lea_base_index( R_EDI | R_REX, R_DATABASE, R_EDX ); // lea rdi, [rbx+rdx]
+	if ( callnum == TRAP_MEMCPY ) {
+		emit_push( R_ESI );							// push rsi
+		emit_lea_base_index( R_ESI | R_REX, R_DATABASE, R_R8 ); // lea rsi, [rbx+r8]
+		EmitString( "F3 A4" );						// rep movsb
+		emit_pop( R_ESI );							// pop rsi
+	} else {
+		emit_load4( R_EAX, R_PROCBASE, 12 );		// mov eax, [procBase+12] - value
+		EmitString( "F3 AA" );						// rep stosb
+	}
+	emit_pop( R_EDI );								// pop rdi
+
+	emit_mov_rx( R_EAX, R_EDX );					// mov eax, edx - return dest
+	emit_store_rx( R_EAX, R_OPSTACK, opstack * sizeof( int32_t ) ); // *opstack = eax
+	done = emit_jump_forward( "E9" );				// jmp +done
+
+	for ( i = 0; i < n; i++ ) {
+		emit_jump_target( slow[i] );
+	}
+	EmitSysCall( vm, callnum );
+
+	emit_jump_target( done );
+}
+#endif
+
+
 static qboolean IsFloorTrap( const vm_t *vm, const int trap )
 {
 	if ( trap == ~CG_FLOOR && vm->index == VM_CGAME )
@@ -3669,16 +3909,18 @@ static qboolean ConstOptimize( vm_t *vm, instruction_t *ci, instruction_t *ni )
 
 			flush_volatile();
 
+			if ( vm->callSites ) {
+				emit_store_imm32( ip, R_PROCBASE, 0 ); // mov dword ptr [ebp], ip - call site for profiler
+			}
+
 			if ( ci->value < 0 ) { // syscall
 				mask_rx( R_EAX );
-				mov_rx_imm32( R_EAX, ~ci->value ); // eax - syscall number
-				if ( opstack != 1 ) {
-					emit_op_rx_imm32( X_ADD, R_OPSTACK | R_REX, (opstack-1) * sizeof( int32_t ) );
-					EmitCallOffset( FUNC_SYSC );
-					emit_op_rx_imm32( X_SUB, R_OPSTACK | R_REX, (opstack-1) * sizeof( int32_t ) );
-				} else {
-					EmitCallOffset( FUNC_SYSC );
-				}
+#if idx64
+				if ( ~ci->value == TRAP_MEMSET || ~ci->value == TRAP_MEMCPY ) {
+					EmitMemTrap( vm, ~ci->value );
+				} else
+#endif
+				EmitSysCall( vm, ~ci->value );
 				ip += 1; // OP_CALL
 				store_syscall_opstack();
 				return qtrue;
@@ -3877,6 +4119,369 @@ static void dump_code( const char *vmname, uint8_t *c, int32_t code_len )
 #endif
 
 
+/*
+=================
+VM_SetProcAddresses
+=================
+*/
+static void VM_SetProcAddresses( vm_t *vm, int funcsOffset )
+{
+	int i;
+
+	if ( !vm->procs ) {
+		return;
+	}
+
+	for ( i = 0; i < vm->numProcs; i++ ) {
+		vm->procs[ i ].native = (const byte *) instructionPointers[ vm->procs[ i ].ip ];
+	}
+
+	// end marker, system functions follow
+	vm->procs[ i ].native = vm->codeBase.ptr + funcsOffset;
+}
+
+
+/*
+=================
+VM_ProtectCompiled
+=================
+*/
+static qboolean VM_ProtectCompiled( vm_t *vm )
+{
+#ifdef VM_X86_MMAP
+	if ( mprotect( vm->codeBase.ptr, vm->codeSize, PROT_READ|PROT_EXEC ) ) {
+		VM_Destroy_Compiled( vm );
+		Com_Printf( S_COLOR_YELLOW "VM_CompileX86: mprotect failed\n" );
+		return qfalse;
+	}
+#elif _WIN32
+	{
+		DWORD oldProtect = 0;
+
+		// remove write permissions.
+		if ( !VirtualProtect( vm->codeBase.ptr, vm->codeSize, PAGE_EXECUTE_READ, &oldProtect ) ) {
+			VM_Destroy_Compiled( vm );
+			Com_Printf( S_COLOR_YELLOW "VM_CompileX86: VirtualProtect failed\n" );
+			return qfalse;
+		}
+	}
+#endif
+
+	vm->destroy = VM_Destroy_Compiled;
+
+	return qtrue;
+}
+
+
+#ifdef USE_JIT_CACHE
+
+/*
+=============================================================================
+
+JIT CODE CACHE
+
+Compiled code is stored in <homepath>/jitcache/<gamedir>/<name>.jit together
+with relocations for every absolute pointer it embeds, so it can be mapped at
+any address. Everything codegen depends on is part of the key, any mismatch or
+damaged file simply falls back to normal compilation.
+
+Cache files are executed as native code, so they are signed with HMAC-MD5
+using a random per-install key kept in <homepath>/jitcache.key. QVM file
+access is confined to game directories and can reach neither that key nor,
+since FS_AllowedExtension() rejects "jit", write cache files in its own
+directory.
+
+=============================================================================
+*/
+
+#define JIT_CACHE_IDENT		(('Q'<<24)+('J'<<16)+('I'<<8)+'T')
+#define JIT_CACHE_VERSION	6
+#define JIT_CACHE_KEYS		15
+#define JIT_CACHE_SECRET	32
+#define JIT_CACHE_KEYFILE	"jitcache.key"
+#define JIT_CACHE_MAC		16
+
+typedef struct {
+	int32_t		ident;
+	int32_t		version;
+	char		build[64];
+	uint32_t	key[ JIT_CACHE_KEYS ];
+	int32_t		codeLength;			// without instruction pointers table
+	int32_t		numRelocs;
+	int32_t		instructionCount;
+	int32_t		funcsOffset;		// system functions after compiled code
+	byte		mac[ JIT_CACHE_MAC ];	// of header up to this field and payload
+} jitCacheHeader_t;
+
+// payload: code[ codeLength ], relocs[ numRelocs ], offsets[ instructionCount ]
+
+
+/*
+=================
+VM_JitCacheSecret
+
+Loads the per-install signing key, creates it on first use
+=================
+*/
+static qboolean VM_JitCacheSecret( byte *secret )
+{
+	static byte key[ JIT_CACHE_SECRET ];
+	static qboolean loaded;
+	fileHandle_t f;
+	int len;
+
+	if ( !loaded ) {
+		len = FS_SV_FOpenFileRead( JIT_CACHE_KEYFILE, &f );
+		if ( f != FS_INVALID_HANDLE ) {
+			loaded = ( len == sizeof( key ) && FS_Read( key, sizeof( key ), f ) == sizeof( key ) );
+			FS_FCloseFile( f );
+			if ( !loaded ) {
+				Com_DPrintf( S_COLOR_YELLOW "VM_JitCacheSecret: bad %s\n", JIT_CACHE_KEYFILE );
+			}
+		} else if ( Sys_RandomBytes( key, sizeof( key ) ) ) {
+			f = FS_SV_FOpenFileWrite( JIT_CACHE_KEYFILE );
+			if ( f != FS_INVALID_HANDLE ) {
+				loaded = ( FS_Write( key, sizeof( key ), f ) == sizeof( key ) );
+				FS_FCloseFile( f );
+			}
+		}
+		if ( !loaded ) {
+			return qfalse;
+		}
+	}
+
+	Com_Memcpy( secret, key, sizeof( key ) );
+	return qtrue;
+}
+
+
+/*
+=================
+VM_JitCacheMAC
+=================
+*/
+static qboolean VM_JitCacheMAC( const jitCacheHeader_t *h, const byte *payload, int payloadLength, byte *mac )
+{
+	byte secret[ JIT_CACHE_SECRET ];
+
+	if ( !VM_JitCacheSecret( secret ) ) {
+		return qfalse;
+	}
+
+	Com_MD5HMAC( secret, sizeof( secret ), h, offsetof( jitCacheHeader_t, mac ), payload, payloadLength, mac );
+	Com_Memset( secret, 0, sizeof( secret ) );
+
+	return qtrue;
+}
+
+
+/*
+=================
+VM_JitCacheName
+=================
+*/
+static void VM_JitCacheName( const vm_t *vm, char *name, int size )
+{
+	Com_sprintf( name, size, "jitcache/%s/%s.jit", FS_GetCurrentGameDir(), vm->name );
+}
+
+
+static void VM_JitCacheKey( const vm_t *vm, jitCacheHeader_t *h )
+{
+	int i;
+
+	Com_Memset( h, 0, sizeof( *h ) );
+
+	h->ident = JIT_CACHE_IDENT;
+	h->version = JIT_CACHE_VERSION;
+	Com_sprintf( h->build, sizeof( h->build ), "%s %s %s %s", SVN_VERSION, ARCH_STRING, __DATE__, __TIME__ );
+
+	h->key[0] = vm->crc32sum;
+	h->key[1] = vm->instructionCount;
+	h->key[2] = vm->exactDataLength;
+	h->key[3] = vm->dataMask;
+	h->key[4] = vm->stackBottom;
+	h->key[5] = vm->index;
+	h->key[6] = vm_rtChecks->integer;
+	h->key[7] = CPU_Flags;
+	h->key[8] = vm->forceDataMask;
+	h->key[9] = vm->numJumpTableTargets;
+	h->key[10] = vm->numJumpTableTargets ? crc32_buffer( (const byte *)vm->jumpTableTargets, vm->numJumpTableTargets * sizeof( int32_t ) ) : 0;
+	h->key[11] = sizeof( vm_t );
+	h->key[13] = vm_inline->integer;
+	h->key[14] = vm->callSites;
+	for ( i = 0; i < vm->numFastSyscalls; i++ ) {
+		if ( vm->fastSyscalls[ i ] ) {
+			h->key[12] = h->key[12] * 31 + i + 1;
+		}
+	}
+}
+
+
+/*
+=================
+VM_LoadJitCache
+=================
+*/
+static qboolean VM_LoadJitCache( vm_t *vm )
+{
+	jitCacheHeader_t key, *h;
+	const vmReloc_t *rel;
+	const int32_t *offsets;
+	char name[ MAX_QPATH ];
+	byte mac[ JIT_CACHE_MAC ];
+	fileHandle_t f;
+	byte *buf;
+	int len, payload, i;
+
+	VM_JitCacheName( vm, name, sizeof( name ) );
+
+	len = FS_SV_FOpenFileRead( name, &f );
+	if ( f == FS_INVALID_HANDLE ) {
+		return qfalse;
+	}
+
+	if ( len < (int)sizeof( *h ) ) {
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	buf = (byte *) Z_Malloc( len );
+	if ( FS_Read( buf, len, f ) != len ) {
+		FS_FCloseFile( f );
+		Z_Free( buf );
+		return qfalse;
+	}
+	FS_FCloseFile( f );
+
+	// instruction fixups may alter codegen flags
+	VM_ApplyDataFixes( vm );
+	VM_JitCacheKey( vm, &key );
+
+	h = (jitCacheHeader_t *) buf;
+	payload = len - sizeof( *h );
+
+	if ( memcmp( h, &key, offsetof( jitCacheHeader_t, codeLength ) ) != 0
+		|| h->instructionCount != vm->instructionCount
+		|| h->codeLength <= 0 || h->codeLength & 7
+		|| h->funcsOffset <= 0 || h->funcsOffset > h->codeLength
+		|| h->numRelocs <= 0 || h->numRelocs > MAX_RELOCS
+		|| payload != h->codeLength + h->numRelocs * (int)sizeof( vmReloc_t ) + h->instructionCount * (int)sizeof( int32_t )
+		|| !VM_JitCacheMAC( h, buf + sizeof( *h ), payload, mac )
+		|| memcmp( mac, h->mac, sizeof( mac ) ) != 0 ) {
+		Com_DPrintf( "VM_LoadJitCache: %s is stale\n", name );
+		Z_Free( buf );
+		return qfalse;
+	}
+
+	rel = (const vmReloc_t *)( buf + sizeof( *h ) + h->codeLength );
+	offsets = (const int32_t *)( rel + h->numRelocs );
+
+	for ( i = 0; i < h->numRelocs; i++ ) {
+		if ( rel[i].offset < 0 || rel[i].offset > h->codeLength - 8 || rel[i].base < 0 || rel[i].base >= RELOC_COUNT ) {
+			Z_Free( buf );
+			return qfalse;
+		}
+	}
+
+	for ( i = 0; i < h->instructionCount; i++ ) {
+		if ( offsets[i] < -1 || offsets[i] >= h->codeLength ) {
+			Z_Free( buf );
+			return qfalse;
+		}
+	}
+
+	code = (byte*)VM_Alloc_Compiled( vm, h->codeLength, h->instructionCount * sizeof( intptr_t ) );
+	if ( code == NULL ) {
+		Z_Free( buf );
+		return qfalse;
+	}
+	instructionPointers = (intptr_t*)(byte*)(code + h->codeLength);
+
+	memcpy( code, buf + sizeof( *h ), h->codeLength );
+
+	for ( i = 0; i < h->numRelocs; i++ ) {
+		int64_t v = VM_RelocBase( vm, rel[i].base ) + rel[i].addend;
+		memcpy( code + rel[i].offset, &v, sizeof( v ) );
+	}
+
+	for ( i = 0; i < h->instructionCount; i++ ) {
+		if ( offsets[i] < 0 ) {
+			instructionPointers[ i ] = (intptr_t)badJumpPtr;
+		} else {
+			instructionPointers[ i ] = (intptr_t)vm->codeBase.ptr + offsets[ i ];
+		}
+	}
+
+	Z_Free( buf );
+
+	VM_SetProcAddresses( vm, h->funcsOffset );
+
+	if ( !VM_ProtectCompiled( vm ) ) {
+		return qfalse;
+	}
+
+	Com_Printf( "VM file %s restored from jit cache, %i bytes of code\n", vm->name, vm->codeLength );
+
+	return qtrue;
+}
+
+
+/*
+=================
+VM_SaveJitCache
+=================
+*/
+static void VM_SaveJitCache( vm_t *vm, int codeLength )
+{
+	jitCacheHeader_t h;
+	char name[ MAX_QPATH ];
+	fileHandle_t f;
+	byte *buf, *p;
+	int32_t *offsets;
+	int payload, i;
+
+	if ( numRelocs > MAX_RELOCS ) {
+		Com_DPrintf( S_COLOR_YELLOW "VM_SaveJitCache: too many relocations (%i)\n", numRelocs );
+		return;
+	}
+
+	VM_JitCacheKey( vm, &h );
+	h.codeLength = codeLength;
+	h.numRelocs = numRelocs;
+	h.instructionCount = vm->instructionCount;
+	h.funcsOffset = funcOffset[ FUNC_CALL ];
+
+	payload = codeLength + numRelocs * sizeof( vmReloc_t ) + vm->instructionCount * sizeof( int32_t );
+	p = buf = (byte *) Z_Malloc( payload );
+
+	memcpy( p, code, codeLength ); p += codeLength;
+	memcpy( p, relocs, numRelocs * sizeof( vmReloc_t ) ); p += numRelocs * sizeof( vmReloc_t );
+	offsets = (int32_t *) p;
+	for ( i = 0; i < vm->instructionCount; i++ ) {
+		offsets[i] = inst[i].jused ? instructionOffsets[i] : -1;
+	}
+
+	if ( !VM_JitCacheMAC( &h, buf, payload, h.mac ) ) {
+		Z_Free( buf );
+		return;
+	}
+
+	VM_JitCacheName( vm, name, sizeof( name ) );
+	f = FS_SV_FOpenFileWrite( name );
+	if ( f != FS_INVALID_HANDLE ) {
+		if ( FS_Write( &h, sizeof( h ), f ) != sizeof( h ) || FS_Write( buf, payload, f ) != payload ) {
+			Com_Printf( S_COLOR_YELLOW "VM_SaveJitCache: error writing %s\n", name );
+		}
+		FS_FCloseFile( f );
+	}
+
+	Z_Free( buf );
+}
+
+#endif // USE_JIT_CACHE
+
+
 /*
 =================
 VM_Compile
@@ -3902,6 +4507,14 @@ qboolean VM_Compile( vm_t *vm, vmHeader_t *header ) {
 	int num_compress;
 #endif
 
+	vm->callSites = vm_profileCallSites->integer ? qtrue : qfalse;
+
+#ifdef USE_JIT_CACHE
+	if ( vm_jitCache->integer && VM_LoadJitCache( vm ) ) {
+		return qtrue;
+	}
+#endif
+
 	inst = (instruction_t*)Z_Malloc( (header->instructionCount + 8 ) * sizeof( instruction_t ) );
 	instructionOffsets = (int*)Z_Malloc( header->instructionCount * sizeof( int ) );
 
@@ -3949,6 +4562,7 @@ __compile:
 	// translate all instructions
 	ip = 0;
 	compiledOfs = 0;
+	numRelocs = 0;
 #if JUMP_OPTIMIZE
 	jumpSizeChanged = 0;
 #endif
@@ -3976,21 +4590,21 @@ __compile:
 	emit_push( R_R14 );				// push r14
 	emit_push( R_R15 );				// push r15
 
-	mov_rx_ptr( R_DATABASE, vm->dataBase );			// mov rbx, vm->dataBase
+	mov_rx_reloc( vm, R_DATABASE, RELOC_DATA, 0 );	// mov rbx, vm->dataBase
 
-	// do not use wrapper, force constant size there
-	emit_mov_rx_imm64( R_INSPOINTERS, (intptr_t) instructionPointers ); // mov r8, vm->instructionPointers
+	// constant size, final value is known only at last pass
+	mov_rx_reloc( vm, R_INSPOINTERS, RELOC_CODE, instructionPointers ? (byte *)instructionPointers - code : 0 ); // mov r12, instructionPointers
 
 	mov_rx_imm32( R_DATAMASK, vm->dataMask );		// mov r11d, vm->dataMask
 	mov_rx_imm32( R_STACKBOTTOM, vm->stackBottom );	// mov r14d, vm->stackBottom
 
-	mov_rx_ptr( R_EAX, &vm->opStack );				// mov rax, &vm->opStack
+	mov_rx_reloc( vm, R_EAX, RELOC_VM, offsetof( vm_t, opStack ) ); // mov rax, &vm->opStack
 
 	emit_load4( R_OPSTACK | R_REX, R_EAX, 0 );		// mov rdi, [rax]
 
-	mov_rx_ptr( R_SYSCALL, vm->systemCall );		// mov r13, vm->systemCall
+	mov_rx_reloc( vm, R_SYSCALL, RELOC_SYSCALL, 0 );	// mov r13, vm->systemCall
 
-	mov_rx_ptr( R_EAX, &vm->programStack );			// mov rax, &vm->programStack
+	mov_rx_reloc( vm, R_EAX, RELOC_VM, offsetof( vm_t, programStack ) ); // mov rax, &vm->programStack
 
 	emit_load4( R_PSTACK, R_EAX, 0 ); // mov esi, dword ptr [rax]
 
@@ -3999,7 +4613,7 @@ __compile:
 	EmitCallOffset( FUNC_ENTR );
 
 #ifdef DEBUG_VM
-	mov_rx_ptr( R_EAX, &vm->programStack );		// mov rax, &vm->programStack
+	mov_rx_reloc( vm, R_EAX, RELOC_VM, offsetof( vm_t, programStack ) ); // mov rax, &vm->programStack
 	emit_store_rx( R_PSTACK, R_EAX, 0 );		// mov [rax], esi
 #endif
 
@@ -4132,6 +4746,9 @@ __compile:
 			case OP_CALL:
 				rx[0] = load_rx_opstack( R_EAX | FORCED ); // eax = *opstack
 				flush_volatile();
+				if ( vm->callSites ) {
+					emit_store_imm32( ip - 1, R_PROCBASE, 0 ); // mov dword ptr [ebp], ip - call site for profiler
+				}
 				if ( opstack != 1 ) {
 					emit_op_rx_imm32( X_ADD, R_OPSTACK | R_REX, ( opstack - 1 ) * sizeof( int32_t ) );
 					EmitCallOffset( FUNC_CALL ); // call +FUNC_CALL
@@ -4655,6 +5272,12 @@ __compile:
 		funcOffset[FUNC_BCPY] = compiledOfs;
 		EmitBCPYFunc( vm );
 
+#if idx64
+		EmitAlign( FUNC_ALIGN );
+		funcOffset[FUNC_FSYS] = compiledOfs;
+		EmitFastSysCallFunc( vm );
+#endif
+
 		// ***************
 		// error functions
 		// ***************
@@ -4731,28 +5354,19 @@ __compile:
 		instructionPointers[ i ] = (intptr_t)vm->codeBase.ptr + instructionOffsets[ i ];
 	}
 
-	VM_FreeBuffers();
-
-#ifdef VM_X86_MMAP
-	if ( mprotect( vm->codeBase.ptr, vm->codeSize, PROT_READ|PROT_EXEC ) ) {
-		VM_Destroy_Compiled( vm );
-		Com_Printf( S_COLOR_YELLOW "VM_CompileX86: mprotect failed\n" );
-		return qfalse;
-	}
-#elif _WIN32
-	{
-		DWORD oldProtect = 0;
+	VM_SetProcAddresses( vm, funcOffset[ FUNC_CALL ] );
 
-		// remove write permissions.
-		if ( !VirtualProtect( vm->codeBase.ptr, vm->codeSize, PAGE_EXECUTE_READ, &oldProtect ) ) {
-			VM_Destroy_Compiled( vm );
-			Com_Printf( S_COLOR_YELLOW "VM_CompileX86: VirtualProtect failed\n" );
-			return qfalse;
-		}
+#ifdef USE_JIT_CACHE
+	if ( vm_jitCache->integer ) {
+		VM_SaveJitCache( vm, PAD( compiledOfs, 8 ) );
 	}
 #endif
 
-	vm->destroy = VM_Destroy_Compiled;
+	VM_FreeBuffers();
+
+	if ( !VM_ProtectCompiled( vm ) ) {
+		return qfalse;
+	}
 
 	Com_Printf( "VM file %s compiled to %i bytes of code\n", vm->name, compiledOfs );
 
@@ -4849,9 +5463,10 @@ int32_t VM_CallCompiled( vm_t *vm, int nargs, int32_t *args )
 		image[i + 2] = args[i];
 	}
 
-	// these only needed for interpreter:
+	// terminates call chain for sampling profiler
+	image[0] = -1;
+	// only needed for interpreter:
 	// image[1] =  0;	// return stack
-	// image[0] = -1;	// will terminate loop on return
 
 #ifdef DEBUG_VM
 	opStack[0] = 0xDEADC0DE;
@@ -44,12 +44,28 @@ void VM_StackTrace( vm_t *vm, int programCounter, int programStack ) {
 
 }
 
+// use direct threading with computed goto where supported,
+// so every handler gets its own indirect branch for prediction
+#if defined(__GNUC__) || defined(__clang__)
+#define USE_COMPUTED_GOTO
+#endif
+
 // macro opcode sequences
 typedef enum {
 	MOP_LOCAL_LOAD4 = OP_MAX,
 	MOP_LOCAL_LOAD4_CONST,
 	MOP_LOCAL_LOCAL,
 	MOP_LOCAL_LOCAL_LOAD4,
+	MOP_LOCAL_LOAD4_ADD,
+	MOP_LOCAL_CONST_STORE4,
+	MOP_LOCAL_INC,
+	MOP_CONST_EQ,
+	MOP_CONST_NE,
+	MOP_CONST_LTI,
+	MOP_CONST_LEI,
+	MOP_CONST_GTI,
+	MOP_CONST_GEI,
+	MOP_MAX
 } macro_op_t;
 
 
@@ -57,7 +73,8 @@ typedef enum {
 =================
 VM_FindMOps
 
-Search for known macro-op sequences
+Search for known macro-op sequences, only first instruction is replaced
+so jumps into the middle of sequence will still execute original code
 =================
 */
 static void VM_FindMOps( instruction_t *buf, int instructionCount )
@@ -73,6 +90,23 @@ static void VM_FindMOps( instruction_t *buf, int instructionCount )
 		op0 = ci->op;
 
 		if ( op0 == OP_LOCAL ) {
+			// local += const
+			if ( (ci+1)->op == OP_LOCAL && (ci+1)->value == ci->value && (ci+2)->op == OP_LOAD4 && (ci+3)->op == OP_CONST && (ci+4)->op == OP_ADD && (ci+5)->op == OP_STORE4 ) {
+				ci->op = MOP_LOCAL_INC;
+				ci += 6; i += 6;
+				continue;
+			}
+			// leave const for compare-and-branch
+			if ( (ci+1)->op == OP_LOAD4 && (ci+2)->op == OP_CONST && (ci+3)->op >= OP_EQ && (ci+3)->op <= OP_GEI ) {
+				ci->op = MOP_LOCAL_LOAD4;
+				ci += 2; i += 2;
+				continue;
+			}
+			if ( (ci+1)->op == OP_LOAD4 && (ci+2)->op == OP_ADD ) {
+				ci->op = MOP_LOCAL_LOAD4_ADD;
+				ci += 3; i += 3;
+				continue;
+			}
 			if ( (ci+1)->op == OP_LOAD4 && (ci+2)->op == OP_CONST ) {
 				ci->op = MOP_LOCAL_LOAD4_CONST;
 				ci += 3; i += 3;
@@ -84,6 +118,12 @@ static void VM_FindMOps( instruction_t *buf, int instructionCount )
 				continue;
 			}
 
+			if ( (ci+1)->op == OP_CONST && (ci+2)->op == OP_STORE4 ) {
+				ci->op = MOP_LOCAL_CONST_STORE4;
+				ci += 3; i += 3;
+				continue;
+			}
+
 			if ( (ci+1)->op == OP_LOCAL && (ci+2)->op == OP_LOAD4 ) {
 				ci->op = MOP_LOCAL_LOCAL_LOAD4;
 				ci += 3; i += 3;
@@ -96,6 +136,22 @@ static void VM_FindMOps( instruction_t *buf, int instructionCount )
 			}
 		}
 
+		if ( op0 == OP_CONST ) {
+			switch ( (ci+1)->op ) {
+				case OP_EQ:  ci->op = MOP_CONST_EQ; break;
+				case OP_NE:  ci->op = MOP_CONST_NE; break;
+				case OP_LTI: ci->op = MOP_CONST_LTI; break;
+				case OP_LEI: ci->op = MOP_CONST_LEI; break;
+				case OP_GTI: ci->op = MOP_CONST_GTI; break;
+				case OP_GEI: ci->op = MOP_CONST_GEI; break;
+				default: break;
+			}
+			if ( ci->op != OP_CONST ) {
+				ci += 2; i += 2;
+				continue;
+			}
+		}
+
 		ci++;
 		i++;
 	}
@@ -198,6 +254,96 @@ int VM_CallInterpreted2( vm_t *vm, int nargs, int32_t *args ) {
 	// main interpreter loop, will exit when a LEAVE instruction
 	// grabs the -1 program counter
 
+#ifdef USE_COMPUTED_GOTO
+	{
+	static const void *dispatch[ MOP_MAX ] = {
+		[OP_UNDEF] = &&L_OP_UNDEF,
+		[OP_IGNORE] = &&L_OP_IGNORE,
+		[OP_BREAK] = &&L_OP_BREAK,
+		[OP_ENTER] = &&L_OP_ENTER,
+		[OP_LEAVE] = &&L_OP_LEAVE,
+		[OP_CALL] = &&L_OP_CALL,
+		[OP_PUSH] = &&L_OP_PUSH,
+		[OP_POP] = &&L_OP_POP,
+		[OP_CONST] = &&L_OP_CONST,
+		[OP_LOCAL] = &&L_OP_LOCAL,
+		[OP_JUMP] = &&L_OP_JUMP,
+		[OP_EQ] = &&L_OP_EQ,
+		[OP_NE] = &&L_OP_NE,
+		[OP_LTI] = &&L_OP_LTI,
+		[OP_LEI] = &&L_OP_LEI,
+		[OP_GTI] = &&L_OP_GTI,
+		[OP_GEI] = &&L_OP_GEI,
+		[OP_LTU] = &&L_OP_LTU,
+		[OP_LEU] = &&L_OP_LEU,
+		[OP_GTU] = &&L_OP_GTU,
+		[OP_GEU] = &&L_OP_GEU,
+		[OP_EQF] = &&L_OP_EQF,
+		[OP_NEF] = &&L_OP_NEF,
+		[OP_LTF] = &&L_OP_LTF,
+		[OP_LEF] = &&L_OP_LEF,
+		[OP_GTF] = &&L_OP_GTF,
+		[OP_GEF] = &&L_OP_GEF,
+		[OP_LOAD1] = &&L_OP_LOAD1,
+		[OP_LOAD2] = &&L_OP_LOAD2,
+		[OP_LOAD4] = &&L_OP_LOAD4,
+		[OP_STORE1] = &&L_OP_STORE1,
+		[OP_STORE2] = &&L_OP_STORE2,
+		[OP_STORE4] = &&L_OP_STORE4,
+		[OP_ARG] = &&L_OP_ARG,
+		[OP_BLOCK_COPY] = &&L_OP_BLOCK_COPY,
+		[OP_SEX8] = &&L_OP_SEX8,
+		[OP_SEX16] = &&L_OP_SEX16,
+		[OP_NEGI] = &&L_OP_NEGI,
+		[OP_ADD] = &&L_OP_ADD,
+		[OP_SUB] = &&L_OP_SUB,
+		[OP_DIVI] = &&L_OP_DIVI,
+		[OP_DIVU] = &&L_OP_DIVU,
+		[OP_MODI] = &&L_OP_MODI,
+		[OP_MODU] = &&L_OP_MODU,
+		[OP_MULI] = &&L_OP_MULI,
+		[OP_MULU] = &&L_OP_MULU,
+		[OP_BAND] = &&L_OP_BAND,
+		[OP_BOR] = &&L_OP_BOR,
+		[OP_BXOR] = &&L_OP_BXOR,
+		[OP_BCOM] = &&L_OP_BCOM,
+		[OP_LSH] = &&L_OP_LSH,
+		[OP_RSHI] = &&L_OP_RSHI,
+		[OP_RSHU] = &&L_OP_RSHU,
+		[OP_NEGF] = &&L_OP_NEGF,
+		[OP_ADDF] = &&L_OP_ADDF,
+		[OP_SUBF] = &&L_OP_SUBF,
+		[OP_DIVF] = &&L_OP_DIVF,
+		[OP_MULF] = &&L_OP_MULF,
+		[OP_CVIF] = &&L_OP_CVIF,
+		[OP_CVFI] = &&L_OP_CVFI,
+		[MOP_LOCAL_LOAD4] = &&L_MOP_LOCAL_LOAD4,
+		[MOP_LOCAL_LOAD4_CONST] = &&L_MOP_LOCAL_LOAD4_CONST,
+		[MOP_LOCAL_LOCAL] = &&L_MOP_LOCAL_LOCAL,
+		[MOP_LOCAL_LOCAL_LOAD4] = &&L_MOP_LOCAL_LOCAL_LOAD4,
+		[MOP_LOCAL_LOAD4_ADD] = &&L_MOP_LOCAL_LOAD4_ADD,
+		[MOP_LOCAL_CONST_STORE4] = &&L_MOP_LOCAL_CONST_STORE4,
+		[MOP_LOCAL_INC] = &&L_MOP_LOCAL_INC,
+		[MOP_CONST_EQ] = &&L_MOP_CONST_EQ,
+		[MOP_CONST_NE] = &&L_MOP_CONST_NE,
+		[MOP_CONST_LTI] = &&L_MOP_CONST_LTI,
+		[MOP_CONST_LEI] = &&L_MOP_CONST_LEI,
+		[MOP_CONST_GTI] = &&L_MOP_CONST_GTI,
+		[MOP_CONST_GEI] = &&L_MOP_CONST_GEI
+	};
+
+#define VM_CASE(x)	L_##x
+#define VM_NEXT		do { v0 = ci->value; opcode = ci->op; ci++; goto *dispatch[ opcode ]; } while ( 0 )
+#define VM_BREAK	do { r0.i = opStack[0]; r1.i = opStack[-1]; VM_NEXT; } while ( 0 )
+
+		r0.i = r1.i = 0;
+		VM_NEXT;
+#else
+
+#define VM_CASE(x)	case x
+#define VM_NEXT		goto nextInstruction2
+#define VM_BREAK	break
+
 	while ( 1 ) {
 
 		r0.i = opStack[0];
@@ -210,16 +356,25 @@ nextInstruction2:
 		ci++;
 
 		switch ( opcode ) {
+#endif
+
+		VM_CASE( OP_UNDEF ):
+#ifndef USE_COMPUTED_GOTO
+		default:
+#endif
+			Com_Error( ERR_DROP, "VM_CallInterpreted2: bad opcode %i", opcode );
+			VM_BREAK;
 
-		case OP_IGNORE:
+
+		VM_CASE( OP_IGNORE ):
 			ci += v0;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_BREAK:
+		VM_CASE( OP_BREAK ):
 			vm->breakCount++;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_ENTER:
+		VM_CASE( OP_ENTER ):
 			// get size of stack frame
 			programStack -= v0;
 			if ( programStack < vm->stackBottom ) {
@@ -228,9 +383,9 @@ nextInstruction2:
 			if ( opStack + ((ci-1)->opStack/4) >= opStackTop ) {
 				Com_Error( ERR_DROP, "VM opStack overflow" );
 			}
-			break;
+			VM_BREAK;
 
-		case OP_LEAVE:
+		VM_CASE( OP_LEAVE ):
 			// remove our stack frame
 			programStack += v0;
 
@@ -243,9 +398,9 @@ nextInstruction2:
 				Com_Error( ERR_DROP, "VM program counter out of range in OP_LEAVE" );
 			}
 			ci = inst + v1;
-			break;
+			VM_BREAK;
 
-		case OP_CALL:
+		VM_CASE( OP_CALL ):
 			// save current program counter
 			*(int *)&image[ programStack ] = ci - inst;
 
@@ -282,36 +437,36 @@ nextInstruction2:
 			} else {
 				Com_Error( ERR_DROP, "VM program counter out of range in OP_CALL" );
 			}
-			break;
+			VM_BREAK;
 
 		// push and pop are only needed for discarded or bad function return values
-		case OP_PUSH:
+		VM_CASE( OP_PUSH ):
 			opStack++;
-			break;
+			VM_BREAK;
 
-		case OP_POP:
+		VM_CASE( OP_POP ):
 			opStack--;
-			break;
+			VM_BREAK;
 
-		case OP_CONST:
+		VM_CASE( OP_CONST ):
 			opStack++;
 			r1.i = r0.i;
 			r0.i = *opStack = v0;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_LOCAL:
+		VM_CASE( OP_LOCAL ):
 			opStack++;
 			r1.i = r0.i;
 			r0.i = *opStack = v0 + programStack;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_JUMP:
+		VM_CASE( OP_JUMP ):
 			if ( r0.u >= vm->instructionCount ) {
 				Com_Error( ERR_DROP, "VM program counter out of range in OP_JUMP" );
 			}
 			ci = inst + r0.i;
 			opStack--;
-			break;
+			VM_BREAK;
 
 		/*
 		===================================================================
@@ -319,138 +474,138 @@ nextInstruction2:
 		===================================================================
 		*/
 
-		case OP_EQ:
+		VM_CASE( OP_EQ ):
 			opStack -= 2;
 			if ( r1.i == r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_NE:
+		VM_CASE( OP_NE ):
 			opStack -= 2;
 			if ( r1.i != r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LTI:
+		VM_CASE( OP_LTI ):
 			opStack -= 2;
 			if ( r1.i < r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LEI:
+		VM_CASE( OP_LEI ):
 			opStack -= 2;
 			if ( r1.i <= r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GTI:
+		VM_CASE( OP_GTI ):
 			opStack -= 2;
 			if ( r1.i > r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GEI:
+		VM_CASE( OP_GEI ):
 			opStack -= 2;
 			if ( r1.i >= r0.i )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LTU:
+		VM_CASE( OP_LTU ):
 			opStack -= 2;
 			if ( r1.u < r0.u )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LEU:
+		VM_CASE( OP_LEU ):
 			opStack -= 2;
 			if ( r1.u <= r0.u )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GTU:
+		VM_CASE( OP_GTU ):
 			opStack -= 2;
 			if ( r1.u > r0.u )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GEU:
+		VM_CASE( OP_GEU ):
 			opStack -= 2;
 			if ( r1.u >= r0.u )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_EQF:
+		VM_CASE( OP_EQF ):
 			opStack -= 2;
 			if ( r1.f == r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_NEF:
+		VM_CASE( OP_NEF ):
 			opStack -= 2;
 			if ( r1.f != r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LTF:
+		VM_CASE( OP_LTF ):
 			opStack -= 2;
 			if ( r1.f < r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_LEF:
+		VM_CASE( OP_LEF ):
 			opStack -= 2;
 			if ( r1.f <= r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GTF:
+		VM_CASE( OP_GTF ):
 			opStack -= 2;
 			if ( r1.f > r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
-		case OP_GEF:
+		VM_CASE( OP_GEF ):
 			opStack -= 2;
 			if ( r1.f >= r0.f )
 				ci = inst + v0;
-			break;
+			VM_BREAK;
 
 		//===================================================================
 
-		case OP_LOAD1:
+		VM_CASE( OP_LOAD1 ):
 			r0.i = *opStack = image[ r0.i & dataMask ];
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_LOAD2:
+		VM_CASE( OP_LOAD2 ):
 			r0.i = *opStack = *(unsigned short *)&image[ r0.i & dataMask ];
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_LOAD4:
+		VM_CASE( OP_LOAD4 ):
 			r0.i = *opStack = *(int32_t *)&image[ r0.i & dataMask ];
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case OP_STORE1:
+		VM_CASE( OP_STORE1 ):
 			image[ r1.i & dataMask ] = r0.i;
 			opStack -= 2;
-			break;
+			VM_BREAK;
 
-		case OP_STORE2:
+		VM_CASE( OP_STORE2 ):
 			*(short *)&image[ r1.i & dataMask ] = r0.i;
 			opStack -= 2;
-			break;
+			VM_BREAK;
 
-		case OP_STORE4:
+		VM_CASE( OP_STORE4 ):
 			*(int *)&image[ r1.i & dataMask ] = r0.i;
 			opStack -= 2;
-			break;
+			VM_BREAK;
 
-		case OP_ARG:
+		VM_CASE( OP_ARG ):
 			// single byte offset from programStack
 			*(int32_t *)&image[ ( v0 + programStack ) /*& ( dataMask & ~3 ) */ ] = r0.i;
 			opStack--;
-			break;
+			VM_BREAK;
 
-		case OP_BLOCK_COPY:
+		VM_CASE( OP_BLOCK_COPY ):
 			{
 				int		*src, *dest;
 				int		count, srci, desti;
@@ -468,138 +623,207 @@ nextInstruction2:
 				memcpy( dest, src, count );
 				opStack -= 2;
 			}
-			break;
-
-		case OP_SEX8:
-			*opStack = (signed char)*opStack;
-			break;
-
-		case OP_SEX16:
-			*opStack = (signed short)*opStack;
-			break;
-
-		case OP_NEGI:
-			*opStack = -r0.i;
-			break;
-
-		case OP_ADD:
-			*(--opStack) = r1.i + r0.i;
-			break;
-
-		case OP_SUB:
-			*(--opStack) = r1.i - r0.i;
-			break;
-
-		case OP_DIVI:
-			*(--opStack) = r1.i / r0.i;
-			break;
-
-		case OP_DIVU:
-			*(--opStack) = r1.u / r0.u;
-			break;
-
-		case OP_MODI:
-			*(--opStack) = r1.i % r0.i;
-			break;
-
-		case OP_MODU:
-			*(--opStack) = r1.u % r0.u;
-			break;
-
-		case OP_MULI:
-			*(--opStack) = r1.i * r0.i;
-			break;
-
-		case OP_MULU:
-			*(--opStack) = r1.u * r0.u;
-			break;
-
-		case OP_BAND:
-			*(--opStack) = r1.u & r0.u;
-			break;
-
-		case OP_BOR:
-			*(--opStack) = r1.u | r0.u;
-			break;
-
-		case OP_BXOR:
-			*(--opStack) = r1.u ^ r0.u;
-			break;
-
-		case OP_BCOM:
-			*opStack = ~ r0.u;
-			break;
-
-		case OP_LSH:
-			*(--opStack) = r1.i << r0.i;
-			break;
-
-		case OP_RSHI:
-			*(--opStack) = r1.i >> r0.i;
-			break;
-
-		case OP_RSHU:
-			*(--opStack) = r1.u >> r0.i;
-			break;
-
-		case OP_NEGF:
-			*(float *)opStack =  - r0.f;
-			break;
-
-		case OP_ADDF:
-			*(float *)(--opStack) = r1.f + r0.f;
-			break;
-
-		case OP_SUBF:
-			*(float *)(--opStack) = r1.f - r0.f;
-			break;
-
-		case OP_DIVF:
-			*(float *)(--opStack) = r1.f / r0.f;
-			break;
-
-		case OP_MULF:
-			*(float *)(--opStack) = r1.f * r0.f;
-			break;
-
-		case OP_CVIF:
-			*(float *)opStack = (float) r0.i;
-			break;
-
-		case OP_CVFI:
-			*opStack = (int) r0.f;
-			break;
-
-		case MOP_LOCAL_LOAD4:
+			VM_BREAK;
+
+		VM_CASE( OP_SEX8 ):
+			r0.i = *opStack = (signed char)r0.i;
+			VM_NEXT;
+
+		VM_CASE( OP_SEX16 ):
+			r0.i = *opStack = (signed short)r0.i;
+			VM_NEXT;
+
+		VM_CASE( OP_NEGI ):
+			r0.i = *opStack = -r0.i;
+			VM_NEXT;
+
+		VM_CASE( OP_ADD ):
+			r0.i = *(--opStack) = r1.i + r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_SUB ):
+			r0.i = *(--opStack) = r1.i - r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_DIVI ):
+			r0.i = *(--opStack) = r1.i / r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_DIVU ):
+			r0.i = *(--opStack) = r1.u / r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_MODI ):
+			r0.i = *(--opStack) = r1.i % r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_MODU ):
+			r0.i = *(--opStack) = r1.u % r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_MULI ):
+			r0.i = *(--opStack) = r1.i * r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_MULU ):
+			r0.i = *(--opStack) = r1.u * r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_BAND ):
+			r0.i = *(--opStack) = r1.u & r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_BOR ):
+			r0.i = *(--opStack) = r1.u | r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_BXOR ):
+			r0.i = *(--opStack) = r1.u ^ r0.u;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_BCOM ):
+			r0.i = *opStack = ~ r0.u;
+			VM_NEXT;
+
+		VM_CASE( OP_LSH ):
+			r0.i = *(--opStack) = r1.i << r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_RSHI ):
+			r0.i = *(--opStack) = r1.i >> r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_RSHU ):
+			r0.i = *(--opStack) = r1.u >> r0.i;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_NEGF ):
+			r0.f = *(float *)opStack =  - r0.f;
+			VM_NEXT;
+
+		VM_CASE( OP_ADDF ):
+			r0.f = *(float *)(--opStack) = r1.f + r0.f;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_SUBF ):
+			r0.f = *(float *)(--opStack) = r1.f - r0.f;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_DIVF ):
+			r0.f = *(float *)(--opStack) = r1.f / r0.f;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_MULF ):
+			r0.f = *(float *)(--opStack) = r1.f * r0.f;
+			r1.i = opStack[-1];
+			VM_NEXT;
+
+		VM_CASE( OP_CVIF ):
+			r0.f = *(float *)opStack = (float) r0.i;
+			VM_NEXT;
+
+		VM_CASE( OP_CVFI ):
+			r0.i = *opStack = (int) r0.f;
+			VM_NEXT;
+
+		VM_CASE( MOP_LOCAL_LOAD4 ):
 			ci++;
 			opStack++;
 			r1.i = r0.i;
 			r0.i = *opStack = *(int32_t *)&image[ v0 + programStack ];
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case MOP_LOCAL_LOAD4_CONST:
+		VM_CASE( MOP_LOCAL_LOAD4_CONST ):
 			r1.i = opStack[1] = *(int32_t *)&image[ v0 + programStack ];
 			r0.i = opStack[2] = (ci+1)->value;
 			opStack += 2;
 			ci += 2;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case MOP_LOCAL_LOCAL:
+		VM_CASE( MOP_LOCAL_LOCAL ):
 			r1.i = opStack[1] = v0 + programStack;
 			r0.i = opStack[2] = ci->value + programStack;
 			opStack += 2;
 			ci++;
-			goto nextInstruction2;
+			VM_NEXT;
 
-		case MOP_LOCAL_LOCAL_LOAD4:
+		VM_CASE( MOP_LOCAL_LOCAL_LOAD4 ):
 			r1.i = opStack[1] = v0 + programStack;
 			r0.i /*= opStack[2]*/ = ci->value + programStack;
 			r0.i = opStack[2] = *(int32_t *)&image[ r0.i /*& dataMask*/ ];
 			opStack += 2;
 			ci += 2;
-			goto nextInstruction2;
+			VM_NEXT;
+
+		VM_CASE( MOP_LOCAL_LOAD4_ADD ):
+			r0.i = *opStack = r0.i + *(int32_t *)&image[ v0 + programStack ];
+			ci += 2;
+			VM_NEXT;
+
+		VM_CASE( MOP_LOCAL_CONST_STORE4 ):
+			*(int32_t *)&image[ ( v0 + programStack ) & dataMask ] = ci->value;
+			ci += 2;
+			VM_NEXT;
+
+		VM_CASE( MOP_LOCAL_INC ):
+			*(int32_t *)&image[ ( v0 + programStack ) & dataMask ] += (ci+2)->value;
+			ci += 5;
+			VM_NEXT;
+
+		VM_CASE( MOP_CONST_EQ ):
+			opStack--;
+			ci = ( r0.i == v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
+
+		VM_CASE( MOP_CONST_NE ):
+			opStack--;
+			ci = ( r0.i != v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
+
+		VM_CASE( MOP_CONST_LTI ):
+			opStack--;
+			ci = ( r0.i < v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
+
+		VM_CASE( MOP_CONST_LEI ):
+			opStack--;
+			ci = ( r0.i <= v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
+
+		VM_CASE( MOP_CONST_GTI ):
+			opStack--;
+			ci = ( r0.i > v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
+
+		VM_CASE( MOP_CONST_GEI ):
+			opStack--;
+			ci = ( r0.i >= v0 ) ? inst + ci->value : ci + 1;
+			VM_BREAK;
 		}
+#ifndef USE_COMPUTED_GOTO
 	}
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_BREAK
 
 done:
 	//vm->currentlyInterpreting = qfalse;
@@ -159,6 +159,12 @@ typedef struct vmSymbol_s {
 	char	symName[1];		// variable sized
 } vmSymbol_t;
 
+typedef struct vmProc_s {
+	int32_t		ip;					// OP_ENTER instruction
+	int32_t		frameSize;
+	const byte	*native;			// compiled entry point, NULL if unknown
+} vmProc_t;
+
 //typedef void(*vmfunc_t)(void);
 
 typedef union vmFunc_u {
@@ -214,6 +220,13 @@ struct vm_s {
 	int32_t		*jumpTableTargets;
 	int32_t		numJumpTableTargets;
 
+	vmProc_t	*procs;				// sorted by ip, used by sampling profiler
+	int			numProcs;			// not counting end marker
+	qboolean	callSites;			// compiled OP_CALL stores call site in caller frame
+
+	vmFastSyscall_t	*fastSyscalls;	// indexed by syscall number, may be NULL
+	int			numFastSyscalls;
+
 	uint32_t	crc32sum;
 
 	qboolean	forceDataMask;
@@ -238,8 +251,19 @@ const char *VM_CheckInstructions( instruction_t *buf, int instructionCount,
 								 int numJumpTableTargets,
 								 int dataLength );
 
+vm_t *VM_NameToVM( const char *name );
+
+void VM_ProfileBuildProcs( vm_t *vm, const vmHeader_t *header );
+void VM_ProfileRelease( const vm_t *vm );
+void VM_Prof_f( void );
+
+void VM_ApplyDataFixes( vm_t *vm );
 void VM_ReplaceInstructions( vm_t *vm, instruction_t *buf );
 
+extern cvar_t *vm_jitCache;
+extern cvar_t *vm_profileCallSites;
+extern cvar_t *vm_inline;
+
 #define JUMP	(1<<0)
 #define FPU		(1<<1)
 
@@ -0,0 +1,709 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2012-2020 Quake3e project
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// vm_profile.c -- sampling profiler for QVM code
+
+/*
+
+A system timer interrupts the process at fixed rate, the sampler maps
+interrupted native PC to a QVM function and walks the program stack:
+every OP_CALL stores its instruction number in the reserved slot at
+the caller frame base, so caller frame is current frame + OP_ENTER size.
+Compiled code does that only with vm_profileCallSites enabled at load time,
+otherwise just the interrupted function is reported.
+Samples taken inside of a system call are attributed to calling function.
+
+Samples are recorded into a ring buffer from signal context and merged
+into a table of unique call chains once per frame from the main thread.
+
+  vmprof start <game|cgame|ui> [hz]
+  vmprof stop
+  vmprof dump [file]	- folded stacks, input for flamegraph tools
+  vmprof				- status and top functions
+
+*/
+
+#include "vm_local.h"
+
+#define PROF_MAX_DEPTH		32
+#define PROF_RING_SIZE		4096	// must be power of two
+#define PROF_HASH_SIZE		8192	// must be power of two
+#define PROF_DEFAULT_HZ		997		// prime, to not alias with frame rate
+#define PROF_TOP_FUNCS		16
+
+// pseudo frames
+#define PROF_FRAME_ENGINE	-1		// target vm is not running
+#define PROF_FRAME_SYSCALL	-2		// inside of a system call
+#define PROF_FRAME_STUB		-3		// compiled code outside of any function
+#define PROF_FRAME_INTERP	-4		// bytecode interpreter, no function info
+
+// x86 compiler and interpreter store call sites in caller frames
+#if id386 || idx64
+#define PROF_CALL_SITES
+#endif
+
+typedef struct {
+	int			depth;
+	int32_t		frames[ PROF_MAX_DEPTH ];	// innermost first
+} profSample_t;
+
+typedef struct {
+	uint32_t	hash;
+	int			count;
+	profSample_t stack;
+} profStack_t;
+
+typedef struct {
+	vm_t		*vm;
+	int			hz;
+	int			startTime;
+	int			stopTime;
+
+	profSample_t ring[ PROF_RING_SIZE ];
+	volatile unsigned int head;		// advanced by sampler
+	volatile unsigned int tail;		// advanced by main thread
+	volatile int dropped;
+
+	profStack_t	stacks[ PROF_HASH_SIZE ];
+	int			numStacks;
+	int			numSamples;
+	int			overflow;			// samples which didn't fit into stacks table
+} vmProfiler_t;
+
+static vmProfiler_t *prof;
+static qboolean profRunning;
+
+
+/*
+=================
+VM_ProfileBuildProcs
+
+Collect function entries and frame sizes from bytecode
+=================
+*/
+void VM_ProfileBuildProcs( vm_t *vm, const vmHeader_t *header )
+{
+	const byte *code, *code_end;
+	int32_t value;
+	int i, n, op, count;
+
+	vm->procs = NULL;
+	vm->numProcs = 0;
+
+	for ( count = 0; count < 2; count++ ) {
+		code = (const byte *) header + header->codeOffset;
+		code_end = code + header->codeLength;
+		n = 0;
+		for ( i = 0; i < header->instructionCount; i++ ) {
+			op = *code;
+			if ( op >= OP_MAX || code + 1 + ops[ op ].size > code_end ) {
+				vm->procs = NULL;
+				return;
+			}
+			if ( op == OP_ENTER ) {
+				if ( vm->procs ) {
+					memcpy( &value, code + 1, sizeof( value ) );
+					vm->procs[ n ].ip = i;
+					vm->procs[ n ].frameSize = LittleLong( value );
+					vm->procs[ n ].native = NULL;
+				}
+				n++;
+			}
+			code += 1 + ops[ op ].size;
+		}
+		if ( n == 0 ) {
+			return;
+		}
+		if ( !vm->procs ) {
+			// extra entry marks end of compiled functions
+			vm->procs = Hunk_Alloc( ( n + 1 ) * sizeof( vm->procs[0] ), h_high );
+		}
+	}
+
+	vm->procs[ n ].ip = header->instructionCount;
+	vm->procs[ n ].frameSize = 0;
+	vm->procs[ n ].native = NULL;
+
+	vm->numProcs = n;
+}
+
+
+/*
+=================
+VM_ProcForIp
+=================
+*/
+static int VM_ProcForIp( const vm_t *vm, int ip )
+{
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = vm->numProcs - 1;
+
+	if ( hi < 0 || ip < vm->procs[ 0 ].ip ) {
+		return -1;
+	}
+
+	while ( lo < hi ) {
+		mid = ( lo + hi + 1 ) >> 1;
+		if ( vm->procs[ mid ].ip <= ip ) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
+
+/*
+=================
+VM_ProcForNative
+=================
+*/
+static int VM_ProcForNative( const vm_t *vm, const byte *pc )
+{
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = vm->numProcs - 1;
+
+	if ( hi < 0 || vm->procs[ 0 ].native == NULL || pc < vm->procs[ 0 ].native ) {
+		return -1;
+	}
+
+	// helper functions emitted after the last one
+	if ( vm->procs[ hi + 1 ].native && pc >= vm->procs[ hi + 1 ].native ) {
+		return -1;
+	}
+
+	while ( lo < hi ) {
+		mid = ( lo + hi + 1 ) >> 1;
+		if ( vm->procs[ mid ].native <= pc ) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
+
+#ifdef PROF_CALL_SITES
+/*
+=================
+VM_ProfileCaller
+
+Function which owns call site stored at frame base
+=================
+*/
+static int VM_ProfileCaller( const vm_t *vm, int32_t psp )
+{
+	int32_t ip;
+
+	if ( psp < 0 || psp & 3 || (uint32_t)psp > vm->dataMask - 3 ) {
+		return -1;
+	}
+
+	ip = *(const int32_t *)( vm->dataBase + psp );
+	if ( ip < 0 || ip >= vm->instructionCount ) {
+		return -1;
+	}
+
+	return VM_ProcForIp( vm, ip );
+}
+#endif
+
+
+/*
+=================
+VM_ProfileWalk
+
+Called from signal context, must not touch anything but vm tables
+=================
+*/
+static void VM_ProfileWalk( const vm_t *vm, const byte *pc, intptr_t pstack, profSample_t *s )
+{
+#ifdef PROF_CALL_SITES
+	int32_t psp;
+#endif
+	int proc;
+
+	s->depth = 0;
+
+	if ( vm->callLevel == 0 ) {
+		s->frames[ s->depth++ ] = PROF_FRAME_ENGINE;
+		return;
+	}
+
+	if ( !vm->compiled ) {
+		s->frames[ s->depth++ ] = PROF_FRAME_INTERP;
+		return;
+	}
+
+	if ( pc >= vm->codeBase.ptr && pc < vm->codeBase.ptr + vm->codeLength ) {
+		proc = VM_ProcForNative( vm, pc );
+		if ( proc < 0 ) {
+			s->frames[ s->depth++ ] = PROF_FRAME_STUB;
+			return;
+		}
+		s->frames[ s->depth++ ] = vm->procs[ proc ].ip;
+#ifdef PROF_CALL_SITES
+		if ( pstack < 0 || !vm->callSites ) {
+			return;
+		}
+		psp = (int32_t) pstack;
+#else
+		return;
+#endif
+	} else {
+		s->frames[ s->depth++ ] = PROF_FRAME_SYSCALL;
+#ifdef PROF_CALL_SITES
+		if ( !vm->callSites ) {
+			return;
+		}
+		// saved by syscall stub as programStack - 8
+		psp = vm->programStack + 8;
+		proc = VM_ProfileCaller( vm, psp );
+		if ( proc < 0 ) {
+			return;
+		}
+		s->frames[ s->depth++ ] = vm->procs[ proc ].ip;
+#else
+		return;
+#endif
+	}
+
+#ifdef PROF_CALL_SITES
+	while ( s->depth < PROF_MAX_DEPTH ) {
+		psp += vm->procs[ proc ].frameSize;
+		proc = VM_ProfileCaller( vm, psp );
+		if ( proc < 0 ) {
+			break;
+		}
+		s->frames[ s->depth++ ] = vm->procs[ proc ].ip;
+	}
+#endif
+}
+
+
+/*
+=================
+VM_ProfileSample
+=================
+*/
+static void VM_ProfileSample( const void *pc, intptr_t pstack )
+{
+	vmProfiler_t *p = prof;
+	unsigned int head;
+
+	if ( !p || !p->vm ) {
+		return;
+	}
+
+	head = p->head;
+	if ( head - p->tail >= PROF_RING_SIZE ) {
+		p->dropped++;
+		return;
+	}
+
+	VM_ProfileWalk( p->vm, (const byte *) pc, pstack, &p->ring[ head & ( PROF_RING_SIZE - 1 ) ] );
+
+	p->head = head + 1;
+}
+
+
+/*
+=================
+VM_ProfileLeaf
+
+First real function in chain
+=================
+*/
+static int32_t VM_ProfileLeaf( const profSample_t *s )
+{
+	int i;
+
+	for ( i = 0; i < s->depth; i++ ) {
+		if ( s->frames[ i ] >= 0 ) {
+			return s->frames[ i ];
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+=================
+VM_ProfileAdd
+=================
+*/
+static void VM_ProfileAdd( const profSample_t *s )
+{
+	profStack_t *st;
+	uint32_t hash;
+	int32_t leaf;
+	int i;
+
+	hash = 2166136261U;
+	for ( i = 0; i < s->depth; i++ ) {
+		hash = ( hash ^ (uint32_t)s->frames[ i ] ) * 16777619U;
+	}
+
+	prof->numSamples++;
+
+	leaf = VM_ProfileLeaf( s );
+	if ( leaf >= 0 && prof->vm->symbols ) {
+		// keep vmprofile output meaningful for compiled code
+		VM_ValueToFunctionSymbol( prof->vm, leaf )->profileCount++;
+	}
+
+	for ( i = hash & ( PROF_HASH_SIZE - 1 ); ; i = ( i + 1 ) & ( PROF_HASH_SIZE - 1 ) ) {
+		st = &prof->stacks[ i ];
+		if ( st->count == 0 ) {
+			if ( prof->numStacks >= PROF_HASH_SIZE * 3 / 4 ) {
+				prof->overflow++;
+				return;
+			}
+			st->hash = hash;
+			st->stack.depth = s->depth;
+			memcpy( st->stack.frames, s->frames, s->depth * sizeof( s->frames[0] ) );
+			st->count = 1;
+			prof->numStacks++;
+			return;
+		}
+		if ( st->hash == hash && st->stack.depth == s->depth
+			&& memcmp( st->stack.frames, s->frames, s->depth * sizeof( s->frames[0] ) ) == 0 ) {
+			st->count++;
+			return;
+		}
+	}
+}
+
+
+/*
+=================
+VM_ProfileFrame
+
+Merge recorded samples, called once per frame
+=================
+*/
+void VM_ProfileFrame( void )
+{
+	unsigned int tail;
+
+	if ( !prof ) {
+		return;
+	}
+
+	for ( tail = prof->tail; tail != prof->head; tail++ ) {
+		VM_ProfileAdd( &prof->ring[ tail & ( PROF_RING_SIZE - 1 ) ] );
+		prof->tail = tail + 1;
+	}
+}
+
+
+/*
+=================
+VM_ProfileStop
+=================
+*/
+static void VM_ProfileStop( void )
+{
+	if ( !profRunning ) {
+		return;
+	}
+
+	Sys_StopSampler();
+	profRunning = qfalse;
+
+	VM_ProfileFrame();
+	prof->stopTime = Sys_Milliseconds();
+}
+
+
+/*
+=================
+VM_ProfileRelease
+
+Profiler can't outlive its vm
+=================
+*/
+void VM_ProfileRelease( const vm_t *vm )
+{
+	if ( !prof || prof->vm != vm ) {
+		return;
+	}
+
+	if ( profRunning ) {
+		Com_Printf( "vmprof: %s unloaded, profiling stopped\n", vm->name );
+	}
+
+	VM_ProfileStop();
+
+	Z_Free( prof );
+	prof = NULL;
+}
+
+
+/*
+=================
+VM_ProfileFrameName
+=================
+*/
+static const char *VM_ProfileFrameName( vm_t *vm, int32_t frame )
+{
+	vmSymbol_t *sym;
+
+	switch ( frame ) {
+		case PROF_FRAME_ENGINE:		return "[engine]";
+		case PROF_FRAME_SYSCALL:	return "[syscall]";
+		case PROF_FRAME_STUB:		return "[compiled stubs]";
+		case PROF_FRAME_INTERP:		return "[interpreter]";
+	}
+
+	if ( vm->symbols ) {
+		sym = VM_ValueToFunctionSymbol( vm, frame );
+		if ( sym->symValue == frame ) {
+			return sym->symName;
+		}
+	}
+
+	return va( "sub_%i", frame );
+}
+
+
+/*
+=================
+VM_ProfileDump
+=================
+*/
+static void VM_ProfileDump( const char *filename )
+{
+	const profStack_t *st;
+	fileHandle_t f;
+	char line[ PROF_MAX_DEPTH * ( MAX_QPATH + 1 ) ];
+	int i, n, stacks;
+
+	f = FS_FOpenFileWrite( filename );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "vmprof: couldn't write %s\n", filename );
+		return;
+	}
+
+	stacks = 0;
+	for ( i = 0, st = prof->stacks; i < PROF_HASH_SIZE; i++, st++ ) {
+		if ( !st->count ) {
+			continue;
+		}
+		// folded stacks are written from root to leaf
+		line[0] = '\0';
+		for ( n = st->stack.depth - 1; n >= 0; n-- ) {
+			Q_strcat( line, sizeof( line ), VM_ProfileFrameName( prof->vm, st->stack.frames[ n ] ) );
+			if ( n ) {
+				Q_strcat( line, sizeof( line ), ";" );
+			}
+		}
+		FS_Printf( f, "%s %i\n", line, st->count );
+		stacks++;
+	}
+
+	FS_FCloseFile( f );
+
+	Com_Printf( "vmprof: %i stacks, %i samples written to %s\n", stacks, prof->numSamples, filename );
+}
+
+
+/*
+=================
+VM_ProfileStatus
+=================
+*/
+static void VM_ProfileStatus( void )
+{
+	const profStack_t *st;
+	int *self, *total;
+	int i, n, k, top[ PROF_TOP_FUNCS ], numTop;
+	int proc, msec;
+	vm_t *vm;
+
+	vm = prof->vm;
+	msec = ( profRunning ? Sys_Milliseconds() : prof->stopTime ) - prof->startTime;
+
+	Com_Printf( "vmprof: %s %s, %i Hz, %i.%i sec\n", vm->name, profRunning ? "running" : "stopped",
+		prof->hz, msec / 1000, ( msec % 1000 ) / 100 );
+	Com_Printf( "%i samples, %i stacks, %i dropped, %i overflowed\n",
+		prof->numSamples, prof->numStacks, prof->dropped, prof->overflow );
+
+	if ( !prof->numSamples || !vm->numProcs ) {
+		return;
+	}
+
+	self = Z_Malloc( vm->numProcs * 2 * sizeof( int ) );
+	total = self + vm->numProcs;
+
+	for ( i = 0, st = prof->stacks; i < PROF_HASH_SIZE; i++, st++ ) {
+		if ( !st->count ) {
+			continue;
+		}
+		proc = VM_ProcForIp( vm, VM_ProfileLeaf( &st->stack ) );
+		if ( proc >= 0 ) {
+			self[ proc ] += st->count;
+		}
+		for ( n = 0; n < st->stack.depth; n++ ) {
+			if ( st->stack.frames[ n ] < 0 ) {
+				continue;
+			}
+			// count recursive functions once
+			for ( k = 0; k < n; k++ ) {
+				if ( st->stack.frames[ k ] == st->stack.frames[ n ] ) {
+					break;
+				}
+			}
+			if ( k == n && ( proc = VM_ProcForIp( vm, st->stack.frames[ n ] ) ) >= 0 ) {
+				total[ proc ] += st->count;
+			}
+		}
+	}
+
+	// simple insertion sort by self samples
+	numTop = 0;
+	for ( i = 0; i < vm->numProcs; i++ ) {
+		if ( !self[ i ] ) {
+			continue;
+		}
+		for ( n = numTop; n > 0 && self[ top[ n - 1 ] ] < self[ i ]; n-- ) {
+			if ( n < PROF_TOP_FUNCS ) {
+				top[ n ] = top[ n - 1 ];
+			}
+		}
+		if ( n < PROF_TOP_FUNCS ) {
+			top[ n ] = i;
+			if ( numTop < PROF_TOP_FUNCS ) {
+				numTop++;
+			}
+		}
+	}
+
+	Com_Printf( "  self%%  total%%  function\n" );
+	for ( i = 0; i < numTop; i++ ) {
+		proc = top[ i ];
+		Com_Printf( "%6.2f %6.2f  %s\n", 100.0 * self[ proc ] / prof->numSamples,
+			100.0 * total[ proc ] / prof->numSamples,
+			VM_ProfileFrameName( vm, vm->procs[ proc ].ip ) );
+	}
+
+	Z_Free( self );
+}
+
+
+/*
+=================
+VM_Prof_f
+=================
+*/
+void VM_Prof_f( void )
+{
+	const char *cmd;
+	char filename[ MAX_QPATH ];
+	vm_t *vm;
+	int hz;
+
+	cmd = Cmd_Argv( 1 );
+
+	if ( !Q_stricmp( cmd, "start" ) ) {
+		if ( Cmd_Argc() < 3 ) {
+			Com_Printf( "usage: %s start <game|cgame|ui> [hz]\n", Cmd_Argv( 0 ) );
+			return;
+		}
+		vm = VM_NameToVM( Cmd_Argv( 2 ) );
+		if ( !vm ) {
+			return;
+		}
+		if ( !vm->numProcs ) {
+			Com_Printf( "vmprof: %s is not a bytecode module\n", vm->name );
+			return;
+		}
+		hz = Cmd_Argc() > 3 ? atoi( Cmd_Argv( 3 ) ) : PROF_DEFAULT_HZ;
+		if ( hz < 10 || hz > 10000 ) {
+			Com_Printf( "vmprof: sampling rate should be within 10..10000 Hz\n" );
+			return;
+		}
+
+		if ( prof ) {
+			VM_ProfileStop();
+			Z_Free( prof );
+			prof = NULL;
+		}
+
+		prof = Z_Malloc( sizeof( *prof ) );
+		prof->vm = vm;
+		prof->hz = hz;
+		prof->startTime = Sys_Milliseconds();
+
+		if ( !Sys_StartSampler( hz, VM_ProfileSample ) ) {
+			Com_Printf( "vmprof: sampling timer is not available on this platform\n" );
+			Z_Free( prof );
+			prof = NULL;
+			return;
+		}
+
+		profRunning = qtrue;
+
+#ifdef PROF_CALL_SITES
+		if ( vm->compiled && !vm->callSites ) {
+			Com_Printf( "vmprof: %s has no call sites, only leaf functions will be reported (set vm_profileCallSites 1 and reload it)\n", vm->name );
+		}
+#endif
+		if ( !vm->symbols ) {
+			Com_Printf( "vmprof: no symbols for %s, functions will be reported by instruction number\n", vm->name );
+		}
+		Com_Printf( "vmprof: sampling %s at %i Hz\n", vm->name, hz );
+		return;
+	}
+
+	if ( !prof ) {
+		Com_Printf( "usage: %s start <game|cgame|ui> [hz]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "stop" ) ) {
+		VM_ProfileStop();
+		VM_ProfileStatus();
+	} else if ( !Q_stricmp( cmd, "dump" ) ) {
+		VM_ProfileFrame();
+		if ( Cmd_Argc() > 2 ) {
+			Q_strncpyz( filename, Cmd_Argv( 2 ), sizeof( filename ) );
+		} else {
+			Com_sprintf( filename, sizeof( filename ), "vmprof-%s.folded", prof->vm->name );
+		}
+		VM_ProfileDump( filename );
+	} else if ( cmd[0] == '\0' ) {
+		VM_ProfileFrame();
+		VM_ProfileStatus();
+	} else {
+		Com_Printf( "usage: %s [start <game|cgame|ui> [hz]|stop|dump [file]]\n", Cmd_Argv( 0 ) );
+	}
+}
@@ -1820,6 +1820,46 @@ static void R_LoadShaders( const lump_t *l ) {
 }
 
 
+/*
+=================
+R_PrefetchShaderImages
+
+Queues the images named by map shaders for background reading, shaders
+with their own script reference other images and are simply not found
+=================
+*/
+static int R_PrefetchShaderImages( void ) {
+	static const char *ext[] = { "png", "tga", "jpg" };
+	char *names, *name;
+	const char **list;
+	int i, e, n, count, handle;
+
+	count = s_worldData.numShaders * ARRAY_LEN( ext );
+	if ( count == 0 ) {
+		return 0;
+	}
+
+	list = ri.Malloc( count * ( sizeof( *list ) + MAX_QPATH ) );
+	names = (char *)( list + count );
+
+	for ( i = 0, n = 0; i < s_worldData.numShaders; i++ ) {
+		for ( e = 0; e < ARRAY_LEN( ext ); e++ ) {
+			name = names + n * MAX_QPATH;
+			COM_StripExtension( s_worldData.shaders[i].shader, name, MAX_QPATH );
+			Q_strcat( name, MAX_QPATH, "." );
+			Q_strcat( name, MAX_QPATH, ext[ e ] );
+			list[ n++ ] = name;
+		}
+	}
+
+	handle = ri.FS_ReadFilesAsync( list, n, NULL, NULL );
+
+	ri.Free( list );
+
+	return handle;
+}
+
+
 /*
 =================
 R_LoadMarksurfaces
@@ -2180,6 +2220,7 @@ Called directly from cgame
 */
 void RE_LoadWorldMap( const char *name ) {
 	int			i;
+	int			prefetch;
 	int32_t		size;
 	dheader_t	*header;
 	union {
@@ -2248,6 +2289,7 @@ void RE_LoadWorldMap( const char *name ) {
 
 	// load into heap
 	R_LoadShaders( &header->lumps[LUMP_SHADERS] );
+	prefetch = R_PrefetchShaderImages();
 	R_LoadLightmaps( &header->lumps[LUMP_LIGHTMAPS] );
 	R_LoadPlanes( &header->lumps[LUMP_PLANES] );
 	R_LoadFogs( &header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES] );
@@ -2268,5 +2310,7 @@ void RE_LoadWorldMap( const char *name ) {
 	// only set tr.world now that we know the entire level has loaded properly
 	tr.world = &s_worldData;
 
+	ri.FS_AsyncFinish( prefetch );
+
 	ri.FS_FreeFile( buffer.v );
 }
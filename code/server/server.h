@@ -32,16 +32,20 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define	PERS_SCORE				0		// !!! MUST NOT CHANGE, SERVER AND
 										// GAME BOTH REFERENCE !!!
 
-#define	MAX_ENT_CLUSTERS	16
+#define	MAX_ENT_CLUSTER_WORDS	8
 
 typedef struct svEntity_s {
 	struct worldSector_s *worldSector;
 	struct svEntity_s *nextEntityInWorldSector;
 
 	entityState_t	baseline;		// for delta compression of initial sighting
-	int			numClusters;		// if -1, use headnode instead
-	int			clusternums[MAX_ENT_CLUSTERS];
-	int			lastCluster;		// if all the clusters don't fit in clusternums
+	// touched clusters as a sparse list of 64-bit words of the cluster bit vector,
+	// masks are laid out in memory the same way as CM_ClusterPVS() bytes;
+	// if they don't fit, a single run from clusterWords[0] to clusterWords[1]
+	// is stored instead, with clusterMasks[0] and [1] masking the edge words
+	int			numClusterWords;	// -1 for a cluster run
+	int			clusterWords[MAX_ENT_CLUSTER_WORDS];
+	uint64_t	clusterMasks[MAX_ENT_CLUSTER_WORDS];
 	int			areanum, areanum2;
 	int			snapshotCounter;	// used to prevent double adding from portal views
 } svEntity_t;
@@ -172,6 +176,7 @@ typedef struct client_s {
 	// downloading
 	char			downloadName[MAX_QPATH]; // if not empty string, we are downloading
 	fileHandle_t	download;			// file being downloaded
+	struct svDownload_s *downloadFile;	// shared mapping of the file, replaces download
  	int				downloadSize;		// total bytes (can't use EOF because of paks)
  	int				downloadCount;		// bytes sent
 	int				downloadClientBlock;	// last block we sent to the client, awaiting ack
@@ -402,6 +407,7 @@ void		SV_InitGameProgs ( void );
 void		SV_ShutdownGameProgs ( void );
 void		SV_RestartGameProgs( void );
 qboolean	SV_inPVS (const vec3_t p1, const vec3_t p2);
+void		SV_ClearPVSCache( void );
 
 //
 // sv_bot.c
@@ -490,3 +496,11 @@ void SV_LoadFilters( const char *filename );
 const char *SV_RunFilters( const char *userinfo, const netadr_t *addr );
 void SV_AddFilter_f( void );
 void SV_AddFilterCmd_f( void );
+
+//
+// sv_http.c
+//
+void SV_HTTPInit( void );
+void SV_HTTPUpdate( void );
+void SV_HTTPFrame( void );
+void SV_HTTPShutdown( void );
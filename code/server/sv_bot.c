@@ -318,6 +318,41 @@ static void *BotImport_HunkAlloc( int size ) {
 	return Hunk_Alloc( size, h_high );
 }
 
+/*
+=================
+BotImport_MapCacheFind
+=================
+*/
+static void *BotImport_MapCacheFind( const char *qpath, int *size ) {
+	return Com_MapCacheFind( qpath, "aas", size );
+}
+
+/*
+=================
+BotImport_MapCacheStore
+
+Returns memory for resident copy of the file, caller must fill it
+immediately and then call BotImport_MapCacheCommit()
+=================
+*/
+static void *BotImport_MapCacheStore( const char *qpath, int size ) {
+	if ( !Com_MapCacheBegin( qpath, "aas" ) ) {
+		return NULL;
+	}
+	return Com_MapCacheAlloc( size );
+}
+
+/*
+=================
+BotImport_MapCacheCommit
+
+Keeps the entry started by BotImport_MapCacheStore() or discards it
+=================
+*/
+static void BotImport_MapCacheCommit( qboolean success ) {
+	Com_MapCacheEnd( success );
+}
+
 /*
 ==================
 BotImport_DebugPolygonCreate
@@ -576,6 +611,11 @@ void SV_BotInitBotLib(void) {
 
 	botlib_import.Sys_Milliseconds = Sys_Milliseconds;
 
+	//map data cache
+	botlib_import.MapCacheFind = BotImport_MapCacheFind;
+	botlib_import.MapCacheStore = BotImport_MapCacheStore;
+	botlib_import.MapCacheCommit = BotImport_MapCacheCommit;
+
 	botlib_export = (botlib_export_t *)GetBotLibAPI( BOTLIB_API_VERSION, &botlib_import );
 	assert(botlib_export); 	// somehow we end up with a zero import.
 }
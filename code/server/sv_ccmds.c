@@ -1500,6 +1500,60 @@ static void SV_Locations_f( void ) {
 	SV_PrintLocations_f( NULL );
 }
 
+
+/*
+=================
+SV_GameBench_f
+
+Runs game frames back to back without networking
+and reports time spent in the game module per frame,
+server time jumps ahead so only bots may be connected
+=================
+*/
+static void SV_GameBench_f( void ) {
+	int64_t	start, elapsed;
+	int		frames, frameMsec, i;
+	client_t *cl;
+
+	// make sure server is running
+	if ( !com_sv_running->integer || !gvm ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	// game and server time will jump ahead, only bots may follow that
+	for ( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ ) {
+		if ( cl->state >= CS_CONNECTED && cl->netchan.remoteAddress.type != NA_BOT ) {
+			Com_Printf( "Can't run gamebench with clients connected.\n" );
+			return;
+		}
+	}
+
+	frames = 1000;
+	if ( Cmd_Argc() > 1 ) {
+		frames = atoi( Cmd_Argv( 1 ) );
+		if ( frames <= 0 ) {
+			Com_Printf( "Usage: gamebench [frames]\n" );
+			return;
+		}
+	}
+
+	frameMsec = 1000 / sv_fps->integer;
+	if ( frameMsec < 1 ) {
+		frameMsec = 1;
+	}
+
+	start = Sys_Microseconds();
+	for ( i = 0; i < frames; i++ ) {
+		svs.time += frameMsec;
+		sv.time += frameMsec;
+		VM_Call( gvm, 1, GAME_RUN_FRAME, sv.time );
+	}
+	elapsed = Sys_Microseconds() - start;
+
+	Com_Printf( "%i game frames in %.3f msec, %.3f usec/frame\n", frames, elapsed / 1000.0, (double)elapsed / frames );
+}
+
 //===========================================================
 
 /*
@@ -1561,6 +1615,7 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_SetCommandCompletionFunc( "spdevmap", SV_CompleteMapName );
 #endif
 	Cmd_AddCommand ("killserver", SV_KillServer_f);
+	Cmd_AddCommand ("gamebench", SV_GameBench_f);
 #ifdef USE_BANS	
 	Cmd_AddCommand("rehashbans", SV_RehashBans_f);
 	Cmd_AddCommand("listbans", SV_ListBans_f);
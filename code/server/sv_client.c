@@ -1089,6 +1089,143 @@ CLIENT COMMAND EXECUTION
 ============================================================
 */
 
+/*
+==================
+Shared downloads
+
+Clients downloading the same file share one read-only mapping of it, blocks
+are sent straight out of the mapping and only the window state is kept per
+client. Files that can't be mapped are read through a handle per client.
+
+Truncating or rewriting a mapped file in place makes access to it fault, so
+size, modification time and inode are checked before sending from the mapping and
+clients fall back to a handle if the file has changed. Files should still be
+replaced with a rename, as there is no way to close the gap between the
+check and the copy.
+==================
+*/
+typedef struct svDownload_s {
+	char				name[ MAX_QPATH ];
+	char				ospath[ MAX_OSPATH ];
+	int					refCount;
+	const byte			*data;
+	size_t				size;
+	fileId_t			id;
+	qboolean			changed;	// removed from the list, not to be read
+	struct svDownload_s	*next;
+} svDownload_t;
+
+static svDownload_t *sv_downloads;
+
+
+/*
+==================
+SV_OpenSharedDownload
+==================
+*/
+static svDownload_t *SV_OpenSharedDownload( const char *name ) {
+	svDownload_t *dl;
+	const char *ospath;
+	fileId_t id;
+	void *data;
+	size_t size;
+
+	for ( dl = sv_downloads; dl; dl = dl->next ) {
+		if ( !FS_FilenameCompare( dl->name, name ) ) {
+			dl->refCount++;
+			return dl;
+		}
+	}
+
+	data = FS_SV_MapFile( name, &size );
+	if ( !data ) {
+		return NULL;
+	}
+
+	// block numbers and sizes are sent as shorts and longs
+	if ( size > 0x7FFFFFFF ) {
+		Sys_UnmapFile( data, size );
+		return NULL;
+	}
+
+	ospath = FS_SV_FileOSPath( name );
+	if ( !ospath || !Sys_GetFileId( ospath, &id ) || id.size != size ) {
+		Sys_UnmapFile( data, size );
+		return NULL;
+	}
+
+	dl = Z_Malloc( sizeof( *dl ) );
+	Q_strncpyz( dl->name, name, sizeof( dl->name ) );
+	Q_strncpyz( dl->ospath, ospath, sizeof( dl->ospath ) );
+	dl->refCount = 1;
+	dl->data = data;
+	dl->size = size;
+	dl->id = id;
+	dl->next = sv_downloads;
+	sv_downloads = dl;
+
+	return dl;
+}
+
+
+/*
+==================
+SV_SharedDownloadChanged
+
+Returns qtrue if the file was changed on disk since it was mapped,
+such mapping is taken off the list so new clients map the current file
+==================
+*/
+static qboolean SV_SharedDownloadChanged( svDownload_t *dl ) {
+	svDownload_t **prev;
+	fileId_t id;
+
+	if ( dl->changed ) {
+		return qtrue;
+	}
+
+	if ( Sys_GetFileId( dl->ospath, &id ) && !memcmp( &id, &dl->id, sizeof( id ) ) ) {
+		return qfalse;
+	}
+
+	Com_Printf( S_COLOR_YELLOW "WARNING: %s changed during download, switching to regular reads\n", dl->name );
+
+	for ( prev = &sv_downloads; *prev; prev = &(*prev)->next ) {
+		if ( *prev == dl ) {
+			*prev = dl->next;
+			break;
+		}
+	}
+
+	dl->changed = qtrue;
+	return qtrue;
+}
+
+
+/*
+==================
+SV_CloseSharedDownload
+==================
+*/
+static void SV_CloseSharedDownload( svDownload_t *dl ) {
+	svDownload_t **prev;
+
+	if ( --dl->refCount > 0 ) {
+		return;
+	}
+
+	for ( prev = &sv_downloads; *prev; prev = &(*prev)->next ) {
+		if ( *prev == dl ) {
+			*prev = dl->next;
+			break;
+		}
+	}
+
+	Sys_UnmapFile( (void *)dl->data, dl->size );
+	Z_Free( dl );
+}
+
+
 /*
 ==================
 SV_CloseDownload
@@ -1105,6 +1242,11 @@ static void SV_CloseDownload( client_t *cl ) {
 		cl->download = FS_INVALID_HANDLE;
 	}
 
+	if ( cl->downloadFile ) {
+		SV_CloseSharedDownload( cl->downloadFile );
+		cl->downloadFile = NULL;
+	}
+
 	*cl->downloadName = '\0';
 
 	// Free the temporary buffer space
@@ -1200,6 +1342,41 @@ static void SV_BeginDownload_f( client_t *cl ) {
 }
 
 
+/*
+==================
+SV_SwitchDownloadToHandle
+
+Continues a download from the shared mapping with a file handle,
+unacknowledged blocks were never copied out of the mapping so they
+are read again. Fails if the file size differs from what client expects
+==================
+*/
+static qboolean SV_SwitchDownloadToHandle( client_t *cl ) {
+	fileHandle_t f;
+	int offset;
+
+	if ( FS_SV_FOpenFileRead( cl->downloadName, &f ) != cl->downloadSize ) {
+		if ( f != FS_INVALID_HANDLE ) {
+			FS_FCloseFile( f );
+		}
+		return qfalse;
+	}
+
+	offset = MIN( cl->downloadClientBlock * MAX_DOWNLOAD_BLKSIZE, cl->downloadSize );
+	FS_Seek( f, offset, FS_SEEK_SET );
+
+	SV_CloseSharedDownload( cl->downloadFile );
+	cl->downloadFile = NULL;
+	cl->download = f;
+
+	cl->downloadCurrentBlock = cl->downloadXmitBlock = cl->downloadClientBlock;
+	cl->downloadCount = offset;
+	cl->downloadEOF = qfalse;
+
+	return qtrue;
+}
+
+
 /*
 ==================
 SV_WriteDownloadToClient
@@ -1217,8 +1394,9 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	int numRefPaks;
 	msg_t msg;
 	byte msgBuffer[MAX_DOWNLOAD_BLKSIZE*2+8];
+	const byte *block;
 
-	if ( cl->download == FS_INVALID_HANDLE ) {
+	if ( cl->download == FS_INVALID_HANDLE && !cl->downloadFile ) {
 		qboolean idPack = qfalse;
 		qboolean missionPack = qfalse;
  		// Chop off filename extension.
@@ -1256,11 +1434,21 @@ static int SV_WriteDownloadToClient( client_t *cl )
 
 		cl->download = FS_INVALID_HANDLE;
 
+		// share the file with other clients downloading it
+		if ( (sv_allowDownload->integer & DLF_ENABLE) &&
+			!(sv_allowDownload->integer & DLF_NO_UDP) &&
+			!idPack && !unreferenced ) {
+			cl->downloadFile = SV_OpenSharedDownload( cl->downloadName );
+			if ( cl->downloadFile ) {
+				cl->downloadSize = (int)cl->downloadFile->size;
+			}
+		}
+
 		// We open the file here
-		if ( !(sv_allowDownload->integer & DLF_ENABLE) ||
+		if ( !cl->downloadFile && ( !(sv_allowDownload->integer & DLF_ENABLE) ||
 			(sv_allowDownload->integer & DLF_NO_UDP) ||
 			idPack || unreferenced ||
-			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) {
+			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) ) {
 
 			// cannot auto-download file
 			if(unreferenced)
@@ -1328,12 +1516,28 @@ static int SV_WriteDownloadToClient( client_t *cl )
 		cl->downloadEOF = qfalse;
 	}
 
+	// don't touch the mapping if the file was truncated or rewritten
+	if ( cl->downloadFile && SV_SharedDownloadChanged( cl->downloadFile ) ) {
+		if ( !SV_SwitchDownloadToHandle( cl ) ) {
+			SV_DropClient( cl, "file changed on server while downloading" );
+			return 0;
+		}
+	}
+
 	// Perform any reads that we need to
 	while (cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW &&
 		cl->downloadSize != cl->downloadCount) {
 
 		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
 
+		if ( cl->downloadFile ) {
+			// sent from the mapping
+			cl->downloadBlockSize[curindex] = MIN( MAX_DOWNLOAD_BLKSIZE, cl->downloadSize - cl->downloadCount );
+			cl->downloadCount += cl->downloadBlockSize[curindex];
+			cl->downloadCurrentBlock++;
+			continue;
+		}
+
 		if (!cl->downloadBlocks[curindex])
 			cl->downloadBlocks[curindex] = Z_Malloc( MAX_DOWNLOAD_BLKSIZE );
 
@@ -1392,8 +1596,13 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	MSG_WriteShort( &msg, cl->downloadBlockSize[curindex] );
 
 	// Write the block
-	if ( cl->downloadBlockSize[curindex] > 0 )
-		MSG_WriteData( &msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex] );
+	if ( cl->downloadBlockSize[curindex] > 0 ) {
+		if ( cl->downloadFile )
+			block = cl->downloadFile->data + (size_t)cl->downloadXmitBlock * MAX_DOWNLOAD_BLKSIZE;
+		else
+			block = cl->downloadBlocks[curindex];
+		MSG_WriteData( &msg, block, cl->downloadBlockSize[curindex] );
+	}
 
 	MSG_WriteByte( &msg, svc_EOF );
 	SV_Netchan_Transmit( cl, &msg );
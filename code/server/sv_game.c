@@ -139,6 +139,72 @@ static void SV_SetBrushModel( sharedEntity_t *ent, const char *name ) {
 }
 
 
+/*
+===============================================================================
+
+PVS POINT CACHE
+
+Bots and game code issue lots of PVS checks from the same positions,
+so cluster and area lookups are cached by exact point coordinates.
+Leafs never change while the map is loaded.
+
+===============================================================================
+*/
+
+#define PVS_CACHE_SIZE	512		// must be power of two
+
+typedef struct {
+	uint32_t	point[3];		// exact coordinate bits
+	int			cluster;
+	int			area;
+	qboolean	valid;
+} pvsPoint_t;
+
+static pvsPoint_t	pvsCache[ PVS_CACHE_SIZE ];
+
+
+/*
+=================
+SV_ClearPVSCache
+
+Must be called after loading a new map
+=================
+*/
+void SV_ClearPVSCache( void ) {
+	Com_Memset( pvsCache, 0, sizeof( pvsCache ) );
+}
+
+
+/*
+=================
+SV_PointCluster
+=================
+*/
+static void SV_PointCluster( const vec3_t p, int *cluster, int *area ) {
+	pvsPoint_t	*pt;
+	uint32_t	bits[3];
+	uint32_t	hash;
+	int			leafnum;
+
+	memcpy( bits, p, sizeof( bits ) );
+	hash = ( bits[0] * 73856093U ) ^ ( bits[1] * 19349663U ) ^ ( bits[2] * 83492791U );
+	pt = &pvsCache[ ( hash ^ ( hash >> 16 ) ) & ( PVS_CACHE_SIZE - 1 ) ];
+
+	if ( !pt->valid || pt->point[0] != bits[0] || pt->point[1] != bits[1] || pt->point[2] != bits[2] ) {
+		leafnum = CM_PointLeafnum( p );
+		pt->point[0] = bits[0];
+		pt->point[1] = bits[1];
+		pt->point[2] = bits[2];
+		pt->cluster = CM_LeafCluster( leafnum );
+		pt->area = CM_LeafArea( leafnum );
+		pt->valid = qtrue;
+	}
+
+	*cluster = pt->cluster;
+	*area = pt->area;
+}
+
+
 /*
 =================
 SV_inPVS
@@ -148,20 +214,15 @@ Also checks portalareas so that doors block sight
 */
 qboolean SV_inPVS( const vec3_t p1, const vec3_t p2 )
 {
-	int		leafnum;
-	int		cluster;
+	int		cluster1, cluster2;
 	int		area1, area2;
 	byte	*mask;
 
-	leafnum = CM_PointLeafnum (p1);
-	cluster = CM_LeafCluster (leafnum);
-	area1 = CM_LeafArea (leafnum);
-	mask = CM_ClusterPVS (cluster);
+	SV_PointCluster( p1, &cluster1, &area1 );
+	SV_PointCluster( p2, &cluster2, &area2 );
 
-	leafnum = CM_PointLeafnum (p2);
-	cluster = CM_LeafCluster (leafnum);
-	area2 = CM_LeafArea (leafnum);
-	if ( mask && (!(mask[cluster>>3] & (1<<(cluster&7)) ) ) )
+	mask = CM_ClusterPVS (cluster1);
+	if ( mask && (!(mask[cluster2>>3] & (1<<(cluster2&7)) ) ) )
 		return qfalse;
 	if (!CM_AreasConnected (area1, area2))
 		return qfalse;		// a door blocks sight
@@ -178,18 +239,15 @@ Does NOT check portalareas
 */
 static qboolean SV_inPVSIgnorePortals( const vec3_t p1, const vec3_t p2 )
 {
-	int		leafnum;
-	int		cluster;
+	int		cluster1, cluster2;
+	int		area1, area2;
 	byte	*mask;
 
-	leafnum = CM_PointLeafnum (p1);
-	cluster = CM_LeafCluster (leafnum);
-	mask = CM_ClusterPVS (cluster);
-
-	leafnum = CM_PointLeafnum (p2);
-	cluster = CM_LeafCluster (leafnum);
+	SV_PointCluster( p1, &cluster1, &area1 );
+	SV_PointCluster( p2, &cluster2, &area2 );
 
-	if ( mask && (!(mask[cluster>>3] & (1<<(cluster&7)) ) ) )
+	mask = CM_ClusterPVS (cluster1);
+	if ( mask && (!(mask[cluster2>>3] & (1<<(cluster2&7)) ) ) )
 		return qfalse;
 
 	return qtrue;
@@ -959,6 +1017,68 @@ static intptr_t SV_GameSystemCalls( intptr_t *args ) {
 }
 
 
+/*
+====================
+SV_Fast*
+
+Hot system calls which compiled QVM calls directly, bypassing
+SV_GameSystemCalls() and argument widening, must behave the same
+====================
+*/
+static intptr_t SV_FastTrace( int32_t *args ) {
+	SV_Trace( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qfalse );
+	return 0;
+}
+
+static intptr_t SV_FastTraceCapsule( int32_t *args ) {
+	SV_Trace( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qtrue );
+	return 0;
+}
+
+static intptr_t SV_FastPointContents( int32_t *args ) {
+	return SV_PointContents( VMA(1), args[2] );
+}
+
+static intptr_t SV_FastLinkEntity( int32_t *args ) {
+	SV_LinkEntity( VMA(1) );
+	return 0;
+}
+
+static intptr_t SV_FastUnlinkEntity( int32_t *args ) {
+	SV_UnlinkEntity( VMA(1) );
+	return 0;
+}
+
+static intptr_t SV_FastEntitiesInBox( int32_t *args ) {
+	VM_CHECKBOUNDS( gvm, args[3], args[4] * sizeof( int ) );
+	return SV_AreaEntities( VMA(1), VMA(2), VMA(3), args[4] );
+}
+
+static intptr_t SV_FastEntityContact( int32_t *args ) {
+	return SV_EntityContact( VMA(1), VMA(2), VMA(3), /*int capsule*/ qfalse );
+}
+
+static intptr_t SV_FastInPVS( int32_t *args ) {
+	return SV_inPVS( VMA(1), VMA(2) );
+}
+
+static intptr_t SV_FastMilliseconds( int32_t *args ) {
+	return Sys_Milliseconds();
+}
+
+static const vmFastSyscallDef_t sv_fastSyscalls[] = {
+	{ G_MILLISECONDS,		SV_FastMilliseconds },
+	{ G_LINKENTITY,			SV_FastLinkEntity },
+	{ G_UNLINKENTITY,		SV_FastUnlinkEntity },
+	{ G_ENTITIES_IN_BOX,	SV_FastEntitiesInBox },
+	{ G_ENTITY_CONTACT,		SV_FastEntityContact },
+	{ G_TRACE,				SV_FastTrace },
+	{ G_TRACECAPSULE,		SV_FastTraceCapsule },
+	{ G_POINT_CONTENTS,		SV_FastPointContents },
+	{ G_IN_PVS,				SV_FastInPVS }
+};
+
+
 /*
 ====================
 SV_DllSyscall
@@ -1074,6 +1194,8 @@ void SV_InitGameProgs( void ) {
 		bot_enable = 0;
 	}
 
+	VM_SetFastSyscalls( VM_GAME, sv_fastSyscalls, ARRAY_LEN( sv_fastSyscalls ) );
+
 	// load the dll or bytecode
 	gvm = VM_Create( VM_GAME, SV_GameSystemCalls, SV_DllSyscall, Cvar_VariableIntegerValue( "vm_game" ) );
 	if ( !gvm ) {
@@ -0,0 +1,1030 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_http.c -- minimal HTTP/1.1 server for pk3 downloads
+
+#include "server.h"
+
+#ifdef _WIN32
+#	include <winsock2.h>
+#	include <io.h>
+#	include <fcntl.h>
+typedef int socklen_t;
+#	define socketError		WSAGetLastError()
+#	define HTTP_WOULDBLOCK	WSAEWOULDBLOCK
+#	define HTTP_SEND_FLAGS	0
+#	define HTTP_Open(p)		_open( (p), _O_RDONLY | _O_BINARY )
+#	define HTTP_Close		_close
+#	define HTTP_Read		_read
+#	define HTTP_Seek		_lseek
+#else
+#	include <sys/types.h>
+#	include <sys/socket.h>
+#	include <sys/select.h>
+#	include <netinet/in.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <signal.h>
+#	include <pthread.h>
+#	ifdef __linux__
+#		include <sys/sendfile.h>
+#		define USE_SENDFILE
+#	endif
+typedef int SOCKET;
+#	define INVALID_SOCKET	-1
+#	define closesocket		close
+#	define socketError		errno
+#	define HTTP_WOULDBLOCK	EWOULDBLOCK
+#	ifdef MSG_NOSIGNAL
+#		define HTTP_SEND_FLAGS	MSG_NOSIGNAL
+#	else
+#		define HTTP_SEND_FLAGS	0
+#	endif
+#	define HTTP_Open(p)		open( (p), O_RDONLY )
+#	define HTTP_Close		close
+#	define HTTP_Read		read
+#	define HTTP_Seek		lseek
+#endif
+
+#define HTTP_MAX_CONNECTIONS	32
+#define HTTP_MAX_REQUEST		2048
+#define HTTP_BLOCK_SIZE			65536
+#define HTTP_REQUEST_TIMEOUT	10000	// msec to receive the request header
+#define HTTP_SEND_TIMEOUT		30000	// msec without any progress while sending
+
+typedef enum {
+	HTTP_FREE,
+	HTTP_RECV_REQUEST,
+	HTTP_SEND_HEADER,
+	HTTP_SEND_BODY
+} httpState_t;
+
+typedef struct {
+	char			name[MAX_QPATH];	// as requested by clients: "gamedir/name.pk3"
+	char			ospath[MAX_OSPATH];
+	int64_t			size;
+} httpFile_t;
+
+typedef struct {
+	httpState_t		state;
+	SOCKET			sock;
+	uint32_t		ip;
+	int				fd;
+	int64_t			offset;
+	int64_t			remaining;
+	int				lastActive;
+	int				rateTime;
+	int64_t			rateBytes;		// send allowance left for this period
+	int				bufLen;
+	int				bufSent;
+	char			buf[HTTP_MAX_REQUEST];
+} httpConn_t;
+
+/*
+  Connections and the file list belong to the worker thread while it runs,
+  the main thread only changes them after stopping it in SV_HTTPStop()
+*/
+static struct {
+	void			*thread;
+	volatile int	quit;
+
+	SOCKET			listenSock;
+	int				port;
+
+	httpFile_t		*files;
+	int				numFiles;
+
+	int				rate;			// bytes per second per connection, 0 - unlimited
+	int				maxPerIP;
+	int				allowDownload;
+
+	httpConn_t		conns[HTTP_MAX_CONNECTIONS];
+
+	// statistics, written by the worker thread only
+	volatile int	numRequests;
+	volatile int	numRejected;
+	volatile int64_t bytesSent;
+} http;
+
+static cvar_t *sv_httpPort;
+static cvar_t *sv_httpDlPort;		// advertised to clients only while serving
+static cvar_t *sv_httpRate;
+static cvar_t *sv_httpMaxConnsPerIP;
+
+static const char *sv_httpReasons[] = { "200 OK", "206 Partial Content", "400 Bad Request",
+	"404 Not Found", "405 Method Not Allowed", "416 Range Not Satisfiable", "503 Service Unavailable" };
+
+enum {
+	HTTP_200, HTTP_206, HTTP_400, HTTP_404, HTTP_405, HTTP_416, HTTP_503
+};
+
+
+/*
+=================
+SV_HTTPSetNonBlocking
+=================
+*/
+static qboolean SV_HTTPSetNonBlocking( SOCKET sock ) {
+#ifdef _WIN32
+	u_long arg = 1;
+	return ioctlsocket( sock, FIONBIO, &arg ) == 0 ? qtrue : qfalse;
+#else
+	int flags = fcntl( sock, F_GETFL, 0 );
+	if ( flags == -1 ) {
+		return qfalse;
+	}
+	return fcntl( sock, F_SETFL, flags | O_NONBLOCK ) == 0 ? qtrue : qfalse;
+#endif
+}
+
+
+/*
+=================
+SV_HTTPCloseConn
+=================
+*/
+static void SV_HTTPCloseConn( httpConn_t *c ) {
+	if ( c->fd != -1 ) {
+		HTTP_Close( c->fd );
+	}
+	closesocket( c->sock );
+	Com_Memset( c, 0, sizeof( *c ) );
+	c->sock = INVALID_SOCKET;
+	c->fd = -1;
+	c->state = HTTP_FREE;
+}
+
+
+/*
+=================
+SV_HTTPSetResponse
+
+Puts a response header into the connection buffer
+=================
+*/
+static void SV_HTTPSetResponse( httpConn_t *c, int status, const httpFile_t *file, int64_t start, int64_t length ) {
+	char *s = c->buf;
+	int size = sizeof( c->buf );
+	int n;
+
+	n = Com_sprintf( s, size, "HTTP/1.1 %s\r\nServer: " APP_VERSION "\r\nConnection: close\r\n", sv_httpReasons[ status ] );
+
+	if ( status == HTTP_200 || status == HTTP_206 ) {
+		n += Com_sprintf( s + n, size - n, "Content-Type: application/zip\r\nAccept-Ranges: bytes\r\n"
+			"Content-Length: %lld\r\n", (long long)length );
+		if ( status == HTTP_206 ) {
+			n += Com_sprintf( s + n, size - n, "Content-Range: bytes %lld-%lld/%lld\r\n",
+				(long long)start, (long long)( start + length - 1 ), (long long)file->size );
+		}
+	} else {
+		if ( status == HTTP_416 ) {
+			n += Com_sprintf( s + n, size - n, "Content-Range: bytes */%lld\r\n", (long long)file->size );
+		} else if ( status == HTTP_405 ) {
+			n += Com_sprintf( s + n, size - n, "Allow: GET, HEAD\r\n" );
+		}
+		n += Com_sprintf( s + n, size - n, "Content-Length: 0\r\n" );
+	}
+
+	n += Com_sprintf( s + n, size - n, "\r\n" );
+
+	c->bufLen = n;
+	c->bufSent = 0;
+	c->state = HTTP_SEND_HEADER;
+}
+
+
+/*
+=================
+SV_HTTPFindFile
+=================
+*/
+static const httpFile_t *SV_HTTPFindFile( const char *name ) {
+	int i;
+
+	for ( i = 0; i < http.numFiles; i++ ) {
+		if ( !FS_FilenameCompare( http.files[i].name, name ) ) {
+			return &http.files[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+=================
+SV_HTTPHexValue
+=================
+*/
+static int SV_HTTPHexValue( char c ) {
+	if ( c >= '0' && c <= '9' ) {
+		return c - '0';
+	}
+	if ( c >= 'a' && c <= 'f' ) {
+		return c - 'a' + 10;
+	}
+	if ( c >= 'A' && c <= 'F' ) {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+
+/*
+=================
+SV_HTTPDecodePath
+
+Strips leading slashes and the query string, decodes %XX escapes
+=================
+*/
+static qboolean SV_HTTPDecodePath( const char *in, char *out, int size ) {
+	int n, hi, lo;
+
+	while ( *in == '/' ) {
+		in++;
+	}
+
+	for ( n = 0; *in && *in != '?' && *in != '#'; in++ ) {
+		if ( n >= size - 1 ) {
+			return qfalse;
+		}
+		if ( *in == '%' ) {
+			hi = SV_HTTPHexValue( in[1] );
+			lo = hi >= 0 ? SV_HTTPHexValue( in[2] ) : -1;
+			if ( lo < 0 || ( hi == 0 && lo == 0 ) ) {
+				return qfalse;
+			}
+			out[n++] = (char)( hi * 16 + lo );
+			in += 2;
+		} else {
+			out[n++] = *in;
+		}
+	}
+
+	out[n] = '\0';
+	return qtrue;
+}
+
+
+/*
+=================
+SV_HTTPParseRange
+
+Parses a single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range.
+Returns -1 if the header should be ignored, 0 if the range can't be satisfied
+=================
+*/
+static int SV_HTTPParseRange( const char *s, int64_t size, int64_t *start, int64_t *length ) {
+	int64_t first, last;
+	char *end;
+
+	while ( *s == ' ' ) {
+		s++;
+	}
+
+	if ( Q_stricmpn( s, "bytes=", 6 ) ) {
+		return -1;
+	}
+	s += 6;
+
+	// multiple ranges are not supported, serve the whole file instead
+	if ( strchr( s, ',' ) ) {
+		return -1;
+	}
+
+	if ( *s == '-' ) {
+		last = strtoll( s + 1, &end, 10 );
+		if ( end == s + 1 || last < 0 ) {
+			return -1;
+		}
+		if ( last == 0 || size == 0 ) {
+			return 0;
+		}
+		if ( last > size ) {
+			last = size;
+		}
+		*start = size - last;
+		*length = last;
+		return 1;
+	}
+
+	first = strtoll( s, &end, 10 );
+	if ( end == s || *end != '-' || first < 0 ) {
+		return -1;
+	}
+	s = end + 1;
+
+	if ( *s >= '0' && *s <= '9' ) {
+		last = strtoll( s, &end, 10 );
+		if ( last < first ) {
+			return -1;
+		}
+		if ( last >= size ) {
+			last = size - 1;
+		}
+	} else {
+		last = size - 1;
+	}
+
+	if ( first >= size ) {
+		return 0;
+	}
+
+	*start = first;
+	*length = last - first + 1;
+	return 1;
+}
+
+
+/*
+=================
+SV_HTTPHandleRequest
+
+Called once the whole request header is received
+=================
+*/
+static void SV_HTTPHandleRequest( httpConn_t *c ) {
+	char path[MAX_QPATH];
+	char *line, *next, *method, *target, *version, *range;
+	const httpFile_t *file;
+	int64_t start, length;
+	qboolean head;
+	int r;
+
+	http.numRequests++;
+
+	// request line
+	line = c->buf;
+	next = strstr( line, "\r\n" );
+	*next = '\0';
+	next += 2;
+
+	method = line;
+	target = strchr( method, ' ' );
+	if ( !target ) {
+		SV_HTTPSetResponse( c, HTTP_400, NULL, 0, 0 );
+		return;
+	}
+	*target++ = '\0';
+	version = strchr( target, ' ' );
+	if ( !version || Q_stricmpn( version + 1, "HTTP/1.", 7 ) ) {
+		SV_HTTPSetResponse( c, HTTP_400, NULL, 0, 0 );
+		return;
+	}
+	*version = '\0';
+
+	if ( !strcmp( method, "GET" ) ) {
+		head = qfalse;
+	} else if ( !strcmp( method, "HEAD" ) ) {
+		head = qtrue;
+	} else {
+		SV_HTTPSetResponse( c, HTTP_405, NULL, 0, 0 );
+		return;
+	}
+
+	if ( !SV_HTTPDecodePath( target, path, sizeof( path ) ) || ( file = SV_HTTPFindFile( path ) ) == NULL ) {
+		SV_HTTPSetResponse( c, HTTP_404, NULL, 0, 0 );
+		return;
+	}
+
+	// header fields, only Range is of interest
+	range = NULL;
+	for ( line = next; ( next = strstr( line, "\r\n" ) ) != NULL && next != line; line = next + 2 ) {
+		*next = '\0';
+		if ( !Q_stricmpn( line, "Range:", 6 ) ) {
+			range = line + 6;
+		}
+	}
+
+	start = 0;
+	length = file->size;
+	r = range ? SV_HTTPParseRange( range, file->size, &start, &length ) : -1;
+	if ( r == 0 ) {
+		SV_HTTPSetResponse( c, HTTP_416, file, 0, 0 );
+		return;
+	}
+
+	if ( !head ) {
+		c->fd = HTTP_Open( file->ospath );
+		if ( c->fd == -1 ) {
+			SV_HTTPSetResponse( c, HTTP_404, NULL, 0, 0 );
+			return;
+		}
+		c->offset = start;
+		c->remaining = length;
+	}
+
+	SV_HTTPSetResponse( c, r > 0 ? HTTP_206 : HTTP_200, file, start, length );
+}
+
+
+/*
+=================
+SV_HTTPRecv
+=================
+*/
+static void SV_HTTPRecv( httpConn_t *c, int now ) {
+	int n;
+
+	n = recv( c->sock, c->buf + c->bufLen, sizeof( c->buf ) - 1 - c->bufLen, 0 );
+	if ( n <= 0 ) {
+		if ( n == 0 || socketError != HTTP_WOULDBLOCK ) {
+			SV_HTTPCloseConn( c );
+		}
+		return;
+	}
+
+	c->bufLen += n;
+	c->buf[ c->bufLen ] = '\0';
+	c->lastActive = now;
+
+	if ( strstr( c->buf, "\r\n\r\n" ) ) {
+		SV_HTTPHandleRequest( c );
+	} else if ( c->bufLen >= (int)sizeof( c->buf ) - 1 ) {
+		SV_HTTPSetResponse( c, HTTP_400, NULL, 0, 0 );
+	}
+}
+
+
+/*
+=================
+SV_HTTPAllowance
+
+Returns number of bytes the connection may send now
+=================
+*/
+static int SV_HTTPAllowance( httpConn_t *c, int now ) {
+	int64_t n;
+
+	if ( http.rate <= 0 ) {
+		return HTTP_BLOCK_SIZE;
+	}
+
+	// refill once per 100 msec, allow at most one second of burst
+	if ( now - c->rateTime >= 100 ) {
+		c->rateBytes += (int64_t)http.rate * ( now - c->rateTime ) / 1000;
+		if ( c->rateBytes > http.rate ) {
+			c->rateBytes = http.rate;
+		}
+		c->rateTime = now;
+	}
+
+	n = c->rateBytes;
+	if ( n > HTTP_BLOCK_SIZE ) {
+		n = HTTP_BLOCK_SIZE;
+	}
+
+	return (int)n;
+}
+
+
+/*
+=================
+SV_HTTPSendBody
+=================
+*/
+static void SV_HTTPSendBody( httpConn_t *c, int now ) {
+	int allowance, n;
+#ifndef USE_SENDFILE
+	char block[ HTTP_BLOCK_SIZE ];
+#endif
+
+	allowance = SV_HTTPAllowance( c, now );
+	if ( allowance <= 0 ) {
+		return;
+	}
+	if ( allowance > c->remaining ) {
+		allowance = (int)c->remaining;
+	}
+
+#ifdef USE_SENDFILE
+	{
+		off_t offset = (off_t)c->offset;
+		n = (int)sendfile( c->sock, c->fd, &offset, allowance );
+	}
+#else
+	if ( HTTP_Seek( c->fd, (long)c->offset, SEEK_SET ) == -1 ) {
+		SV_HTTPCloseConn( c );
+		return;
+	}
+	n = HTTP_Read( c->fd, block, allowance );
+	if ( n <= 0 ) {
+		SV_HTTPCloseConn( c );
+		return;
+	}
+	n = send( c->sock, block, n, HTTP_SEND_FLAGS );
+#endif
+
+	if ( n < 0 ) {
+		if ( socketError != HTTP_WOULDBLOCK ) {
+			SV_HTTPCloseConn( c );
+		}
+		return;
+	}
+
+	if ( n == 0 ) {
+		// file got truncated
+		SV_HTTPCloseConn( c );
+		return;
+	}
+
+	c->offset += n;
+	c->remaining -= n;
+	c->rateBytes -= n;
+	c->lastActive = now;
+	http.bytesSent += n;
+
+	if ( c->remaining <= 0 ) {
+		SV_HTTPCloseConn( c );
+	}
+}
+
+
+/*
+=================
+SV_HTTPSend
+=================
+*/
+static void SV_HTTPSend( httpConn_t *c, int now ) {
+	int n;
+
+	if ( c->state == HTTP_SEND_BODY ) {
+		SV_HTTPSendBody( c, now );
+		return;
+	}
+
+	n = send( c->sock, c->buf + c->bufSent, c->bufLen - c->bufSent, HTTP_SEND_FLAGS );
+	if ( n < 0 ) {
+		if ( socketError != HTTP_WOULDBLOCK ) {
+			SV_HTTPCloseConn( c );
+		}
+		return;
+	}
+
+	c->bufSent += n;
+	c->lastActive = now;
+
+	if ( c->bufSent >= c->bufLen ) {
+		if ( c->fd != -1 && c->remaining > 0 ) {
+			c->state = HTTP_SEND_BODY;
+			c->rateTime = now;
+			c->rateBytes = http.rate / 10;
+		} else {
+			SV_HTTPCloseConn( c );
+		}
+	}
+}
+
+
+/*
+=================
+SV_HTTPAccept
+=================
+*/
+static void SV_HTTPAccept( int now ) {
+	struct sockaddr_in addr;
+	socklen_t addrlen;
+	httpConn_t *c, *slot;
+	SOCKET sock;
+	uint32_t ip;
+	int i, count;
+
+	addrlen = sizeof( addr );
+	sock = accept( http.listenSock, (struct sockaddr *)&addr, &addrlen );
+	if ( sock == INVALID_SOCKET ) {
+		return;
+	}
+
+#ifndef _WIN32
+	// descriptors past FD_SETSIZE can't be passed to select()
+	if ( sock >= FD_SETSIZE ) {
+		closesocket( sock );
+		http.numRejected++;
+		return;
+	}
+#endif
+
+	ip = addr.sin_addr.s_addr;
+	slot = NULL;
+	count = 0;
+	for ( i = 0, c = http.conns; i < HTTP_MAX_CONNECTIONS; i++, c++ ) {
+		if ( c->state == HTTP_FREE ) {
+			if ( !slot ) {
+				slot = c;
+			}
+		} else if ( c->ip == ip ) {
+			count++;
+		}
+	}
+
+	if ( !slot || count >= http.maxPerIP || !SV_HTTPSetNonBlocking( sock ) ) {
+		static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+		send( sock, busy, sizeof( busy ) - 1, HTTP_SEND_FLAGS );
+		closesocket( sock );
+		http.numRejected++;
+		return;
+	}
+
+	slot->state = HTTP_RECV_REQUEST;
+	slot->sock = sock;
+	slot->ip = ip;
+	slot->fd = -1;
+	slot->bufLen = 0;
+	slot->lastActive = now;
+}
+
+
+/*
+=================
+SV_HTTPThread
+=================
+*/
+static void SV_HTTPThread( void *arg ) {
+	fd_set readSet, writeSet;
+	struct timeval tv;
+	httpConn_t *c;
+	SOCKET maxSock;
+	qboolean haveFree;
+	int i, now, timeout;
+#ifndef _WIN32
+	sigset_t mask;
+
+	// a client closing the connection should not kill the whole server
+	sigemptyset( &mask );
+	sigaddset( &mask, SIGPIPE );
+	pthread_sigmask( SIG_BLOCK, &mask, NULL );
+#endif
+
+	while ( !http.quit ) {
+		FD_ZERO( &readSet );
+		FD_ZERO( &writeSet );
+		maxSock = http.listenSock;
+		haveFree = qfalse;
+		now = Sys_Milliseconds();
+
+		for ( i = 0, c = http.conns; i < HTTP_MAX_CONNECTIONS; i++, c++ ) {
+			if ( c->state == HTTP_FREE ) {
+				haveFree = qtrue;
+				continue;
+			}
+			if ( c->state == HTTP_RECV_REQUEST ) {
+				FD_SET( c->sock, &readSet );
+			} else if ( c->state == HTTP_SEND_HEADER || SV_HTTPAllowance( c, now ) > 0 ) {
+				FD_SET( c->sock, &writeSet );
+			}
+			if ( c->sock > maxSock ) {
+				maxSock = c->sock;
+			}
+		}
+
+		if ( haveFree ) {
+			FD_SET( http.listenSock, &readSet );
+		}
+
+		// short timeout to notice the quit request and refill rate limits
+		tv.tv_sec = 0;
+		tv.tv_usec = 50000;
+		if ( select( (int)maxSock + 1, &readSet, &writeSet, NULL, &tv ) < 0 ) {
+			continue;
+		}
+
+		now = Sys_Milliseconds();
+
+		for ( i = 0, c = http.conns; i < HTTP_MAX_CONNECTIONS; i++, c++ ) {
+			if ( c->state == HTTP_FREE ) {
+				continue;
+			}
+			if ( FD_ISSET( c->sock, &readSet ) ) {
+				SV_HTTPRecv( c, now );
+			} else if ( FD_ISSET( c->sock, &writeSet ) ) {
+				SV_HTTPSend( c, now );
+			}
+			if ( c->state != HTTP_FREE ) {
+				timeout = ( c->state == HTTP_RECV_REQUEST ) ? HTTP_REQUEST_TIMEOUT : HTTP_SEND_TIMEOUT;
+				if ( now - c->lastActive > timeout ) {
+					SV_HTTPCloseConn( c );
+				}
+			}
+		}
+
+		if ( FD_ISSET( http.listenSock, &readSet ) ) {
+			SV_HTTPAccept( now );
+		}
+	}
+}
+
+
+/*
+=================
+SV_HTTPStop
+
+Waits for the worker thread to exit, connections stay open
+=================
+*/
+static void SV_HTTPStop( void ) {
+	if ( http.thread ) {
+		http.quit = 1;
+		Sys_JoinThread( http.thread );
+		http.thread = NULL;
+		http.quit = 0;
+	}
+}
+
+
+/*
+=================
+SV_HTTPCloseAll
+=================
+*/
+static void SV_HTTPCloseAll( void ) {
+	int i;
+
+	for ( i = 0; i < HTTP_MAX_CONNECTIONS; i++ ) {
+		if ( http.conns[i].state != HTTP_FREE ) {
+			SV_HTTPCloseConn( &http.conns[i] );
+		}
+	}
+
+	if ( http.listenSock != INVALID_SOCKET ) {
+		closesocket( http.listenSock );
+		http.listenSock = INVALID_SOCKET;
+	}
+
+	http.port = 0;
+}
+
+
+/*
+=================
+SV_HTTPListen
+=================
+*/
+static qboolean SV_HTTPListen( int port ) {
+	struct sockaddr_in addr;
+	netadr_t adr;
+	SOCKET sock;
+	int opt;
+
+	// bind to the same address as the game socket
+	Com_Memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( (unsigned short)port );
+	if ( NET_StringToAdr( Cvar_VariableString( "net_ip" ), &adr, NA_IP ) && adr.type == NA_IP ) {
+		Com_Memcpy( &addr.sin_addr, adr.ipv._4, 4 );
+	}
+
+	sock = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( sock == INVALID_SOCKET ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: SV_HTTPListen: socket: %i\n", socketError );
+		return qfalse;
+	}
+
+	opt = 1;
+	setsockopt( sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&opt, sizeof( opt ) );
+
+#ifndef _WIN32
+	if ( sock >= FD_SETSIZE ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: SV_HTTPListen: socket %i is out of select() range\n", (int)sock );
+		closesocket( sock );
+		return qfalse;
+	}
+#endif
+
+	if ( bind( sock, (struct sockaddr *)&addr, sizeof( addr ) ) != 0 || listen( sock, 16 ) != 0 || !SV_HTTPSetNonBlocking( sock ) ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: SV_HTTPListen: unable to listen on TCP port %i: %i\n", port, socketError );
+		closesocket( sock );
+		return qfalse;
+	}
+
+	http.listenSock = sock;
+	http.port = port;
+
+	Com_Printf( "HTTP download server listening on TCP port %i\n", port );
+
+	return qtrue;
+}
+
+
+/*
+=================
+SV_HTTPBuildFileList
+
+Collects referenced non-id pk3 files that clients are allowed to download
+=================
+*/
+static void SV_HTTPBuildFileList( void ) {
+	char name[MAX_QPATH];
+	const char *ospath;
+	fileOffset_t size;
+	fileTime_t mtime, ctime;
+	int i, count;
+
+	if ( http.files ) {
+		Z_Free( http.files );
+		http.files = NULL;
+	}
+	http.numFiles = 0;
+
+	if ( !( http.allowDownload & DLF_ENABLE ) || ( http.allowDownload & DLF_NO_REDIRECT ) ) {
+		return;
+	}
+
+	Cmd_TokenizeStringIgnoreQuotes( sv_referencedPakNames->string );
+	count = Cmd_Argc();
+	if ( !count ) {
+		return;
+	}
+
+	http.files = Z_Malloc( count * sizeof( httpFile_t ) );
+
+	for ( i = 0; i < count; i++ ) {
+		if ( FS_idPak( Cmd_Argv( i ), BASEGAME, NUM_ID_PAKS ) || FS_idPak( Cmd_Argv( i ), BASETA, NUM_TA_PAKS ) ) {
+			continue;
+		}
+		Com_sprintf( name, sizeof( name ), "%s.pk3", Cmd_Argv( i ) );
+		ospath = FS_SV_FileOSPath( name );
+		if ( !ospath || !Sys_GetFileStats( ospath, &size, &mtime, &ctime ) ) {
+			continue;
+		}
+		Q_strncpyz( http.files[ http.numFiles ].name, name, sizeof( http.files[0].name ) );
+		Q_strncpyz( http.files[ http.numFiles ].ospath, ospath, sizeof( http.files[0].ospath ) );
+		http.files[ http.numFiles ].size = size;
+		http.numFiles++;
+	}
+}
+
+
+/*
+=================
+SV_HTTPUpdate
+
+(Re)starts the server with current settings and referenced paks,
+called on each level spawn and when related cvars change
+=================
+*/
+void SV_HTTPUpdate( void ) {
+	int port;
+
+	if ( !sv_httpPort ) {
+		return;
+	}
+
+	sv_httpPort->modified = qfalse;
+
+	SV_HTTPStop();
+
+	port = sv_httpPort->integer;
+	if ( port != http.port ) {
+		SV_HTTPCloseAll();
+		if ( port != 0 ) {
+			SV_HTTPListen( port );
+		}
+	}
+
+	// disabled or unable to listen, don't start the thread on an invalid socket
+	if ( port == 0 || http.listenSock == INVALID_SOCKET ) {
+		SV_HTTPShutdown();
+		return;
+	}
+
+	http.rate = sv_httpRate->integer * 1024;
+	http.maxPerIP = sv_httpMaxConnsPerIP->integer;
+	http.allowDownload = sv_allowDownload->integer;
+
+	SV_HTTPBuildFileList();
+
+	http.thread = Sys_StartThread( SV_HTTPThread, NULL );
+	if ( !http.thread ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: unable to start HTTP download thread\n" );
+		SV_HTTPShutdown();
+		return;
+	}
+
+	// clients drop on http errors instead of falling back to udp,
+	// so point them here only when there is something to download
+	Cvar_Set( sv_httpDlPort->name, http.numFiles ? va( "%i", http.port ) : "0" );
+}
+
+
+/*
+=================
+SV_HTTPFrame
+
+Restarts the server on settings change
+=================
+*/
+void SV_HTTPFrame( void ) {
+	if ( !sv_httpPort ) {
+		return;
+	}
+
+	if ( sv_httpPort->modified ||
+		( http.thread && ( sv_httpRate->integer * 1024 != http.rate ||
+		sv_httpMaxConnsPerIP->integer != http.maxPerIP ||
+		sv_allowDownload->integer != http.allowDownload ) ) ) {
+		SV_HTTPUpdate();
+	}
+}
+
+
+/*
+=================
+SV_HTTPShutdown
+=================
+*/
+void SV_HTTPShutdown( void ) {
+	SV_HTTPStop();
+	SV_HTTPCloseAll();
+
+	if ( sv_httpDlPort && sv_httpDlPort->integer ) {
+		Cvar_Set( sv_httpDlPort->name, "0" );
+	}
+
+	if ( http.files ) {
+		Z_Free( http.files );
+		http.files = NULL;
+	}
+	http.numFiles = 0;
+}
+
+
+/*
+=================
+SV_HTTPStatus_f
+=================
+*/
+static void SV_HTTPStatus_f( void ) {
+	int i, active;
+
+	if ( !http.thread ) {
+		Com_Printf( "HTTP download server is not running\n" );
+		return;
+	}
+
+	active = 0;
+	for ( i = 0; i < HTTP_MAX_CONNECTIONS; i++ ) {
+		if ( http.conns[i].state != HTTP_FREE ) {
+			active++;
+		}
+	}
+
+	Com_Printf( "HTTP download server on TCP port %i, %i file(s) available\n", http.port, http.numFiles );
+	for ( i = 0; i < http.numFiles; i++ ) {
+		Com_Printf( "  %s (%lld bytes)\n", http.files[i].name, (long long)http.files[i].size );
+	}
+	Com_Printf( "%i active connection(s), %i request(s), %i rejected, %lld bytes sent\n",
+		active, http.numRequests, http.numRejected, (long long)http.bytesSent );
+}
+
+
+/*
+=================
+SV_HTTPInit
+=================
+*/
+void SV_HTTPInit( void ) {
+	int i;
+
+	http.listenSock = INVALID_SOCKET;
+	for ( i = 0; i < HTTP_MAX_CONNECTIONS; i++ ) {
+		http.conns[i].sock = INVALID_SOCKET;
+		http.conns[i].fd = -1;
+	}
+
+	sv_httpPort = Cvar_Get( "sv_httpPort", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_httpPort, "0", "65535", CV_INTEGER );
+	Cvar_SetDescription( sv_httpPort, "TCP port of the built-in HTTP download server, 0 disables it.\n"
+		"Clients use it for pk3 downloads when sv_dlURL is not set." );
+
+	sv_httpDlPort = Cvar_Get( "sv_httpDlPort", "0", CVAR_SERVERINFO | CVAR_ROM );
+	Cvar_SetDescription( sv_httpDlPort, "TCP port of the built-in HTTP download server as advertised to clients, 0 while it is not serving files." );
+
+	sv_httpRate = Cvar_Get( "sv_httpRate", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_httpRate, "0", NULL, CV_INTEGER );
+	Cvar_SetDescription( sv_httpRate, "Maximum HTTP download speed per connection in KB/s, 0 means unlimited." );
+
+	sv_httpMaxConnsPerIP = Cvar_Get( "sv_httpMaxConnsPerIP", "2", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_httpMaxConnsPerIP, "1", XSTRING(HTTP_MAX_CONNECTIONS), CV_INTEGER );
+	Cvar_SetDescription( sv_httpMaxConnsPerIP, "Limits number of simultaneous HTTP download connections from the same IP address." );
+
+	Cmd_AddCommand( "httpstatus", SV_HTTPStatus_f );
+}
@@ -383,6 +383,30 @@ static void SV_ClearServer( void ) {
 }
 
 
+/*
+================
+SV_PrefetchLevel
+
+Queues the map and the game module for background reading
+================
+*/
+static int SV_PrefetchLevel( const char *mapname ) {
+	const char *list[2];
+	char bsp[ MAX_QPATH ];
+	int n;
+
+	Com_sprintf( bsp, sizeof( bsp ), "maps/%s.bsp", mapname );
+	list[0] = bsp;
+	n = 1;
+
+	if ( Cvar_VariableIntegerValue( "vm_game" ) != VMI_NATIVE ) {
+		list[ n++ ] = "vm/qagame.qvm";
+	}
+
+	return FS_ReadFilesAsync( list, n, NULL, NULL );
+}
+
+
 /*
 ================
 SV_SpawnServer
@@ -397,6 +421,7 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	int			checksum;
 	qboolean	isBot;
 	const char	*p;
+	int			prefetch;
 
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
@@ -501,6 +526,9 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	Com_RandomBytes( (byte*)&sv.checksumFeed, sizeof( sv.checksumFeed ) );
 	FS_Restart( sv.checksumFeed );
 
+	// read the game module while the map is loaded
+	prefetch = SV_PrefetchLevel( mapname );
+
 	Sys_SetStatus( "Loading map %s", mapname );
 	CM_LoadMap( va( "maps/%s.bsp", mapname ), qfalse, &checksum );
 
@@ -517,6 +545,7 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 
 	// clear physics interaction links
 	SV_ClearWorld();
+	SV_ClearPVSCache();
 
 	// media configstring setting should be done during
 	// the loading stage, so connected clients don't have
@@ -529,6 +558,8 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	// load and spawn all other entities
 	SV_InitGameProgs();
 
+	FS_AsyncFinish( prefetch );
+
 	// don't allow a map_restart if game is modified
 	sv_gametype->modified = qfalse;
 
@@ -616,6 +647,9 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	}
 	Cvar_Set( "sv_referencedPakNames", p );
 
+	// serve the new set of paks over HTTP
+	SV_HTTPUpdate();
+
 	p = FS_ReferencedPakChecksums();
 	Cvar_Set( "sv_referencedPaks", p );
 
@@ -742,6 +776,7 @@ void SV_Init( void )
 
 	sv_allowDownload = Cvar_Get ("sv_allowDownload", "1", CVAR_SERVERINFO);
 	Cvar_Get ("sv_dlURL", "", CVAR_SERVERINFO | CVAR_ARCHIVE);
+	SV_HTTPInit();
 
 	// moved to Com_Init()
 	//sv_master[0] = Cvar_Get( "sv_master1", MASTER_SERVER_NAME, CVAR_INIT | CVAR_ARCHIVE_ND );
@@ -849,6 +884,7 @@ void SV_Shutdown( const char *finalmsg ) {
 
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
+	SV_HTTPShutdown();
 	SV_ShutdownGameProgs();
 	SV_InitChallenger();
 
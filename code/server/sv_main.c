@@ -1308,6 +1308,8 @@ void SV_Frame( int msec ) {
 		return;
 	}
 
+	SV_HTTPFrame();
+
 	// allow pause if only the local client is connected
 	if ( SV_CheckPaused() ) {
 		return;
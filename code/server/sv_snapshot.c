@@ -305,6 +305,56 @@ static void SV_AddIndexToSnapshot( svEntity_t *svEnt, int index, snapshotEntityN
 }
 
 
+/*
+===============
+SV_PVSWord
+===============
+*/
+static ID_INLINE uint64_t SV_PVSWord( const byte *pvs, int word ) {
+	uint64_t w;
+	memcpy( &w, pvs + word * sizeof( w ), sizeof( w ) );
+	return w;
+}
+
+
+/*
+===============
+SV_EntityClustersVisible
+
+Tests entity clusters against PVS bit vector a 64-bit word at a time
+===============
+*/
+static qboolean SV_EntityClustersVisible( const svEntity_t *svEnt, const byte *pvs ) {
+	int i, first, last;
+
+	if ( svEnt->numClusterWords >= 0 ) {
+		for ( i = 0; i < svEnt->numClusterWords; i++ ) {
+			if ( SV_PVSWord( pvs, svEnt->clusterWords[i] ) & svEnt->clusterMasks[i] ) {
+				return qtrue;
+			}
+		}
+		return qfalse;
+	}
+
+	// cluster run
+	first = svEnt->clusterWords[0];
+	last = svEnt->clusterWords[1];
+	if ( SV_PVSWord( pvs, first ) & svEnt->clusterMasks[0] ) {
+		return qtrue;
+	}
+	for ( i = first + 1; i < last; i++ ) {
+		if ( SV_PVSWord( pvs, i ) ) {
+			return qtrue;
+		}
+	}
+	if ( last > first && SV_PVSWord( pvs, last ) & svEnt->clusterMasks[1] ) {
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -312,15 +362,13 @@ SV_AddEntitiesVisibleFromPoint
 */
 static void SV_AddEntitiesVisibleFromPoint( const vec3_t origin, clientSnapshot_t *frame,
 									snapshotEntityNumbers_t *eNums, qboolean portal ) {
-	int		e, i;
+	int		e;
 	sharedEntity_t *ent;
 	svEntity_t	*svEnt;
 	entityState_t  *es;
-	int		l;
 	int		clientarea, clientcluster;
 	int		leafnum;
 	byte	*clientpvs;
-	byte	*bitvector;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -385,36 +433,10 @@ static void SV_AddEntitiesVisibleFromPoint( const vec3_t origin, clientSnapshot_
 			}
 		}
 
-		bitvector = clientpvs;
-
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
+		// check touched clusters
+		if ( !SV_EntityClustersVisible( svEnt, clientpvs ) ) {
 			continue;
 		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
-			}
-		}
-
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
-					}
-				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
-				}
-			} else {
-				continue;
-			}
-		}
 
 		// add it
 		SV_AddIndexToSnapshot( svEnt, e, eNums );
@@ -195,6 +195,78 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 }
 
 
+/*
+===============
+SV_ClusterMask
+
+Returns mask of clusters from first to last within a 64-bit word of the cluster
+bit vector, built byte by byte so it matches words loaded from CM_ClusterPVS()
+data regardless of byte order
+===============
+*/
+static uint64_t SV_ClusterMask( int first, int last ) {
+	uint64_t	mask;
+	byte		*b;
+	int			i;
+
+	mask = 0;
+	b = (byte *)&mask;
+	for ( i = first; i <= last; i++ ) {
+		b[ ( i >> 3 ) & 7 ] |= 1 << ( i & 7 );
+	}
+
+	return mask;
+}
+
+
+/*
+===============
+SV_AddClusterWord
+
+Returns qfalse if entity touches too many words
+===============
+*/
+static qboolean SV_AddClusterWord( svEntity_t *ent, int cluster ) {
+	int word, i;
+
+	word = cluster >> 6;
+	for ( i = 0; i < ent->numClusterWords; i++ ) {
+		if ( ent->clusterWords[i] == word ) {
+			ent->clusterMasks[i] |= SV_ClusterMask( cluster, cluster );
+			return qtrue;
+		}
+	}
+
+	if ( ent->numClusterWords == MAX_ENT_CLUSTER_WORDS ) {
+		return qfalse;
+	}
+
+	ent->clusterWords[i] = word;
+	ent->clusterMasks[i] = SV_ClusterMask( cluster, cluster );
+	ent->numClusterWords++;
+
+	return qtrue;
+}
+
+
+/*
+===============
+SV_SetClusterRun
+===============
+*/
+static void SV_SetClusterRun( svEntity_t *ent, int first, int last ) {
+	ent->numClusterWords = -1;
+	ent->clusterWords[0] = first >> 6;
+	ent->clusterWords[1] = last >> 6;
+	if ( ent->clusterWords[0] == ent->clusterWords[1] ) {
+		ent->clusterMasks[0] = ent->clusterMasks[1] = SV_ClusterMask( first, last );
+	} else {
+		ent->clusterMasks[0] = SV_ClusterMask( first, first | 63 );
+		ent->clusterMasks[1] = SV_ClusterMask( last & ~63, last );
+	}
+}
+
+
 /*
 ===============
 SV_LinkEntity
@@ -205,7 +277,8 @@ SV_LinkEntity
 void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	worldSector_t	*node;
 	int			leafs[MAX_TOTAL_ENT_LEAFS];
-	int			cluster;
+	int			cluster, firstCluster, lastCluster;
+	qboolean	overflowed;
 	int			num_leafs;
 	int			i, j, k;
 	int			area;
@@ -279,8 +352,7 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	gEnt->r.absmax[2] += 1;
 
 	// link to PVS leafs
-	ent->numClusters = 0;
-	ent->lastCluster = 0;
+	ent->numClusterWords = 0;
 	ent->areanum = -1;
 	ent->areanum2 = -1;
 
@@ -313,21 +385,41 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 		}
 	}
 
-	// store as many explicit clusters as we can
-	ent->numClusters = 0;
-	for (i=0 ; i < num_leafs ; i++) {
+	// store clusters as words of the cluster bit vector
+	firstCluster = MAX_QINT;
+	lastCluster = -1;
+	overflowed = ( num_leafs == MAX_TOTAL_ENT_LEAFS );
+	for ( i = 0; i < num_leafs; i++ ) {
 		cluster = CM_LeafCluster( leafs[i] );
-		if ( cluster != -1 ) {
-			ent->clusternums[ent->numClusters++] = cluster;
-			if ( ent->numClusters == MAX_ENT_CLUSTERS ) {
-				break;
-			}
+		if ( cluster == -1 ) {
+			continue;
+		}
+		if ( cluster < firstCluster ) {
+			firstCluster = cluster;
+		}
+		if ( cluster > lastCluster ) {
+			lastCluster = cluster;
+		}
+		if ( !overflowed && !SV_AddClusterWord( ent, cluster ) ) {
+			overflowed = qtrue;
 		}
 	}
 
-	// store off a last cluster if we need to
-	if ( i != num_leafs ) {
-		ent->lastCluster = CM_LeafCluster( lastLeaf );
+	// fall back to a run covering all clusters, including the last
+	// one reported by CM_BoxLeafnums if the leaf list has been overflowed
+	if ( overflowed ) {
+		cluster = CM_LeafCluster( lastLeaf );
+		if ( cluster != -1 ) {
+			if ( cluster < firstCluster ) {
+				firstCluster = cluster;
+			}
+			if ( cluster > lastCluster ) {
+				lastCluster = cluster;
+			}
+		}
+		if ( lastCluster != -1 ) {
+			SV_SetClusterRun( ent, firstCluster, lastCluster );
+		}
 	}
 
 	gEnt->r.linkcount++;
@@ -0,0 +1,635 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cmbench.c -- standalone collision model benchmark and regression harness
+//
+// Loads a BSP through CM_LoadMap without the rest of the engine and runs
+// reproducible trace workloads against it, reporting throughput and a
+// checksum of every result so that optimizations can be verified for
+// both speed and exactness:
+//
+//   cmbench maps/q3dm17.bsp -seed 1 -rays 200000 -threads 4
+
+#include "../qcommon/cm_local.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+#define MAX_BENCH_CVARS		32
+
+typedef enum {
+	BENCH_RAY,
+	BENCH_SWEEP,
+	BENCH_POINT
+} benchType_t;
+
+typedef struct {
+	vec3_t		start;
+	vec3_t		end;
+} benchQuery_t;
+
+typedef struct {
+	const char	*name;
+	benchType_t	type;
+	int			count;
+	benchQuery_t *queries;
+	trace_t		*traces;
+	int			*contents;
+} benchWork_t;
+
+typedef struct {
+	benchWork_t	*work;
+	int			slot;
+	int			first;
+	int			last;
+} benchJob_t;
+
+static cvar_t	bench_cvars[MAX_BENCH_CVARS];
+static int		bench_numCvars;
+
+static unsigned int bench_seed;
+
+static const vec3_t playerMins = { -15, -15, -24 };
+static const vec3_t playerMaxs = { 15, 15, 32 };
+
+#define BENCH_MASK	( CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_BODY )
+
+
+/*
+===============================================================================
+
+ENGINE STUBS
+
+===============================================================================
+*/
+
+void QDECL Com_Error( errorParm_t level, const char *fmt, ... ) {
+	va_list		argptr;
+
+	va_start( argptr, fmt );
+	fprintf( stderr, "ERROR: " );
+	vfprintf( stderr, fmt, argptr );
+	fprintf( stderr, "\n" );
+	va_end( argptr );
+
+	exit( 1 );
+}
+
+
+void QDECL Com_Printf( const char *fmt, ... ) {
+	va_list		argptr;
+
+	va_start( argptr, fmt );
+	vprintf( fmt, argptr );
+	va_end( argptr );
+}
+
+
+void QDECL Com_DPrintf( const char *fmt, ... ) {
+}
+
+
+cvar_t *Cvar_Get( const char *var_name, const char *value, int flags ) {
+	cvar_t	*var;
+	int		i;
+
+	for ( i = 0; i < bench_numCvars; i++ ) {
+		if ( !strcmp( bench_cvars[i].name, var_name ) ) {
+			return &bench_cvars[i];
+		}
+	}
+
+	if ( bench_numCvars >= MAX_BENCH_CVARS ) {
+		Com_Error( ERR_FATAL, "Cvar_Get: too many cvars" );
+	}
+
+	var = &bench_cvars[ bench_numCvars++ ];
+	var->name = strdup( var_name );
+	var->string = strdup( value );
+	var->flags = flags;
+	var->value = atof( value );
+	var->integer = atoi( value );
+
+	return var;
+}
+
+
+#ifdef HUNK_DEBUG
+void *Hunk_AllocDebug( int size, ha_pref preference, char *label, char *file, int line ) {
+#else
+void *Hunk_Alloc( int size, ha_pref preference ) {
+#endif
+	void *buf;
+
+	buf = calloc( 1, size + 64 );
+	if ( !buf ) {
+		Com_Error( ERR_FATAL, "Hunk_Alloc failed on %i", size );
+	}
+
+	return buf;
+}
+
+
+#ifdef ZONE_DEBUG
+void *Z_MallocDebug( int size, char *label, char *file, int line ) {
+#else
+void *Z_Malloc( int size ) {
+#endif
+	void *buf;
+
+	buf = calloc( 1, size );
+	if ( !buf ) {
+		Com_Error( ERR_FATAL, "Z_Malloc failed on %i", size );
+	}
+
+	return buf;
+}
+
+
+void Z_Free( void *ptr ) {
+	free( ptr );
+}
+
+
+int FS_ReadFile( const char *qpath, void **buffer ) {
+	FILE	*f;
+	long	len;
+	byte	*buf;
+
+	*buffer = NULL;
+
+	f = fopen( qpath, "rb" );
+	if ( !f ) {
+		return -1;
+	}
+
+	fseek( f, 0, SEEK_END );
+	len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	buf = malloc( len + 1 );
+	if ( !buf || fread( buf, 1, len, f ) != len ) {
+		fclose( f );
+		free( buf );
+		return -1;
+	}
+	buf[ len ] = '\0';
+
+	fclose( f );
+
+	*buffer = buf;
+	return len;
+}
+
+
+void FS_FreeFile( void *buffer ) {
+	free( buffer );
+}
+
+
+// map cache is never used, maps are loaded only once
+void *Com_MapCacheFind( const char *qpath, const char *type, int *size ) {
+	return NULL;
+}
+
+
+qboolean Com_MapCacheBegin( const char *qpath, const char *type ) {
+	return qfalse;
+}
+
+
+void *Com_MapCacheAlloc( int size ) {
+	Com_Error( ERR_FATAL, "%s: not supported", __func__ );
+	return NULL;
+}
+
+
+void Com_MapCacheEnd( qboolean success ) {
+}
+
+
+void BotDrawDebugPolygons( void (*drawPoly)(int color, int numPoints, float *points), int value ) {
+}
+
+
+/*
+===============================================================================
+
+WORKLOADS
+
+===============================================================================
+*/
+
+/*
+================
+Bench_Milliseconds
+================
+*/
+static double Bench_Milliseconds( void ) {
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &count );
+	return (double)count.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+
+/*
+================
+Bench_Random
+
+Platform independent generator so that workloads are identical everywhere
+================
+*/
+static float Bench_Random( void ) {
+	bench_seed = bench_seed * 1664525 + 1013904223;
+	return (float)( bench_seed >> 8 ) / (float)( 1 << 24 );
+}
+
+
+static void Bench_RandomPoint( const vec3_t mins, const vec3_t maxs, vec3_t out ) {
+	int i;
+	for ( i = 0; i < 3; i++ ) {
+		out[i] = mins[i] + Bench_Random() * ( maxs[i] - mins[i] );
+	}
+}
+
+
+/*
+================
+Bench_LoadPath
+
+Reads recorded origins, one "x y z" per line
+================
+*/
+static int Bench_LoadPath( const char *filename, benchQuery_t **queries ) {
+	FILE	*f;
+	vec3_t	p, prev;
+	int		count, max;
+	benchQuery_t *q;
+
+	f = fopen( filename, "r" );
+	if ( !f ) {
+		Com_Error( ERR_FATAL, "couldn't open path file %s", filename );
+	}
+
+	count = 0;
+	max = 1024;
+	q = malloc( max * sizeof( *q ) );
+
+	if ( fscanf( f, "%f %f %f", &prev[0], &prev[1], &prev[2] ) == 3 ) {
+		while ( fscanf( f, "%f %f %f", &p[0], &p[1], &p[2] ) == 3 ) {
+			if ( count >= max ) {
+				max *= 2;
+				q = realloc( q, max * sizeof( *q ) );
+			}
+			VectorCopy( prev, q[count].start );
+			VectorCopy( p, q[count].end );
+			VectorCopy( p, prev );
+			count++;
+		}
+	}
+
+	fclose( f );
+
+	*queries = q;
+	return count;
+}
+
+
+/*
+================
+Bench_Generate
+
+Random rays and point tests are spread over the world bounds, player hull
+sweeps follow a random walk with player-like step lengths
+================
+*/
+static void Bench_Generate( benchWork_t *work, const vec3_t mins, const vec3_t maxs ) {
+	benchQuery_t *q;
+	vec3_t	pos, dir;
+	float	len;
+	int		i, j;
+
+	work->queries = calloc( work->count, sizeof( *work->queries ) );
+
+	if ( work->type == BENCH_SWEEP ) {
+		Bench_RandomPoint( mins, maxs, pos );
+	}
+
+	for ( i = 0; i < work->count; i++ ) {
+		q = &work->queries[i];
+		switch ( work->type ) {
+		case BENCH_RAY:
+			Bench_RandomPoint( mins, maxs, q->start );
+			Bench_RandomPoint( mins, maxs, q->end );
+			break;
+		case BENCH_SWEEP:
+			VectorCopy( pos, q->start );
+			for ( j = 0; j < 3; j++ ) {
+				dir[j] = Bench_Random() * 2.0f - 1.0f;
+			}
+			dir[2] *= 0.25f;
+			len = 8.0f + Bench_Random() * 56.0f;
+			VectorNormalize( dir );
+			VectorMA( pos, len, dir, q->end );
+			for ( j = 0; j < 3; j++ ) {
+				if ( q->end[j] < mins[j] || q->end[j] > maxs[j] ) {
+					q->end[j] = pos[j] - dir[j] * len;
+				}
+			}
+			VectorCopy( q->end, pos );
+			break;
+		case BENCH_POINT:
+			Bench_RandomPoint( mins, maxs, q->start );
+			break;
+		}
+	}
+}
+
+
+/*
+================
+Bench_RunJob
+================
+*/
+static void Bench_RunJob( benchJob_t *job ) {
+	benchWork_t *work = job->work;
+	benchQuery_t *q;
+	int i;
+
+	CM_SetThreadSlot( job->slot );
+
+	for ( i = job->first; i < job->last; i++ ) {
+		q = &work->queries[i];
+		switch ( work->type ) {
+		case BENCH_RAY:
+			CM_BoxTrace( &work->traces[i], q->start, q->end, NULL, NULL, 0, BENCH_MASK, qfalse );
+			break;
+		case BENCH_SWEEP:
+			CM_BoxTrace( &work->traces[i], q->start, q->end, playerMins, playerMaxs, 0, BENCH_MASK, qfalse );
+			break;
+		case BENCH_POINT:
+			work->contents[i] = CM_PointContents( q->start, 0 );
+			break;
+		}
+	}
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI Bench_Thread( LPVOID arg ) {
+	Bench_RunJob( (benchJob_t *)arg );
+	return 0;
+}
+#else
+static void *Bench_Thread( void *arg ) {
+	Bench_RunJob( (benchJob_t *)arg );
+	return NULL;
+}
+#endif
+
+
+/*
+================
+Bench_Checksum
+
+FNV-1a over every result field, independent of structure padding
+================
+*/
+static unsigned int Bench_Hash( unsigned int hash, const void *data, int len ) {
+	const byte *p = (const byte *)data;
+	int i;
+
+	for ( i = 0; i < len; i++ ) {
+		hash ^= p[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+
+static unsigned int Bench_Checksum( const benchWork_t *work ) {
+	unsigned int hash = 2166136261U;
+	const trace_t *tr;
+	int i, flags;
+
+	for ( i = 0; i < work->count; i++ ) {
+		if ( work->type == BENCH_POINT ) {
+			hash = Bench_Hash( hash, &work->contents[i], sizeof( int ) );
+			continue;
+		}
+		tr = &work->traces[i];
+		flags = tr->allsolid | ( tr->startsolid << 1 );
+		hash = Bench_Hash( hash, &flags, sizeof( flags ) );
+		hash = Bench_Hash( hash, &tr->fraction, sizeof( tr->fraction ) );
+		hash = Bench_Hash( hash, tr->endpos, sizeof( tr->endpos ) );
+		if ( tr->fraction < 1.0f ) {
+			hash = Bench_Hash( hash, tr->plane.normal, sizeof( tr->plane.normal ) );
+			hash = Bench_Hash( hash, &tr->plane.dist, sizeof( tr->plane.dist ) );
+		}
+		hash = Bench_Hash( hash, &tr->surfaceFlags, sizeof( tr->surfaceFlags ) );
+		hash = Bench_Hash( hash, &tr->contents, sizeof( tr->contents ) );
+	}
+
+	return hash;
+}
+
+
+/*
+================
+Bench_Run
+================
+*/
+static unsigned int Bench_Run( benchWork_t *work, int numThreads, int repeat ) {
+	benchJob_t	jobs[CM_MAX_THREADS];
+#ifdef _WIN32
+	HANDLE		threads[CM_MAX_THREADS];
+#else
+	pthread_t	threads[CM_MAX_THREADS];
+#endif
+	double		start, msec;
+	unsigned int checksum;
+	int			i, r;
+
+	if ( work->count <= 0 ) {
+		return 0;
+	}
+
+	if ( work->type == BENCH_POINT ) {
+		work->contents = calloc( work->count, sizeof( *work->contents ) );
+	} else {
+		work->traces = calloc( work->count, sizeof( *work->traces ) );
+	}
+
+	for ( i = 0; i < numThreads; i++ ) {
+		jobs[i].work = work;
+		jobs[i].slot = i;
+		jobs[i].first = (int)( (int64_t)work->count * i / numThreads );
+		jobs[i].last = (int)( (int64_t)work->count * ( i + 1 ) / numThreads );
+	}
+
+	start = Bench_Milliseconds();
+
+	for ( r = 0; r < repeat; r++ ) {
+		if ( numThreads == 1 ) {
+			Bench_RunJob( &jobs[0] );
+			continue;
+		}
+		for ( i = 0; i < numThreads; i++ ) {
+#ifdef _WIN32
+			threads[i] = CreateThread( NULL, 0, Bench_Thread, &jobs[i], 0, NULL );
+#else
+			pthread_create( &threads[i], NULL, Bench_Thread, &jobs[i] );
+#endif
+		}
+		for ( i = 0; i < numThreads; i++ ) {
+#ifdef _WIN32
+			WaitForSingleObject( threads[i], INFINITE );
+			CloseHandle( threads[i] );
+#else
+			pthread_join( threads[i], NULL );
+#endif
+		}
+	}
+
+	msec = Bench_Milliseconds() - start;
+	if ( msec <= 0.0 ) {
+		msec = 0.001;
+	}
+
+	checksum = Bench_Checksum( work );
+
+	Com_Printf( "%-8s %9i queries %10.2f ms %12.0f q/s  checksum %08x\n", work->name,
+		work->count * repeat, msec, (double)work->count * repeat * 1000.0 / msec, checksum );
+
+	return checksum;
+}
+
+
+static void Bench_Usage( void ) {
+	Com_Printf( "usage: cmbench <file.bsp> [options]\n"
+		"  -seed <n>     workload random seed (default 1)\n"
+		"  -rays <n>     number of random point rays (default 100000)\n"
+		"  -sweeps <n>   number of player hull sweeps (default 100000)\n"
+		"  -points <n>   number of point contents tests (default 100000)\n"
+		"  -path <file>  sweep along recorded \"x y z\" origins instead of a random walk\n"
+		"  -threads <n>  split every workload across n threads (max %i)\n"
+		"  -repeat <n>   run every workload n times\n", CM_MAX_THREADS );
+	exit( 1 );
+}
+
+
+int main( int argc, char **argv ) {
+	benchWork_t	rays, sweeps, points;
+	const char	*mapname, *pathname;
+	vec3_t		mins, maxs;
+	clipHandle_t world;
+	unsigned int checksum;
+	int			numThreads, repeat;
+	int			mapChecksum;
+	int			i;
+
+	if ( argc < 2 ) {
+		Bench_Usage();
+	}
+
+	Com_Memset( &rays, 0, sizeof( rays ) );
+	Com_Memset( &sweeps, 0, sizeof( sweeps ) );
+	Com_Memset( &points, 0, sizeof( points ) );
+
+	rays.name = "rays";
+	rays.type = BENCH_RAY;
+	rays.count = 100000;
+	sweeps.name = "sweeps";
+	sweeps.type = BENCH_SWEEP;
+	sweeps.count = 100000;
+	points.name = "points";
+	points.type = BENCH_POINT;
+	points.count = 100000;
+
+	mapname = argv[1];
+	pathname = NULL;
+	bench_seed = 1;
+	numThreads = 1;
+	repeat = 1;
+
+	for ( i = 2; i < argc; i++ ) {
+		if ( i + 1 >= argc ) {
+			Bench_Usage();
+		}
+		if ( !strcmp( argv[i], "-seed" ) ) {
+			bench_seed = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-rays" ) ) {
+			rays.count = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-sweeps" ) ) {
+			sweeps.count = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-points" ) ) {
+			points.count = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-path" ) ) {
+			pathname = argv[++i];
+		} else if ( !strcmp( argv[i], "-threads" ) ) {
+			numThreads = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-repeat" ) ) {
+			repeat = atoi( argv[++i] );
+		} else {
+			Bench_Usage();
+		}
+	}
+
+	if ( numThreads < 1 || numThreads > CM_MAX_THREADS || repeat < 1 ) {
+		Bench_Usage();
+	}
+
+	CM_LoadMap( mapname, qfalse, &mapChecksum );
+
+	world = CM_InlineModel( 0 );
+	CM_ModelBounds( world, mins, maxs );
+
+	Com_Printf( "%s: checksum %08x, %i brushes, %i leafs, %i threads, seed %u\n",
+		mapname, (unsigned)mapChecksum, cm.numBrushes, cm.numLeafs, numThreads, bench_seed );
+
+	Bench_Generate( &rays, mins, maxs );
+	Bench_Generate( &points, mins, maxs );
+	if ( pathname ) {
+		sweeps.count = Bench_LoadPath( pathname, &sweeps.queries );
+	} else {
+		Bench_Generate( &sweeps, mins, maxs );
+	}
+
+	checksum = Bench_Run( &rays, numThreads, repeat );
+	checksum = checksum * 31 + Bench_Run( &sweeps, numThreads, repeat );
+	checksum = checksum * 31 + Bench_Run( &points, numThreads, repeat );
+
+	Com_Printf( "total checksum %08x\n", checksum );
+
+	return 0;
+}
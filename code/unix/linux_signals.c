@@ -19,7 +19,17 @@ along with Quake III Arena source code; if not, write to the Free Software
 Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
+#define _GNU_SOURCE
 #include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <ucontext.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef _DEBUG
 #include <execinfo.h>
@@ -82,3 +92,118 @@ void InitSig( void )
 	signal( SIGSEGV, signal_handler );
 	signal( SIGTERM, signal_handler );
 }
+
+
+/*
+=================
+Sys_StartSampler
+=================
+*/
+#if defined( __linux__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) || defined( __aarch64__ ) || defined( __arm__ ) )
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static sysSampleFunc_t sampleFunc;
+static timer_t sampleTimer;
+static qboolean sampleTimerActive;
+
+static void sample_handler( int sig, siginfo_t *info, void *context )
+{
+	const ucontext_t *uc = (const ucontext_t *) context;
+	sysSampleFunc_t func = sampleFunc;
+	int saved_errno = errno;
+
+	if ( func ) {
+#if defined( __x86_64__ )
+		func( (const void *) uc->uc_mcontext.gregs[ REG_RIP ], (int32_t) uc->uc_mcontext.gregs[ REG_RSI ] );
+#elif defined( __i386__ )
+		func( (const void *) uc->uc_mcontext.gregs[ REG_EIP ], (int32_t) uc->uc_mcontext.gregs[ REG_ESI ] );
+#elif defined( __aarch64__ )
+		func( (const void *) uc->uc_mcontext.pc, -1 );
+#else
+		func( (const void *) uc->uc_mcontext.arm_pc, -1 );
+#endif
+	}
+
+	errno = saved_errno;
+}
+
+
+qboolean Sys_StartSampler( int hz, sysSampleFunc_t func )
+{
+	struct sigaction sa;
+	struct sigevent sev;
+	struct itimerspec its;
+	long long period;
+
+	if ( hz <= 0 || hz > 10000 || !func || sampleTimerActive ) {
+		return qfalse;
+	}
+
+	sampleFunc = func;
+
+	memset( &sa, 0, sizeof( sa ) );
+	sa.sa_sigaction = sample_handler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset( &sa.sa_mask );
+	if ( sigaction( SIGPROF, &sa, NULL ) != 0 ) {
+		sampleFunc = NULL;
+		return qfalse;
+	}
+
+	// ITIMER_PROF is process-wide and would deliver samples to any thread,
+	// use cpu time of the calling (vm) thread and send signal only to it
+	memset( &sev, 0, sizeof( sev ) );
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGPROF;
+	sev.sigev_notify_thread_id = syscall( SYS_gettid );
+	if ( timer_create( CLOCK_THREAD_CPUTIME_ID, &sev, &sampleTimer ) != 0 ) {
+		signal( SIGPROF, SIG_IGN );
+		sampleFunc = NULL;
+		return qfalse;
+	}
+
+	period = 1000000000LL / hz;
+	its.it_interval.tv_sec = period / 1000000000LL;
+	its.it_interval.tv_nsec = period % 1000000000LL;
+	its.it_value = its.it_interval;
+	if ( timer_settime( sampleTimer, 0, &its, NULL ) != 0 ) {
+		timer_delete( sampleTimer );
+		signal( SIGPROF, SIG_IGN );
+		sampleFunc = NULL;
+		return qfalse;
+	}
+
+	sampleTimerActive = qtrue;
+
+	return qtrue;
+}
+
+
+void Sys_StopSampler( void )
+{
+	if ( sampleTimerActive ) {
+		timer_delete( sampleTimer );
+		sampleTimerActive = qfalse;
+	}
+
+	// timer may be already pending
+	signal( SIGPROF, SIG_IGN );
+	sampleFunc = NULL;
+}
+
+#else
+
+qboolean Sys_StartSampler( int hz, sysSampleFunc_t func )
+{
+	return qfalse;
+}
+
+
+void Sys_StopSampler( void )
+{
+}
+
+#endif
@@ -26,8 +26,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <errno.h>
 #include <stdio.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <pwd.h>
 #include <dlfcn.h>
@@ -316,14 +318,45 @@ qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t
 }
 
 
+/*
+=============
+Sys_GetFileId
+
+Unlike the whole seconds of Sys_GetFileStats() this catches a rewrite of
+the same size within a second and a file replaced by a rename
+=============
+*/
+qboolean Sys_GetFileId( const char *filename, fileId_t *id ) {
+	struct stat s;
+
+	Com_Memset( id, 0, sizeof( *id ) );
+
+	if ( stat( filename, &s ) != 0 ) {
+		return qfalse;
+	}
+
+	id->size = (uint64_t)s.st_size;
+#if defined (__APPLE__)
+	id->mtime = (uint64_t)s.st_mtimespec.tv_sec * 1000000000ULL + s.st_mtimespec.tv_nsec;
+#else
+	id->mtime = (uint64_t)s.st_mtim.tv_sec * 1000000000ULL + s.st_mtim.tv_nsec;
+#endif
+	id->index = (uint64_t)s.st_ino;
+
+	return qtrue;
+}
+
+
 /*
 =================
 Sys_Mkdir
+
+Returns qtrue if the directory was created, qfalse if it exists or failed
 =================
 */
-void Sys_Mkdir( const char *path )
+qboolean Sys_Mkdir( const char *path )
 {
-    mkdir( path, 0750 );
+    return mkdir( path, 0750 ) == 0 ? qtrue : qfalse;
 }
 
 
@@ -614,3 +647,305 @@ void Sys_SetAffinityMask( int mask )
 	}
 }
 #endif // USE_AFFINITY_MASK
+
+
+/*
+=================
+Sys_AllocPages
+
+Returns zero-filled, page aligned memory which is never released,
+hugePages: 1 - use transparent huge pages, 2 - try explicit huge pages first
+=================
+*/
+void *Sys_AllocPages( size_t size, int hugePages )
+{
+	const size_t hugeSize = 2 * 1024 * 1024;
+	byte *ptr, *base;
+	size_t head, tail;
+
+#ifdef MAP_HUGETLB
+	if ( hugePages >= 2 ) {
+		ptr = mmap( NULL, PAD( size, hugeSize ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if ( ptr != MAP_FAILED ) {
+			return ptr;
+		}
+		Com_Printf( S_COLOR_YELLOW "no explicit huge pages available for %i megs\n", (int)( size / ( 1024 * 1024 ) ) );
+	}
+#endif
+
+	if ( !hugePages ) {
+		ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		return ptr != MAP_FAILED ? ptr : NULL;
+	}
+
+	// align to huge page boundary so the whole range can be backed by them
+	base = mmap( NULL, size + hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( base == MAP_FAILED ) {
+		return NULL;
+	}
+
+	ptr = PADP( base, hugeSize );
+	head = ptr - base;
+	tail = hugeSize - head;
+	if ( head ) {
+		munmap( base, head );
+	}
+	if ( tail ) {
+		munmap( ptr + size, tail );
+	}
+
+#ifdef MADV_HUGEPAGE
+	madvise( ptr, size, MADV_HUGEPAGE );
+#endif
+
+	return ptr;
+}
+
+
+/*
+=================
+Sys_MapFile
+
+Maps the whole file copy-on-write, the mapping is private to the process
+so writes to it never reach the file, returns NULL on failure
+=================
+*/
+void *Sys_MapFile( const char *ospath, size_t *size )
+{
+	struct stat st;
+	void *ptr;
+	int fd;
+
+	fd = open( ospath, O_RDONLY );
+	if ( fd == -1 ) {
+		return NULL;
+	}
+
+	if ( fstat( fd, &st ) == -1 || st.st_size <= 0 ) {
+		close( fd );
+		return NULL;
+	}
+
+	ptr = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( ptr == MAP_FAILED ) {
+		return NULL;
+	}
+
+	*size = st.st_size;
+	return ptr;
+}
+
+
+/*
+=================
+Sys_UnmapFile
+=================
+*/
+void Sys_UnmapFile( void *ptr, size_t size )
+{
+	munmap( ptr, size );
+}
+
+
+/*
+=================
+Sys_CPUCount
+=================
+*/
+int Sys_CPUCount( void )
+{
+	long count;
+
+	count = sysconf( _SC_NPROCESSORS_ONLN );
+	if ( count < 1 ) {
+		return 1;
+	}
+
+	return (int)count;
+}
+
+
+typedef struct {
+	void	(*func)( void *arg );
+	void	*arg;
+} sysThreadJob_t;
+
+static void *Sys_ThreadMain( void *arg )
+{
+	const sysThreadJob_t *job = (const sysThreadJob_t *)arg;
+
+	job->func( job->arg );
+
+	return NULL;
+}
+
+
+/*
+=================
+Sys_RunThreads
+
+Runs func( arg ) on numThreads threads, the calling thread included,
+and returns when all of them are finished
+=================
+*/
+void Sys_RunThreads( void (*func)( void *arg ), void *arg, int numThreads )
+{
+	pthread_t threads[ MAX_SYS_THREADS ];
+	sysThreadJob_t job;
+	int i, started;
+
+	job.func = func;
+	job.arg = arg;
+
+	if ( numThreads > MAX_SYS_THREADS ) {
+		numThreads = MAX_SYS_THREADS;
+	}
+
+	for ( started = 0; started < numThreads - 1; started++ ) {
+		if ( pthread_create( &threads[ started ], NULL, Sys_ThreadMain, &job ) != 0 ) {
+			break;
+		}
+	}
+
+	func( arg );
+
+	for ( i = 0; i < started; i++ ) {
+		pthread_join( threads[ i ], NULL );
+	}
+}
+
+
+typedef struct {
+	pthread_t		thread;
+	sysThreadJob_t	job;
+} sysThread_t;
+
+
+/*
+=================
+Sys_StartThread
+
+Runs func( arg ) on a new thread, returns NULL on failure
+=================
+*/
+void *Sys_StartThread( void (*func)( void *arg ), void *arg )
+{
+	sysThread_t *t;
+
+	t = Z_Malloc( sizeof( *t ) );
+	t->job.func = func;
+	t->job.arg = arg;
+
+	if ( pthread_create( &t->thread, NULL, Sys_ThreadMain, &t->job ) != 0 ) {
+		Z_Free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+
+/*
+=================
+Sys_JoinThread
+
+Waits for a thread started with Sys_StartThread() to finish
+=================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	pthread_join( t->thread, NULL );
+	Z_Free( t );
+}
+
+
+typedef struct {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	qboolean		signaled;
+} sysWaitEvent_t;
+
+
+/*
+=================
+Sys_CreateEvent
+
+Auto-reset event, returns NULL on failure
+=================
+*/
+void *Sys_CreateEvent( void )
+{
+	sysWaitEvent_t *ev;
+
+	ev = Z_Malloc( sizeof( *ev ) );
+
+	if ( pthread_mutex_init( &ev->lock, NULL ) != 0 ) {
+		Z_Free( ev );
+		return NULL;
+	}
+
+	if ( pthread_cond_init( &ev->cond, NULL ) != 0 ) {
+		pthread_mutex_destroy( &ev->lock );
+		Z_Free( ev );
+		return NULL;
+	}
+
+	return ev;
+}
+
+
+/*
+=================
+Sys_DestroyEvent
+=================
+*/
+void Sys_DestroyEvent( void *event )
+{
+	sysWaitEvent_t *ev = (sysWaitEvent_t *)event;
+
+	pthread_cond_destroy( &ev->cond );
+	pthread_mutex_destroy( &ev->lock );
+	Z_Free( ev );
+}
+
+
+/*
+=================
+Sys_SignalEvent
+
+Wakes a waiting thread, or the next one to wait
+=================
+*/
+void Sys_SignalEvent( void *event )
+{
+	sysWaitEvent_t *ev = (sysWaitEvent_t *)event;
+
+	pthread_mutex_lock( &ev->lock );
+	ev->signaled = qtrue;
+	pthread_cond_signal( &ev->cond );
+	pthread_mutex_unlock( &ev->lock );
+}
+
+
+/*
+=================
+Sys_WaitEvent
+
+Blocks until the event is signaled and resets it
+=================
+*/
+void Sys_WaitEvent( void *event )
+{
+	sysWaitEvent_t *ev = (sysWaitEvent_t *)event;
+
+	pthread_mutex_lock( &ev->lock );
+	while ( !ev->signaled ) {
+		pthread_cond_wait( &ev->cond, &ev->lock );
+	}
+	ev->signaled = qfalse;
+	pthread_mutex_unlock( &ev->lock );
+}
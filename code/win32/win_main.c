@@ -128,11 +128,13 @@ void Sys_Print( const char *msg )
 /*
 ==============
 Sys_Mkdir
+
+Returns qtrue if the directory was created, qfalse if it exists or failed
 ==============
 */
-void Sys_Mkdir( const char *path )
+qboolean Sys_Mkdir( const char *path )
 {
-	_mkdir( path );
+	return _mkdir( path ) == 0 ? qtrue : qfalse;
 }
 
 
@@ -457,6 +459,41 @@ qboolean Sys_GetFileStats( const char *filename, fileOffset_t *size, fileTime_t
 }
 
 
+/*
+=============
+Sys_GetFileId
+
+Unlike the whole seconds of Sys_GetFileStats() this catches a rewrite of
+the same size within a second and a file replaced by a rename
+=============
+*/
+qboolean Sys_GetFileId( const char *filename, fileId_t *id ) {
+	BY_HANDLE_FILE_INFORMATION info;
+	HANDLE file;
+	BOOL ok;
+
+	Com_Memset( id, 0, sizeof( *id ) );
+
+	file = CreateFileA( filename, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE ) {
+		return qfalse;
+	}
+
+	ok = GetFileInformationByHandle( file, &info );
+	CloseHandle( file );
+	if ( !ok ) {
+		return qfalse;
+	}
+
+	id->size = ( (uint64_t)info.nFileSizeHigh << 32 ) | info.nFileSizeLow;
+	id->mtime = ( (uint64_t)info.ftLastWriteTime.dwHighDateTime << 32 ) | info.ftLastWriteTime.dwLowDateTime;
+	id->index = ( (uint64_t)info.nFileIndexHigh << 32 ) | info.nFileIndexLow;
+
+	return qtrue;
+}
+
+
 //========================================================
 
 /*
@@ -53,6 +53,24 @@ int Sys_Milliseconds( void )
 }
 
 
+/*
+================
+Sys_StartSampler
+
+No SIGPROF equivalent, not supported yet
+================
+*/
+qboolean Sys_StartSampler( int hz, sysSampleFunc_t func )
+{
+	return qfalse;
+}
+
+
+void Sys_StopSampler( void )
+{
+}
+
+
 /*
 ================
 Sys_RandomBytes
@@ -240,3 +258,254 @@ void Sys_SetAffinityMask( int mask )
 	}
 }
 #endif // USE_AFFINITY_MASK
+
+
+/*
+================
+Sys_AllocPages
+
+Returns zero-filled, page aligned memory which is never released,
+hugePages: 2 - try large pages first, requires "Lock pages in memory" privilege
+================
+*/
+void *Sys_AllocPages( size_t size, int hugePages )
+{
+	SIZE_T largeSize;
+	void *ptr;
+
+	if ( hugePages >= 2 ) {
+		largeSize = GetLargePageMinimum();
+		if ( largeSize ) {
+			ptr = VirtualAlloc( NULL, PAD( size, largeSize ), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+			if ( ptr ) {
+				return ptr;
+			}
+		}
+		Com_Printf( S_COLOR_YELLOW "no large pages available for %i megs\n", (int)( size / ( 1024 * 1024 ) ) );
+	}
+
+	return VirtualAlloc( NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+}
+
+
+/*
+================
+Sys_MapFile
+
+Maps the whole file for reading, the view is copy-on-write
+so writes to it never reach the file, returns NULL on failure
+================
+*/
+void *Sys_MapFile( const char *ospath, size_t *size )
+{
+	HANDLE file, mapping;
+	LARGE_INTEGER length;
+	void *ptr;
+
+	file = CreateFileA( ospath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE ) {
+		return NULL;
+	}
+
+	if ( !GetFileSizeEx( file, &length ) || length.QuadPart <= 0 || (unsigned __int64)length.QuadPart > (SIZE_T)-1 ) {
+		CloseHandle( file );
+		return NULL;
+	}
+
+	mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( mapping == NULL ) {
+		return NULL;
+	}
+
+	ptr = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( ptr == NULL ) {
+		return NULL;
+	}
+
+	*size = (size_t)length.QuadPart;
+	return ptr;
+}
+
+
+/*
+================
+Sys_UnmapFile
+================
+*/
+void Sys_UnmapFile( void *ptr, size_t size )
+{
+	UnmapViewOfFile( ptr );
+}
+
+
+/*
+================
+Sys_CPUCount
+================
+*/
+int Sys_CPUCount( void )
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	if ( info.dwNumberOfProcessors < 1 ) {
+		return 1;
+	}
+
+	return (int)info.dwNumberOfProcessors;
+}
+
+
+typedef struct {
+	void	(*func)( void *arg );
+	void	*arg;
+} sysThreadJob_t;
+
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg )
+{
+	const sysThreadJob_t *job = (const sysThreadJob_t *)arg;
+
+	job->func( job->arg );
+
+	return 0;
+}
+
+
+/*
+================
+Sys_RunThreads
+
+Runs func( arg ) on numThreads threads, the calling thread included,
+and returns when all of them are finished
+================
+*/
+void Sys_RunThreads( void (*func)( void *arg ), void *arg, int numThreads )
+{
+	HANDLE threads[ MAX_SYS_THREADS ];
+	sysThreadJob_t job;
+	int i, started;
+
+	job.func = func;
+	job.arg = arg;
+
+	if ( numThreads > MAX_SYS_THREADS ) {
+		numThreads = MAX_SYS_THREADS;
+	}
+
+	for ( started = 0; started < numThreads - 1; started++ ) {
+		threads[ started ] = CreateThread( NULL, 0, Sys_ThreadMain, &job, 0, NULL );
+		if ( threads[ started ] == NULL ) {
+			break;
+		}
+	}
+
+	func( arg );
+
+	if ( started ) {
+		WaitForMultipleObjects( started, threads, TRUE, INFINITE );
+	}
+
+	for ( i = 0; i < started; i++ ) {
+		CloseHandle( threads[ i ] );
+	}
+}
+
+
+typedef struct {
+	HANDLE			thread;
+	sysThreadJob_t	job;
+} sysThread_t;
+
+
+/*
+================
+Sys_StartThread
+
+Runs func( arg ) on a new thread, returns NULL on failure
+================
+*/
+void *Sys_StartThread( void (*func)( void *arg ), void *arg )
+{
+	sysThread_t *t;
+
+	t = Z_Malloc( sizeof( *t ) );
+	t->job.func = func;
+	t->job.arg = arg;
+
+	t->thread = CreateThread( NULL, 0, Sys_ThreadMain, &t->job, 0, NULL );
+	if ( t->thread == NULL ) {
+		Z_Free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+
+/*
+================
+Sys_JoinThread
+
+Waits for a thread started with Sys_StartThread() to finish
+================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	WaitForSingleObject( t->thread, INFINITE );
+	CloseHandle( t->thread );
+	Z_Free( t );
+}
+
+
+/*
+================
+Sys_CreateEvent
+
+Auto-reset event, returns NULL on failure
+================
+*/
+void *Sys_CreateEvent( void )
+{
+	return CreateEvent( NULL, FALSE, FALSE, NULL );
+}
+
+
+/*
+================
+Sys_DestroyEvent
+================
+*/
+void Sys_DestroyEvent( void *event )
+{
+	CloseHandle( (HANDLE)event );
+}
+
+
+/*
+================
+Sys_SignalEvent
+
+Wakes a waiting thread, or the next one to wait
+================
+*/
+void Sys_SignalEvent( void *event )
+{
+	SetEvent( (HANDLE)event );
+}
+
+
+/*
+================
+Sys_WaitEvent
+
+Blocks until the event is signaled and resets it
+================
+*/
+void Sys_WaitEvent( void *event )
+{
+	WaitForSingleObject( (HANDLE)event, INFINITE );
+}